@@ -83,6 +83,10 @@ typedef enum ommResult
    ommResult_INSUFFICIENT_SCRATCH_MEMORY,
    ommResult_NOT_IMPLEMENTED,
    ommResult_WORKLOAD_TOO_BIG,
+   // Returned by ommCpuPollBake and ommCpuGetBakeResultDesc while an asynchronous bake is still running.
+   ommResult_NOT_READY,
+   // The bake was stopped by ommCpuCancelBake.
+   ommResult_CANCELLED,
    ommResult_MAX_NUM,
 } ommResult;
 
@@ -257,11 +261,83 @@ inline ommMessageInterface ommMessageInterfaceDefault()
     return v;
 }
 
+typedef void(*ommTaskCallback)(uint32_t taskIndex, void* taskArg);
+
+// Must invoke task(taskIndex, taskArg) for every taskIndex in [0, taskCount) and return once all invocations have completed.
+// Invocations may run concurrently and in any order.
+typedef void(*ommParallelFor)(void* userArg, uint32_t taskCount, ommTaskCallback task, void* taskArg);
+
+// Must schedule task(0, taskArg) for execution and return a handle that is later passed to ommWaitTask.
+typedef void*(*ommSubmitTask)(void* userArg, ommTaskCallback task, void* taskArg);
+
+// Must block until the submitted task has completed. Called exactly once per submitted task.
+typedef void(*ommWaitTask)(void* userArg, void* task);
+
+// Lets the CPU baker share the host's thread pool. When set, the parallel regions of bakes with
+// ommCpuBakeFlags_EnableInternalThreads and of textures with ommCpuTextureFlags_EnableInternalThreads are executed
+// through these callbacks instead of internally spawned threads.
+typedef struct ommTaskInterface
+{
+   // Used when set. Otherwise submitTask and waitTask are used, if set.
+   ommParallelFor parallelFor;
+   ommSubmitTask  submitTask;
+   ommWaitTask    waitTask;
+   // Number of threads the host intends to run the work on, used to size the work split. 0 = hardware concurrency.
+   uint32_t       workerCount;
+   void*          userArg;
+} ommTaskInterface;
+
+inline ommTaskInterface ommTaskInterfaceDefault()
+{
+   ommTaskInterface v;
+   v.parallelFor  = NULL;
+   v.submitTask   = NULL;
+   v.waitTask     = NULL;
+   v.workerCount  = 0;
+   v.userArg      = NULL;
+   return v;
+}
+
+// Must return true when key is present in the cache and write the size of the stored value to *size.
+// When data is not NULL, *size holds the capacity of data and the stored value must also be copied to data.
+typedef ommBool(*ommBakeCacheLoad)(void* userArg, uint64_t key, void* data, uint64_t* size);
+
+// Must store a copy of the value under key. May be called concurrently from bakes running in parallel.
+typedef void(*ommBakeCacheStore)(void* userArg, uint64_t key, const void* data, uint64_t size);
+
+// Persistent cache of CPU bake results. Before baking, the baker hashes the texture contents, the UV and index streams
+// and the bake settings, and returns the stored result of an identical earlier bake instead of baking again.
+// Results are stored as serialized blobs (see ommCpuSerialize) and are invalidated by SDK version changes.
+typedef struct ommBakeCacheInterface
+{
+   // Used when both are set.
+   ommBakeCacheLoad  load;
+   ommBakeCacheStore store;
+   // Used when load and store are not set. Results are stored as one file per key in this directory, which is created
+   // if missing.
+   const char*       directory;
+   void*             userArg;
+} ommBakeCacheInterface;
+
+inline ommBakeCacheInterface ommBakeCacheInterfaceDefault()
+{
+   ommBakeCacheInterface v;
+   v.load       = NULL;
+   v.store      = NULL;
+   v.directory  = NULL;
+   v.userArg    = NULL;
+   return v;
+}
+
 typedef struct ommBakerCreationDesc
 {
    ommBakerType                type;
    ommMemoryAllocatorInterface memoryAllocatorInterface;
    ommMessageInterface         messageInterface;
+   // Optional, CPU baker only.
+   ommTaskInterface            taskInterface;
+   // Optional, CPU baker only. ommCpuBakeBatch doesn't use the cache.
+   ommBakeCacheInterface       cacheInterface;
 } ommBakerCreationDesc;
 
 inline ommBakerCreationDesc ommBakerCreationDescDefault()
@@ -270,6 +346,8 @@ inline ommBakerCreationDesc ommBakerCreationDescDefault()
    v.type                      = ommBakerType_MAX_NUM;
    v.memoryAllocatorInterface  = ommMemoryAllocatorInterfaceDefault();
    v.messageInterface          = ommMessageInterfaceDefault();
+   v.taskInterface             = ommTaskInterfaceDefault();
+   v.cacheInterface            = ommBakeCacheInterfaceDefault();
    return v;
 }
 
@@ -283,6 +361,14 @@ typedef enum ommCpuTextureFormat
 {
    ommCpuTextureFormat_UNORM8,
    ommCpuTextureFormat_FP32,
+   // Block compressed formats are sampled without decompressing the texture. rowPitch is the byte stride of a row of 4x4
+   // blocks.
+   ommCpuTextureFormat_BC4_UNORM,
+   // The alpha channel of BC3 (DXT5) blocks is sampled, the color channels are ignored.
+   ommCpuTextureFormat_BC3_UNORM,
+   // One bit per texel for pre-thresholded alpha, 0 or 1. Texels are packed from the least significant bit of each byte and
+   // rowPitch is in bytes.
+   ommCpuTextureFormat_R1_UNORM,
    ommCpuTextureFormat_MAX_NUM,
 } ommCpuTextureFormat;
 
@@ -290,8 +376,25 @@ typedef enum ommCpuTextureFlags
 {
    ommCpuTextureFlags_None,
    // Controls the internal memory layout of the texture. does not change the expected input format, it does affect the baking
-   // performance and memory footprint of the texture object.
+   // performance and memory footprint of the texture object. Block compressed and R1 textures always keep their input
+   // layout. Textures that Z-order would pad by more than a quarter, such as non-square ones, are stored in 8x8 tiles instead.
    ommCpuTextureFlags_DisableZOrder = 1u << 0,
+   // Keeps the micro-triangle states of every UV-triangle baked with the texture. Later bakes with the same settings reuse
+   // them for unchanged UV-triangles, so re-baking an edited mesh only resamples what changed. The memory grows with the
+   // number of unique UV-triangles baked and is released when the texture is destroyed. Bakes with
+   // ommCpuBakeFlags_EnableValidation report how many UV-triangles were found in the cache through the message interface.
+   ommCpuTextureFlags_EnableTriangleCache = 1u << 1,
+   // Builds a min/max pyramid of the alpha values when the texture is created. Bakes use it to classify micro-triangles whose
+   // texels are all above or all below the alpha cutoff without rasterizing them. The pyramid does not depend on the alpha
+   // cutoff and takes about 2.7 bytes per texel.
+   ommCpuTextureFlags_EnableMinMaxPyramid = 1u << 2,
+   // Reads the texels from the caller's textureData instead of copying them, only the acceleration data is allocated. Requires
+   // DisableZOrder for UNORM8 and FP32. The memory must stay valid and unchanged until the texture is destroyed. rowPitch is
+   // in bytes and must be a multiple of the texel size, as must the textureData address.
+   ommCpuTextureFlags_BorrowTextureData = 1u << 3,
+   // Copies, swizzles and builds the acceleration data of large mips in parallel, through the baker's ommTaskInterface when
+   // one was provided and on internal threads otherwise. Applies to the textures of deserialized bake inputs as well.
+   ommCpuTextureFlags_EnableInternalThreads = 1u << 4,
 } ommCpuTextureFlags;
 OMM_DEFINE_ENUM_FLAG_OPERATORS(ommCpuTextureFlags);
 
@@ -329,6 +432,11 @@ typedef enum ommCpuBakeFlags
    // Allow 8-bit index format for the output OMM index buffer
    ommCpuBakeFlags_Allow8BitIndices             = 1u << 6,
 
+   // Used together with EnableNearDuplicateDetection. Instead of locality sensitive hashing the similar OMMs are found with an
+   // exact nearest neighbour search per subdivision level, so no pair closer than nearDuplicateDeduplicationFactor is missed.
+   // Typically merges more OMMs at a higher CPU cost.
+   ommCpuBakeFlags_EnableNearDuplicateDetectionExact = 1u << 10,
+
    ommCpuBakeFlags_EnableWorkloadValidation OMM_DEPRECATED_MSG("EnableWorkloadValidation is deprecated, use EnableValidation instead") = 1u << 5,
 
 } ommCpuBakeFlags;
@@ -362,7 +470,8 @@ typedef struct ommCpuTextureDesc
    const ommCpuTextureMipDesc* mips;
    uint32_t                    mipCount;
    // Setting the alphaCutoff [0,1] allows the alpha cutoff to be embeded in the texture object which may accelerate the
-   // baking operation in some circumstances. Note: if set it must match the alphaCutoff in the bake desc exactly.
+   // baking operation in some circumstances. Bakes at a different alphaCutoff are valid but don't benefit from it, see
+   // ommCpuTextureFlags_EnableMinMaxPyramid for an acceleration structure that serves any alphaCutoff.
    float                       alphaCutoff;
 } ommCpuTextureDesc;
 
@@ -457,6 +566,13 @@ typedef struct ommCpuBakeInputDesc
    // * Subdivision level of the OMMs.
    // Configure this value when experiencing long bake times, a starting point might be maxWorkloadSize = 1 << 28 (~ processing a total of 256 1k textures)
    uint64_t                 maxWorkloadSize;
+   // [optional] Use maxWorkingSetBytes to bound the peak memory used by the baker for intermediate micro-triangle state.
+   // When set the primitives are processed in spatially coherent chunks that fit within the budget, each finished chunk is
+   // deduplicated against the OMMs baked so far and appended to the output. Each primitive gets the same OMM as without the budget.
+   // The budget is a heuristic: it covers an estimate of the per-primitive state and lookup tables of a chunk and of the
+   // table of OMMs baked so far, but not the output itself. A single primitive exceeding it is still processed.
+   // Not supported together with EnableNearDuplicateDetection or maxArrayDataSize.
+   uint64_t                 maxWorkingSetBytes;
 } ommCpuBakeInputDesc;
 
 inline ommCpuBakeInputDesc ommCpuBakeInputDescDefault()
@@ -486,6 +602,37 @@ inline ommCpuBakeInputDesc ommCpuBakeInputDescDefault()
    v.maxArrayDataSize              = 0xFFFFFFFF;
    v.subdivisionLevels             = NULL;
    v.maxWorkloadSize               = 0xFFFFFFFFFFFFFFFF;
+   v.maxWorkingSetBytes            = 0xFFFFFFFFFFFFFFFF;
+   return v;
+}
+
+// Pipeline stages of a CPU bake, reported by ommCpuPollBake. In streaming mode (maxWorkingSetBytes) the coarse, fine and
+// deduplicate stages are repeated for every chunk of primitives.
+typedef enum ommCpuBakeStage
+{
+   ommCpuBakeStage_Setup,
+   ommCpuBakeStage_Coarse,
+   ommCpuBakeStage_Fine,
+   ommCpuBakeStage_Deduplicate,
+   ommCpuBakeStage_Compress,
+   ommCpuBakeStage_Serialize,
+   ommCpuBakeStage_Done,
+   ommCpuBakeStage_MAX_NUM,
+} ommCpuBakeStage;
+
+typedef struct ommCpuBakeProgress
+{
+   // The stage currently executing.
+   ommCpuBakeStage stage;
+   // Fraction of the current stage completed, in range [0, 1]. Stages without a meaningful work estimate report 0 until done.
+   float           stageProgress;
+} ommCpuBakeProgress;
+
+inline ommCpuBakeProgress ommCpuBakeProgressDefault()
+{
+   ommCpuBakeProgress v;
+   v.stage           = ommCpuBakeStage_Setup;
+   v.stageProgress   = 0.f;
    return v;
 }
 
@@ -573,10 +720,39 @@ OMM_API ommResult ommCpuDestroyTexture(ommBaker baker, ommCpuTexture texture);
 
 OMM_API ommResult ommCpuBake(ommBaker baker, const ommCpuBakeInputDesc* bakeInputDesc, ommCpuBakeResult* outBakeResult);
 
+// Starts baking in the background and returns immediately. The input desc is validated up front, but the data it points to
+// (texture, texCoords, indexBuffer, formats, subdivisionLevels) must stay valid until the bake has completed or been
+// destroyed. The returned bake result doubles as the job handle: poll it with ommCpuPollBake, stop it with ommCpuCancelBake
+// and release it with ommCpuDestroyBakeResult (which cancels and waits for a running bake).
+// The background work is submitted through ommTaskInterface::submitTask when available, otherwise a thread is spawned.
+// A submitted bake submits the tasks of its parallel regions as well, but never waits on them from its own task: it works
+// through each region together with whichever of them have started, the others return right away once they run. The baker
+// may be destroyed while the bake is running.
+OMM_API ommResult ommCpuBakeAsync(ommBaker baker, const ommCpuBakeInputDesc* bakeInputDesc, ommCpuBakeResult* outBakeResult);
+
+// Returns ommResult_NOT_READY while the bake is running, otherwise the final result of the bake. outProgress is optional.
+OMM_API ommResult ommCpuPollBake(ommCpuBakeResult bakeResult, ommCpuBakeProgress* outProgress);
+
+// Requests cancellation of a running bake. The bake stops at the next cancellation point and ommCpuPollBake then
+// returns ommResult_CANCELLED. Has no effect on a bake that has already completed.
+OMM_API ommResult ommCpuCancelBake(ommCpuBakeResult bakeResult);
+
+// Bakes several inputs in one call, typically meshes sharing an atlas texture. Identical UV-triangles of inputs that sample the
+// same texture with the same settings are resampled once, and identical OMMs are shared across all inputs. The result holds
+// a single OMM array and one index buffer per input, see ommCpuGetBakeBatchResultDesc.
+// All inputs must use the same bakeFlags, rejectionThreshold and nearDuplicateDeduplicationFactor. maxArrayDataSize and
+// maxWorkingSetBytes are not supported.
+OMM_API ommResult ommCpuBakeBatch(ommBaker baker, const ommCpuBakeInputDesc* bakeInputDescs, uint32_t bakeInputDescCount, ommCpuBakeResult* outBakeResult);
+
 OMM_API ommResult ommCpuDestroyBakeResult(ommCpuBakeResult bakeResult);
 
 OMM_API ommResult ommCpuGetBakeResultDesc(ommCpuBakeResult bakeResult, const ommCpuBakeResultDesc** desc);
 
+// Returns one result desc per input of ommCpuBakeBatch, in input order. arrayData, descArray and descArrayHistogram point to
+// the same shared OMM array for all of them, indexBuffer and indexHistogram are per input. For results of other bake calls
+// a single desc is returned. ommCpuGetBakeResultDesc returns the first desc.
+OMM_API ommResult ommCpuGetBakeBatchResultDesc(ommCpuBakeResult bakeResult, const ommCpuBakeResultDesc** descs, uint32_t* descCount);
+
 // Serialization API useful to distribute input and /or output data for debugging& visualization purposes
 
 // Serialization
@@ -1178,6 +1354,9 @@ typedef struct ommDebugStats
    uint32_t totalFullyUnknownOpaque;
    uint32_t totalFullyUnknownTransparent;
    float knownAreaMetric; // this is known area in uv space, divided by the total uv space. -1.f if unknown
+   // Work counters of a CPU bake, only filled by ommDebugGetStats2 and summed over the inputs of a batch bake.
+   uint32_t triangleCacheHits;     // work items whose states were loaded from the texture triangle cache
+   uint32_t triangleCacheLookups;  // work items looked up in the texture triangle cache
 } ommDebugStats;
 
 inline ommDebugStats ommDebugStatsDefault()
@@ -1192,6 +1371,8 @@ inline ommDebugStats ommDebugStatsDefault()
    v.totalFullyUnknownOpaque       = 0;
    v.totalFullyUnknownTransparent  = 0;
    v.knownAreaMetric               = 0;
+   v.triangleCacheHits             = 0;
+   v.triangleCacheLookups          = 0;
    return v;
 }
 
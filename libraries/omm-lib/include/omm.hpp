@@ -24,6 +24,8 @@ namespace omm
       INSUFFICIENT_SCRATCH_MEMORY,
       NOT_IMPLEMENTED,
       WORKLOAD_TOO_BIG,
+      NOT_READY,
+      CANCELLED,
       MAX_NUM,
    };
 
@@ -165,11 +167,62 @@ namespace omm
        void*              userArg          = nullptr;
    };
 
+   typedef void(*TaskCallback)(uint32_t taskIndex, void* taskArg);
+
+   // Must invoke task(taskIndex, taskArg) for every taskIndex in [0, taskCount) and return once all invocations have completed.
+   // Invocations may run concurrently and in any order.
+   typedef void(*ParallelForCallback)(void* userArg, uint32_t taskCount, TaskCallback task, void* taskArg);
+
+   // Must schedule task(0, taskArg) for execution and return a handle that is later passed to waitTask.
+   typedef void*(*SubmitTaskCallback)(void* userArg, TaskCallback task, void* taskArg);
+
+   // Must block until the submitted task has completed. Called exactly once per submitted task.
+   typedef void(*WaitTaskCallback)(void* userArg, void* task);
+
+   // Lets the CPU baker share the host's thread pool. When set, the parallel regions of bakes with
+   // Cpu::BakeFlags::EnableInternalThreads and of textures with Cpu::TextureFlags::EnableInternalThreads are executed
+   // through these callbacks instead of internally spawned threads.
+   struct TaskInterface
+   {
+      // Used when set. Otherwise submitTask and waitTask are used, if set.
+      ParallelForCallback parallelFor  = nullptr;
+      SubmitTaskCallback  submitTask   = nullptr;
+      WaitTaskCallback    waitTask     = nullptr;
+      // Number of threads the host intends to run the work on, used to size the work split. 0 = hardware concurrency.
+      uint32_t            workerCount  = 0;
+      void*               userArg      = nullptr;
+   };
+
+   // Must return true when key is present in the cache and write the size of the stored value to *size.
+   // When data is not nullptr, *size holds the capacity of data and the stored value must also be copied to data.
+   typedef bool(*BakeCacheLoadCallback)(void* userArg, uint64_t key, void* data, uint64_t* size);
+
+   // Must store a copy of the value under key. May be called concurrently from bakes running in parallel.
+   typedef void(*BakeCacheStoreCallback)(void* userArg, uint64_t key, const void* data, uint64_t size);
+
+   // Persistent cache of CPU bake results. Before baking, the baker hashes the texture contents, the UV and index streams
+   // and the bake settings, and returns the stored result of an identical earlier bake instead of baking again.
+   // Results are stored as serialized blobs (see Cpu::Serialize) and are invalidated by SDK version changes.
+   struct BakeCacheInterface
+   {
+      // Used when both are set.
+      BakeCacheLoadCallback  load       = nullptr;
+      BakeCacheStoreCallback store      = nullptr;
+      // Used when load and store are not set. Results are stored as one file per key in this directory, which is created
+      // if missing.
+      const char*            directory  = nullptr;
+      void*                  userArg    = nullptr;
+   };
+
    struct BakerCreationDesc
    {
       BakerType                type                      = BakerType::MAX_NUM;
       MemoryAllocatorInterface memoryAllocatorInterface  = {};
       MessageInterface         messageInterface          = {};
+      // Optional, CPU baker only.
+      TaskInterface            taskInterface             = {};
+      // Optional, CPU baker only. Cpu::BakeBatch doesn't use the cache.
+      BakeCacheInterface       cacheInterface            = {};
    };
 
    typedef ommBaker Baker;
@@ -194,6 +247,14 @@ namespace omm
       {
          UNORM8,
          FP32,
+         // Block compressed formats are sampled without decompressing the texture. rowPitch is the byte stride of a row of 4x4
+         // blocks.
+         BC4_UNORM,
+         // The alpha channel of BC3 (DXT5) blocks is sampled, the color channels are ignored.
+         BC3_UNORM,
+         // One bit per texel for pre-thresholded alpha, 0 or 1. Texels are packed from the least significant bit of each byte and
+         // rowPitch is in bytes.
+         R1_UNORM,
          MAX_NUM,
       };
 
@@ -201,8 +262,25 @@ namespace omm
       {
          None,
          // Controls the internal memory layout of the texture. does not change the expected input format, it does affect the baking
-         // performance and memory footprint of the texture object.
+         // performance and memory footprint of the texture object. Block compressed and R1 textures always keep their input
+         // layout. Textures that Z-order would pad by more than a quarter, such as non-square ones, are stored in 8x8 tiles instead.
          DisableZOrder = 1u << 0,
+         // Keeps the micro-triangle states of every UV-triangle baked with the texture. Later bakes with the same settings reuse
+         // them for unchanged UV-triangles, so re-baking an edited mesh only resamples what changed. The memory grows with the
+         // number of unique UV-triangles baked and is released when the texture is destroyed. Bakes with
+         // BakeFlags::EnableValidation report how many UV-triangles were found in the cache through the message interface.
+         EnableTriangleCache = 1u << 1,
+         // Builds a min/max pyramid of the alpha values when the texture is created. Bakes use it to classify micro-triangles whose
+         // texels are all above or all below the alpha cutoff without rasterizing them. The pyramid does not depend on the alpha
+         // cutoff and takes about 2.7 bytes per texel.
+         EnableMinMaxPyramid = 1u << 2,
+         // Reads the texels from the caller's textureData instead of copying them, only the acceleration data is allocated. Requires
+         // DisableZOrder for UNORM8 and FP32. The memory must stay valid and unchanged until the texture is destroyed. rowPitch is
+         // in bytes and must be a multiple of the texel size, as must the textureData address.
+         BorrowTextureData = 1u << 3,
+         // Copies, swizzles and builds the acceleration data of large mips in parallel, through the baker's TaskInterface when
+         // one was provided and on internal threads otherwise. Applies to the textures of deserialized bake inputs as well.
+         EnableInternalThreads = 1u << 4,
       };
       OMM_DEFINE_ENUM_FLAG_OPERATORS(TextureFlags);
 
@@ -240,6 +318,11 @@ namespace omm
          // Allow 8-bit index format for the output OMM index buffer
          Allow8BitIndices             = 1u << 6,
 
+         // Used together with EnableNearDuplicateDetection. Instead of locality sensitive hashing the similar OMMs are found with an
+         // exact nearest neighbour search per subdivision level, so no pair closer than nearDuplicateDeduplicationFactor is missed.
+         // Typically merges more OMMs at a higher CPU cost.
+         EnableNearDuplicateDetectionExact = 1u << 10,
+
          EnableWorkloadValidation OMM_DEPRECATED_MSG("EnableWorkloadValidation is deprecated, use EnableValidation instead") = 1u << 5,
       };
       OMM_DEFINE_ENUM_FLAG_OPERATORS(BakeFlags);
@@ -269,7 +352,8 @@ namespace omm
          const TextureMipDesc* mips         = nullptr;
          uint32_t              mipCount     = 0;
          // Setting the alphaCutoff [0,1] allows the alpha cutoff to be embeded in the texture object which may accelerate the
-         // baking operation in some circumstances. Note: if set it must match the alphaCutoff in the bake desc exactly.
+         // baking operation in some circumstances. Bakes at a different alphaCutoff are valid but don't benefit from it, see
+         // EnableMinMaxPyramid for an acceleration structure that serves any alphaCutoff.
          float                 alphaCutoff  = -1.f;
       };
 
@@ -353,6 +437,13 @@ namespace omm
          // * Subdivision level of the OMMs.
          // Configure this value when experiencing long bake times, a starting point might be maxWorkloadSize = 1 << 28 (~ processing a total of 256 1k textures)
          uint64_t              maxWorkloadSize               = 0xFFFFFFFFFFFFFFFF;
+         // [optional] Use maxWorkingSetBytes to bound the peak memory used by the baker for intermediate micro-triangle state.
+         // When set the primitives are processed in spatially coherent chunks that fit within the budget, each finished chunk is
+         // deduplicated against the OMMs baked so far and appended to the output. Each primitive gets the same OMM as without the budget.
+         // The budget is a heuristic: it covers an estimate of the per-primitive state and lookup tables of a chunk and of the
+         // table of OMMs baked so far, but not the output itself. A single primitive exceeding it is still processed.
+         // Not supported together with EnableNearDuplicateDetection or maxArrayDataSize.
+         uint64_t              maxWorkingSetBytes            = 0xFFFFFFFFFFFFFFFF;
       };
 
       struct OpacityMicromapDesc
@@ -395,6 +486,24 @@ namespace omm
          uint32_t                         indexHistogramCount;
       };
 
+      enum class BakeStage
+      {
+         Setup,
+         Coarse,
+         Fine,
+         Deduplicate,
+         Compress,
+         Serialize,
+         Done,
+         MAX_NUM,
+      };
+
+      struct BakeProgress
+      {
+         BakeStage stage         = BakeStage::Setup;
+         float     stageProgress = 0.f;
+      };
+
       struct BlobDesc
       {
           void*     data = nullptr;
@@ -420,10 +529,20 @@ namespace omm
 
       static inline Result Bake(Baker baker, const BakeInputDesc& bakeInputDesc, BakeResult* outBakeResult);
 
+      static inline Result BakeAsync(Baker baker, const BakeInputDesc& bakeInputDesc, BakeResult* outBakeResult);
+
+      static inline Result PollBake(BakeResult bakeResult, BakeProgress* outProgress);
+
+      static inline Result CancelBake(BakeResult bakeResult);
+
+      static inline Result BakeBatch(Baker baker, const BakeInputDesc* bakeInputDescs, uint32_t bakeInputDescCount, BakeResult* outBakeResult);
+
       static inline Result DestroyBakeResult(BakeResult bakeResult);
 
       static inline Result GetBakeResultDesc(BakeResult bakeResult, const BakeResultDesc** desc);
 
+      static inline Result GetBakeBatchResultDesc(BakeResult bakeResult, const BakeResultDesc** descs, uint32_t* descCount);
+
       static inline Result Serialize(ommBaker baker, const DeserializedDesc& inputDesc, SerializedResult* outResult);
 
       static inline Result GetSerializedResultDesc(SerializedResult result, const BlobDesc** desc);
@@ -961,6 +1080,9 @@ namespace omm
          uint32_t totalFullyUnknownOpaque       = 0;
          uint32_t totalFullyUnknownTransparent  = 0;
          float    knownAreaMetric               = -1.f;
+         // Work counters of a CPU bake, only filled by GetStats2 and summed over the inputs of a batch bake.
+         uint32_t triangleCacheHits             = 0;
+         uint32_t triangleCacheLookups          = 0;
       };
 
       static inline Result GetStats(Baker baker, const Cpu::BakeResultDesc* res, Stats* out);
@@ -1004,6 +1126,23 @@ namespace omm
         {
             return (Result)ommCpuBake((ommBaker)baker, reinterpret_cast<const ommCpuBakeInputDesc*>(&bakeInputDesc), (ommCpuBakeResult*)outBakeResult);
         }
+        static inline Result BakeAsync(Baker baker, const BakeInputDesc& bakeInputDesc, BakeResult* outBakeResult)
+        {
+            return (Result)ommCpuBakeAsync((ommBaker)baker, reinterpret_cast<const ommCpuBakeInputDesc*>(&bakeInputDesc), (ommCpuBakeResult*)outBakeResult);
+        }
+        static inline Result PollBake(BakeResult bakeResult, BakeProgress* outProgress)
+        {
+            static_assert(sizeof(BakeProgress) == sizeof(ommCpuBakeProgress));
+            return (Result)ommCpuPollBake((ommCpuBakeResult)bakeResult, reinterpret_cast<ommCpuBakeProgress*>(outProgress));
+        }
+        static inline Result CancelBake(BakeResult bakeResult)
+        {
+            return (Result)ommCpuCancelBake((ommCpuBakeResult)bakeResult);
+        }
+        static inline Result BakeBatch(Baker baker, const BakeInputDesc* bakeInputDescs, uint32_t bakeInputDescCount, BakeResult* outBakeResult)
+        {
+            return (Result)ommCpuBakeBatch((ommBaker)baker, reinterpret_cast<const ommCpuBakeInputDesc*>(bakeInputDescs), bakeInputDescCount, (ommCpuBakeResult*)outBakeResult);
+        }
         static inline Result DestroyBakeResult(BakeResult bakeResult)
         {
             return (Result)ommCpuDestroyBakeResult((ommCpuBakeResult)bakeResult);
@@ -1012,6 +1151,10 @@ namespace omm
         {
             return (Result)ommCpuGetBakeResultDesc((ommCpuBakeResult)bakeResult, reinterpret_cast<const ommCpuBakeResultDesc**>(desc));
         }
+        static inline Result GetBakeBatchResultDesc(BakeResult bakeResult, const BakeResultDesc** descs, uint32_t* descCount)
+        {
+            return (Result)ommCpuGetBakeBatchResultDesc((ommCpuBakeResult)bakeResult, reinterpret_cast<const ommCpuBakeResultDesc**>(descs), descCount);
+        }
         static inline Result Serialize(ommBaker baker, const DeserializedDesc& desc, SerializedResult* outResult)
         {
             return (Result)ommCpuSerialize(baker, reinterpret_cast<const ommCpuDeserializedDesc&>(desc), reinterpret_cast<ommCpuSerializedResult*>(outResult));
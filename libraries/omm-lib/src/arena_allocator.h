@@ -0,0 +1,291 @@
+/*
+Copyright (c) 2026, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include "std_allocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <mutex>
+
+// Allocator for the transient allocations of a bake.
+// Small allocations are carved from blocks taken from the backing allocator, so the thousands of small containers a bake
+// creates cost a pointer bump each instead of a call in to the backing allocator. Freed small allocations go to a free list
+// per size class and are handed out again, the blocks themselves are only given back by Reset. Allocations above
+// kLargeAllocationSize get a block of their own which is released as soon as it is freed.
+// Threads allocate from one of kShardCount shards picked per thread, so the resampling workers rarely share a lock.
+class ArenaAllocator
+{
+public:
+    ArenaAllocator(const StdAllocator<uint8_t>& backingAllocator) :
+        m_backingAllocator(backingAllocator),
+        m_allocator(StdMemoryAllocatorInterface{ &ArenaAllocator::AllocateCallback, &ArenaAllocator::ReallocateCallback, &ArenaAllocator::FreeCallback, this })
+    {
+    }
+
+    ArenaAllocator(const ArenaAllocator&) = delete;
+    ArenaAllocator& operator=(const ArenaAllocator&) = delete;
+
+    ~ArenaAllocator()
+    {
+        Reset();
+    }
+
+    // Allocations made through the returned allocator are invalidated by Reset.
+    const StdAllocator<uint8_t>& GetStdAllocator() const
+    {
+        return m_allocator;
+    }
+
+    // Returns all blocks to the backing allocator.
+    void Reset()
+    {
+        for (Shard& shard : m_shards)
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            FreeBlocks(shard.blocks);
+            shard.cursor = nullptr;
+            shard.end = nullptr;
+            shard.nextBlockSize = kMinBlockSize;
+            std::fill(std::begin(shard.freeChunks), std::end(shard.freeChunks), nullptr);
+        }
+
+        std::lock_guard<std::mutex> lock(m_largeMutex);
+        FreeBlocks(m_largeBlocks);
+    }
+
+private:
+    static constexpr size_t kMinBlockSize = 64 * 1024;
+    static constexpr size_t kMaxBlockSize = 4 * 1024 * 1024;
+    static constexpr size_t kLargeAllocationSize = 256 * 1024;
+    static constexpr uint32_t kShardCount = 16;
+    // Size classes step by a quarter of the power of two below them, from kMinChunkSize up to kLargeAllocationSize.
+    static constexpr uint32_t kMinChunkSizeLog2 = 5;
+    static constexpr size_t kMinChunkSize = size_t(1) << kMinChunkSizeLog2;
+    static constexpr uint32_t kSizeClassCount = 4 * (std::bit_width(kLargeAllocationSize - 1) - kMinChunkSizeLog2) + 1;
+    static constexpr uint32_t kLargeSizeClass = ~0u;
+
+    struct Block
+    {
+        Block* prev;
+        Block* next;
+    };
+
+    struct FreeChunk
+    {
+        FreeChunk* next;
+    };
+
+    struct alignas(64) Shard
+    {
+        std::mutex mutex;
+        Block* blocks = nullptr;
+        uint8_t* cursor = nullptr;
+        uint8_t* end = nullptr;
+        size_t nextBlockSize = kMinBlockSize;
+        FreeChunk* freeChunks[kSizeClassCount] = {};
+    };
+
+    // Precedes every allocation. owner is the Block of a large allocation, or the Shard a chunk was carved from.
+    struct Header
+    {
+        void* owner;
+        size_t size;
+        uint32_t sizeClass;
+        // Distance from the start of the chunk to the allocation.
+        uint32_t chunkOffset;
+    };
+
+    static uint32_t GetSizeClass(size_t size)
+    {
+        if (size <= kMinChunkSize)
+            return 0;
+        const uint32_t log2 = (uint32_t)std::bit_width(size - 1) - 1;
+        const uint32_t quarter = (uint32_t)((size - 1) >> (log2 - 2)) & 3;
+        return 4 * (log2 - kMinChunkSizeLog2) + quarter + 1;
+    }
+
+    static size_t GetChunkSize(uint32_t sizeClass)
+    {
+        if (sizeClass == 0)
+            return kMinChunkSize;
+        const uint32_t log2 = (sizeClass - 1) / 4 + kMinChunkSizeLog2;
+        const uint32_t quarter = (sizeClass - 1) % 4;
+        return size_t(5 + quarter) << (log2 - 2);
+    }
+
+    static uint32_t GetThreadShard()
+    {
+        static std::atomic<uint32_t> nextShard = 0;
+        thread_local const uint32_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % kShardCount;
+        return shard;
+    }
+
+    static void* AllocateCallback(void* userArg, size_t size, size_t alignment)
+    {
+        return ((ArenaAllocator*)userArg)->Allocate(size, alignment);
+    }
+
+    static void* ReallocateCallback(void* userArg, void* memory, size_t size, size_t alignment)
+    {
+        ArenaAllocator* arena = (ArenaAllocator*)userArg;
+        if (memory != nullptr)
+        {
+            // Grow or shrink in place when the chunk has the room.
+            Header* header = (Header*)memory - 1;
+            if (header->sizeClass != kLargeSizeClass && (size_t)memory % alignment == 0 && size <= GetChunkSize(header->sizeClass) - header->chunkOffset)
+            {
+                header->size = size;
+                return memory;
+            }
+        }
+
+        void* newMemory = arena->Allocate(size, alignment);
+        if (newMemory == nullptr || memory == nullptr)
+            return newMemory;
+
+        const Header* header = (const Header*)memory - 1;
+        std::memcpy(newMemory, memory, std::min(header->size, size));
+        arena->Free(memory);
+        return newMemory;
+    }
+
+    static void FreeCallback(void* userArg, void* memory)
+    {
+        ((ArenaAllocator*)userArg)->Free(memory);
+    }
+
+    void* Allocate(size_t size, size_t alignment)
+    {
+        alignment = std::max(alignment, alignof(Header));
+        const size_t paddedSize = sizeof(Header) + alignment - 1 + size;
+
+        if (paddedSize > kLargeAllocationSize)
+        {
+            Block* largeBlock = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(m_largeMutex);
+                largeBlock = AllocateBlock(paddedSize, m_largeBlocks);
+            }
+            if (largeBlock == nullptr)
+                return nullptr;
+            return InitHeader((uint8_t*)(largeBlock + 1), largeBlock, size, alignment, kLargeSizeClass);
+        }
+
+        const uint32_t sizeClass = GetSizeClass(paddedSize);
+        const size_t chunkSize = GetChunkSize(sizeClass);
+
+        Shard& shard = m_shards[GetThreadShard()];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        uint8_t* chunk = (uint8_t*)shard.freeChunks[sizeClass];
+        if (chunk != nullptr)
+        {
+            shard.freeChunks[sizeClass] = shard.freeChunks[sizeClass]->next;
+        }
+        else
+        {
+            if (size_t(shard.end - shard.cursor) < chunkSize)
+            {
+                const size_t blockSize = std::max(shard.nextBlockSize, chunkSize);
+                Block* block = AllocateBlock(blockSize, shard.blocks);
+                if (block == nullptr)
+                    return nullptr;
+                shard.cursor = (uint8_t*)(block + 1);
+                shard.end = shard.cursor + blockSize;
+                shard.nextBlockSize = std::min(2 * shard.nextBlockSize, kMaxBlockSize);
+            }
+            chunk = shard.cursor;
+            shard.cursor += chunkSize;
+        }
+
+        return InitHeader(chunk, &shard, size, alignment, sizeClass);
+    }
+
+    static void* InitHeader(uint8_t* chunk, void* owner, size_t size, size_t alignment, uint32_t sizeClass)
+    {
+        uint8_t* alignedMemory = Align(chunk + sizeof(Header), alignment);
+        Header* header = (Header*)alignedMemory - 1;
+        header->owner = owner;
+        header->size = size;
+        header->sizeClass = sizeClass;
+        header->chunkOffset = (uint32_t)(alignedMemory - chunk);
+        return alignedMemory;
+    }
+
+    void Free(void* memory)
+    {
+        if (memory == nullptr)
+            return;
+
+        const Header* header = (const Header*)memory - 1;
+        if (header->sizeClass == kLargeSizeClass)
+        {
+            Block* block = (Block*)header->owner;
+            std::lock_guard<std::mutex> lock(m_largeMutex);
+            if (block->prev != nullptr)
+                block->prev->next = block->next;
+            else
+                m_largeBlocks = block->next;
+            if (block->next != nullptr)
+                block->next->prev = block->prev;
+            FreeBlock(block);
+            return;
+        }
+
+        // Back to the shard the chunk was carved from, which may belong to another thread.
+        Shard& shard = *(Shard*)header->owner;
+        FreeChunk* chunk = (FreeChunk*)((uint8_t*)memory - header->chunkOffset);
+        const uint32_t sizeClass = header->sizeClass;
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        chunk->next = shard.freeChunks[sizeClass];
+        shard.freeChunks[sizeClass] = chunk;
+    }
+
+    Block* AllocateBlock(size_t size, Block*& list)
+    {
+        const StdMemoryAllocatorInterface& backing = m_backingAllocator.GetInterface();
+        Block* block = (Block*)backing.Allocate(backing.UserArg, sizeof(Block) + size, alignof(Block));
+        if (block == nullptr)
+            return nullptr;
+
+        block->prev = nullptr;
+        block->next = list;
+        if (list != nullptr)
+            list->prev = block;
+        list = block;
+        return block;
+    }
+
+    void FreeBlock(Block* block)
+    {
+        const StdMemoryAllocatorInterface& backing = m_backingAllocator.GetInterface();
+        backing.Free(backing.UserArg, block);
+    }
+
+    void FreeBlocks(Block*& list)
+    {
+        while (list != nullptr)
+        {
+            Block* next = list->next;
+            FreeBlock(list);
+            list = next;
+        }
+    }
+
+    StdAllocator<uint8_t> m_backingAllocator;
+    StdAllocator<uint8_t> m_allocator;
+    Shard m_shards[kShardCount];
+    std::mutex m_largeMutex;
+    Block* m_largeBlocks = nullptr;
+};
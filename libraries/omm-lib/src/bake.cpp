@@ -56,7 +56,7 @@ OMM_API ommResult OMM_CALL ommCpuCreateTexture(ommBaker baker, const ommCpuTextu
     StdAllocator<uint8_t>& memoryAllocator = (*impl).GetStdAllocator();
 
     TextureImpl* implementation = Allocate<TextureImpl>(memoryAllocator, memoryAllocator, impl->GetLog());
-    const ommResult result = implementation->Create(*desc);
+    const ommResult result = implementation->Create(*desc, impl->GetScheduler());
 
     if (result == ommResult_SUCCESS)
     {
@@ -115,6 +115,57 @@ OMM_API ommResult OMM_CALL ommCpuBake(ommBaker baker, const ommCpuBakeInputDesc*
     return (*impl).BakeOpacityMicromap(*bakeInputDesc, bakeResult);
 }
 
+OMM_API ommResult OMM_CALL ommCpuBakeAsync(ommBaker baker, const ommCpuBakeInputDesc* bakeInputDesc, ommCpuBakeResult* bakeResult)
+{
+    if (baker == 0)
+        return ommResult_INVALID_ARGUMENT;
+
+    Cpu::BakerImpl* impl = GetHandleImpl<Cpu::BakerImpl>(baker);
+
+    if (bakeInputDesc == 0)
+        return impl->GetLog().InvalidArg("input desc was not set");
+    if (bakeResult == 0)
+        return impl->GetLog().InvalidArg("bake result was not set");
+    if (GetHandleType(baker) != HandleType::CpuBaker)
+        return impl->GetLog().InvalidArg("Baker was not created as the right type");
+
+    return (*impl).BakeOpacityMicromapAsync(*bakeInputDesc, bakeResult);
+}
+
+OMM_API ommResult OMM_CALL ommCpuPollBake(ommCpuBakeResult bakeResult, ommCpuBakeProgress* outProgress)
+{
+    if (bakeResult == 0)
+        return ommResult_INVALID_ARGUMENT;
+
+    return (*(omm::Cpu::BakeOutputImpl*)bakeResult).Poll(outProgress);
+}
+
+OMM_API ommResult OMM_CALL ommCpuCancelBake(ommCpuBakeResult bakeResult)
+{
+    if (bakeResult == 0)
+        return ommResult_INVALID_ARGUMENT;
+
+    (*(omm::Cpu::BakeOutputImpl*)bakeResult).Cancel();
+    return ommResult_SUCCESS;
+}
+
+OMM_API ommResult OMM_CALL ommCpuBakeBatch(ommBaker baker, const ommCpuBakeInputDesc* bakeInputDescs, uint32_t bakeInputDescCount, ommCpuBakeResult* bakeResult)
+{
+    if (baker == 0)
+        return ommResult_INVALID_ARGUMENT;
+
+    Cpu::BakerImpl* impl = GetHandleImpl<Cpu::BakerImpl>(baker);
+
+    if (bakeInputDescs == 0 || bakeInputDescCount == 0)
+        return impl->GetLog().InvalidArg("input descs were not set");
+    if (bakeResult == 0)
+        return impl->GetLog().InvalidArg("bake result was not set");
+    if (GetHandleType(baker) != HandleType::CpuBaker)
+        return impl->GetLog().InvalidArg("Baker was not created as the right type");
+
+    return (*impl).BakeOpacityMicromapBatch(bakeInputDescs, bakeInputDescCount, bakeResult);
+}
+
 OMM_API ommResult OMM_CALL ommCpuDestroyBakeResult(ommCpuBakeResult bakeResult)
 {
     if (bakeResult == 0)
@@ -134,6 +185,14 @@ OMM_API ommResult OMM_CALL ommCpuGetBakeResultDesc(ommCpuBakeResult bakeResult,
     return (*(omm::Cpu::BakeOutputImpl*)bakeResult).GetBakeResultDesc(desc);
 }
 
+OMM_API ommResult OMM_CALL ommCpuGetBakeBatchResultDesc(ommCpuBakeResult bakeResult, const ommCpuBakeResultDesc** descs, uint32_t* descCount)
+{
+    if (bakeResult == 0)
+        return ommResult_INVALID_ARGUMENT;
+
+    return (*(omm::Cpu::BakeOutputImpl*)bakeResult).GetBakeBatchResultDesc(descs, descCount);
+}
+
 OMM_API ommResult OMM_CALL ommCpuSerialize(ommBaker baker, const ommCpuDeserializedDesc& desc, ommCpuSerializedResult* outResult)
 {
     if (baker == 0)
@@ -204,7 +263,7 @@ OMM_API ommResult ommCpuDeserialize(ommBaker baker, const ommCpuBlobDesc& desc,
 
     StdAllocator<uint8_t>& memoryAllocator = (*impl).GetStdAllocator();
 
-    omm::Cpu::DeserializedResultImpl* desImpl = Allocate<omm::Cpu::DeserializedResultImpl>(memoryAllocator, memoryAllocator, impl->GetLog());
+    omm::Cpu::DeserializedResultImpl* desImpl = Allocate<omm::Cpu::DeserializedResultImpl>(memoryAllocator, memoryAllocator, impl->GetLog(), impl->GetScheduler());
 
     ommResult res = desImpl->Deserialize(desc);
 
@@ -373,16 +432,19 @@ OMM_API ommResult ommDebugGetStats2(ommBaker baker, ommCpuBakeResult res, ommDeb
     {
         Cpu::BakerImpl* impl = GetHandleImpl<Cpu::BakerImpl>(baker);
         StdAllocator<uint8_t>& memoryAllocator = (*impl).GetStdAllocator();
-        return GetStatsImpl(memoryAllocator, desc, area, out);
+        RETURN_STATUS_IF_FAILED(GetStatsImpl(memoryAllocator, desc, area, out));
     }
     else if (GetHandleType(baker) == HandleType::GpuBaker)
     {
         Gpu::BakerImpl* impl = GetHandleImpl<Gpu::BakerImpl>(baker);
         StdAllocator<uint8_t>& memoryAllocator = (*impl).GetStdAllocator();
-        return GetStatsImpl(memoryAllocator, desc, area, out);
+        RETURN_STATUS_IF_FAILED(GetStatsImpl(memoryAllocator, desc, area, out));
     }
     else
         return ommResult_INVALID_ARGUMENT;
+
+    resImpl->GetCounters(*out);
+    return ommResult_SUCCESS;
 }
 
 OMM_API ommResult OMM_CALL ommDebugSaveBinaryToDisk(ommBaker baker, const ommCpuBlobDesc& data, const char* path)
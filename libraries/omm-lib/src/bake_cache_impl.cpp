@@ -0,0 +1,152 @@
+/*
+Copyright (c) 2026, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "bake_cache_impl.h"
+#include "serialize_impl.h"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+namespace omm
+{
+namespace Cpu
+{
+    // Returns a temporary path next to path that no other writer uses. The name combines a random per-process nonce with a
+    // per-process counter, so it's unique across the threads of this process and across processes sharing the directory.
+    static std::filesystem::path GetUniqueTmpPath(const std::filesystem::path& path)
+    {
+        static const uint64_t processNonce = []() {
+            std::random_device device;
+            return ((uint64_t)device() << 32) | (uint64_t)device();
+        }();
+        static std::atomic<uint64_t> counter = 0;
+
+        char suffix[64];
+        snprintf(suffix, sizeof(suffix), ".%016llx.%llu.tmp", (unsigned long long)processNonce, (unsigned long long)counter.fetch_add(1, std::memory_order_relaxed));
+
+        std::filesystem::path tmpPath = path;
+        tmpPath += suffix;
+        return tmpPath;
+    }
+
+    BakeCacheImpl::BakeCacheImpl(const StdAllocator<uint8_t>& stdAllocator) :
+        m_stdAllocator(stdAllocator),
+        m_cacheInterface(ommBakeCacheInterfaceDefault())
+    {
+    }
+
+    ommResult BakeCacheImpl::Create(const ommBakeCacheInterface& cacheInterface, const Logger& log)
+    {
+        m_log = log;
+
+        if ((cacheInterface.load == nullptr) != (cacheInterface.store == nullptr))
+            return m_log.InvalidArg("[Invalid Argument] - cacheInterface.load and cacheInterface.store must be set together");
+
+        m_cacheInterface = cacheInterface;
+        m_useCallbacks = cacheInterface.load != nullptr;
+        m_directory.clear();
+
+        if (!m_useCallbacks && cacheInterface.directory != nullptr && cacheInterface.directory[0] != '\0')
+        {
+            std::error_code ec;
+            m_directory = std::filesystem::path(cacheInterface.directory);
+            std::filesystem::create_directories(m_directory, ec);
+            if (!std::filesystem::is_directory(m_directory, ec))
+                return m_log.InvalidArgf("[Invalid Argument] - cacheInterface.directory (%s) is not a directory and could not be created", cacheInterface.directory);
+        }
+
+        return ommResult_SUCCESS;
+    }
+
+    std::filesystem::path BakeCacheImpl::GetPath(uint64_t key) const
+    {
+        char fileName[32];
+        snprintf(fileName, sizeof(fileName), "%016llx.omm", (unsigned long long)key);
+        return m_directory / fileName;
+    }
+
+    bool BakeCacheImpl::Load(uint64_t key, vector<uint8_t>& blob) const
+    {
+        if (m_useCallbacks)
+        {
+            uint64_t size = 0;
+            if (!m_cacheInterface.load(m_cacheInterface.userArg, key, nullptr, &size) || size == 0)
+                return false;
+
+            blob.resize(size);
+            if (!m_cacheInterface.load(m_cacheInterface.userArg, key, blob.data(), &size) || size != blob.size())
+                return false;
+            return true;
+        }
+
+        std::ifstream file(GetPath(key), std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+            return false;
+
+        const std::streamoff size = file.tellg();
+        if (size <= 0)
+            return false;
+
+        blob.resize((size_t)size);
+        file.seekg(0);
+        return (bool)file.read((char*)blob.data(), size);
+    }
+
+    void BakeCacheImpl::Store(uint64_t key, const ommCpuBakeResultDesc& resultDesc) const
+    {
+        ommCpuDeserializedDesc desc = ommCpuDeserializedDescDefault();
+        desc.flags = ommCpuSerializeFlags_Compress;
+        desc.numResultDescs = 1;
+        desc.resultDescs = &resultDesc;
+
+        SerializeResultImpl serialized(m_stdAllocator, m_log);
+        if (serialized.Serialize(desc) != ommResult_SUCCESS)
+        {
+            m_log.PerfWarnf("Failed to serialize the bake result for cache key %016llx", (unsigned long long)key);
+            return;
+        }
+
+        const ommCpuBlobDesc* blob = serialized.GetDesc();
+
+        if (m_useCallbacks)
+        {
+            m_cacheInterface.store(m_cacheInterface.userArg, key, blob->data, blob->size);
+            return;
+        }
+
+        // Write to a file private to this writer first, then move it in place, so concurrent bakes of the same input
+        // never observe a partially written entry.
+        const std::filesystem::path path = GetPath(key);
+        const std::filesystem::path tmpPath = GetUniqueTmpPath(path);
+
+        bool written = false;
+        {
+            std::ofstream file(tmpPath, std::ios::binary);
+            file.write((const char*)blob->data, blob->size);
+            file.close();
+            written = !file.fail();
+        }
+
+        std::error_code ec;
+        if (!written)
+        {
+            m_log.PerfWarnf("Failed to write bake cache entry %s", tmpPath.string().c_str());
+            std::filesystem::remove(tmpPath, ec);
+            return;
+        }
+
+        std::filesystem::rename(tmpPath, path, ec);
+        if (ec)
+            std::filesystem::remove(tmpPath, ec);
+    }
+} // namespace Cpu
+} // namespace omm
@@ -0,0 +1,55 @@
+/*
+Copyright (c) 2026, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include "omm.h"
+#include "std_containers.h"
+#include "log.h"
+
+#include "std_allocator.h"
+
+#include <filesystem>
+
+namespace omm
+{
+namespace Cpu
+{
+    // Key-value store of serialized bake results, backed by the ommBakeCacheInterface callbacks or a directory on disk.
+    // Copies are independent of the original, bake outputs keep their own so they may outlive the baker.
+    class BakeCacheImpl
+    {
+    public:
+        BakeCacheImpl(const StdAllocator<uint8_t>& stdAllocator);
+
+        ommResult Create(const ommBakeCacheInterface& cacheInterface, const Logger& log);
+
+        bool IsEnabled() const
+        {
+            return m_useCallbacks || !m_directory.empty();
+        }
+
+        // Returns true and the stored blob when key is present.
+        bool Load(uint64_t key, vector<uint8_t>& blob) const;
+
+        // Serializes resultDesc and stores it under key. Failures are logged and otherwise ignored, the cache is best effort.
+        void Store(uint64_t key, const ommCpuBakeResultDesc& resultDesc) const;
+
+    private:
+        std::filesystem::path GetPath(uint64_t key) const;
+
+        StdAllocator<uint8_t> m_stdAllocator;
+        Logger m_log;
+        ommBakeCacheInterface m_cacheInterface;
+        bool m_useCallbacks = false;
+        std::filesystem::path m_directory;
+    };
+} // namespace Cpu
+} // namespace omm
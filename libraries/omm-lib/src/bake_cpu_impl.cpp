@@ -12,10 +12,14 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 #include "bake_cpu_impl.h"
 #include "bake_kernels_cpu.h"
 #include "texture_impl.h"
+#include "serialize_impl.h"
 
 #include "util/math.h"
 #include "util/bird.h"
 #include "util/cpu_raster.h"
+#include "util/dedup.h"
+#include "util/hamming.h"
+#include "util/parallel.h"
 
 #include <xxhash.h>
 
@@ -25,6 +29,7 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 #include <atomic>
 #include <cmath>
 #include <cstring>
+#include <bit>
 
 namespace omm
 {
@@ -39,12 +44,12 @@ namespace Cpu
         DisableDuplicateDetection       = 1u << 3,
         EnableNearDuplicateDetection    = 1u << 4,
         EnableValidation                = 1u << 5,
+        EnableNearDuplicateDetectionExact = 1u << 10,
 
         // Internal / not publicly exposed options.
         EnableAABBTesting               = 1u << 7,
         DisableLevelLineIntersection    = 1u << 8,
         DisableFineClassification       = 1u << 9,
-        EnableNearDuplicateDetectionBruteForce = 1u << 10,
         EnableEdgeHeuristic             = 1u << 11
     };
 
@@ -56,6 +61,7 @@ namespace Cpu
         static_assert((uint32_t)BakeFlagsInternal::DisableDuplicateDetection == (uint32_t)ommCpuBakeFlags_DisableDuplicateDetection);
         static_assert((uint32_t)BakeFlagsInternal::EnableNearDuplicateDetection == (uint32_t)ommCpuBakeFlags_EnableNearDuplicateDetection);
         static_assert((uint32_t)BakeFlagsInternal::EnableValidation == (uint32_t)ommCpuBakeFlags_EnableValidation);
+        static_assert((uint32_t)BakeFlagsInternal::EnableNearDuplicateDetectionExact == (uint32_t)ommCpuBakeFlags_EnableNearDuplicateDetectionExact);
     }
 
     struct Options
@@ -65,7 +71,7 @@ namespace Cpu
             disableSpecialIndices(((uint32_t)flags& (uint32_t)BakeFlagsInternal::DisableSpecialIndices) == (uint32_t)BakeFlagsInternal::DisableSpecialIndices),
             disableDuplicateDetection(((uint32_t)flags& (uint32_t)BakeFlagsInternal::DisableDuplicateDetection) == (uint32_t)BakeFlagsInternal::DisableDuplicateDetection),
             enableNearDuplicateDetection(((uint32_t)flags& (uint32_t)BakeFlagsInternal::EnableNearDuplicateDetection) == (uint32_t)BakeFlagsInternal::EnableNearDuplicateDetection),
-            enableNearDuplicateDetectionBruteForce(((uint32_t)flags& (uint32_t)BakeFlagsInternal::EnableNearDuplicateDetectionBruteForce) == (uint32_t)BakeFlagsInternal::EnableNearDuplicateDetectionBruteForce),
+            enableNearDuplicateDetectionExact(((uint32_t)flags& (uint32_t)BakeFlagsInternal::EnableNearDuplicateDetectionExact) == (uint32_t)BakeFlagsInternal::EnableNearDuplicateDetectionExact),
             enableValidation(((uint32_t)flags& (uint32_t)BakeFlagsInternal::EnableValidation) == (uint32_t)BakeFlagsInternal::EnableValidation),
             enableAABBTesting(((uint32_t)flags& (uint32_t)BakeFlagsInternal::EnableAABBTesting) == (uint32_t)BakeFlagsInternal::EnableAABBTesting),
             disableLevelLineIntersection(((uint32_t)flags& (uint32_t)BakeFlagsInternal::DisableLevelLineIntersection) == (uint32_t)BakeFlagsInternal::DisableLevelLineIntersection),
@@ -76,7 +82,7 @@ namespace Cpu
         const bool disableSpecialIndices;
         const bool disableDuplicateDetection;
         const bool enableNearDuplicateDetection;
-        const bool enableNearDuplicateDetectionBruteForce;
+        const bool enableNearDuplicateDetectionExact;
         const bool enableValidation;
         const bool enableAABBTesting;
         const bool disableLevelLineIntersection;
@@ -91,6 +97,13 @@ namespace Cpu
     {
         m_log = Logger(desc.messageInterface);
 
+        if ((desc.taskInterface.submitTask == nullptr) != (desc.taskInterface.waitTask == nullptr))
+            return m_log.InvalidArg("[Invalid Argument] - taskInterface.submitTask and taskInterface.waitTask must be set together");
+
+        m_scheduler = parallel::Scheduler(m_stdAllocator, desc.taskInterface);
+
+        RETURN_STATUS_IF_FAILED(m_cache.Create(desc.cacheInterface, m_log));
+
         return ommResult_SUCCESS;
     }
 
@@ -105,7 +118,7 @@ namespace Cpu
     ommResult BakerImpl::BakeOpacityMicromap(const ommCpuBakeInputDesc& bakeInputDesc, ommCpuBakeResult* outBakeommResult)
     {
         RETURN_STATUS_IF_FAILED(Validate(bakeInputDesc));
-        BakeOutputImpl* implementation = Allocate<BakeOutputImpl>(m_stdAllocator, m_stdAllocator, m_log);
+        BakeOutputImpl* implementation = Allocate<BakeOutputImpl>(m_stdAllocator, m_stdAllocator, m_log, m_scheduler, m_cache);
         ommResult result = implementation->Bake(bakeInputDesc);
 
         if (result == ommResult_SUCCESS)
@@ -118,118 +131,88 @@ namespace Cpu
         return result;
     }
 
-    BakeOutputImpl::BakeOutputImpl(const StdAllocator<uint8_t>& stdAllocator, const Logger& log) :
+    ommResult BakerImpl::BakeOpacityMicromapBatch(const ommCpuBakeInputDesc* bakeInputDescs, uint32_t bakeInputDescCount, ommCpuBakeResult* outBakeommResult)
+    {
+        for (uint32_t descIt = 0; descIt < bakeInputDescCount; ++descIt)
+            RETURN_STATUS_IF_FAILED(Validate(bakeInputDescs[descIt]));
+        BakeOutputImpl* implementation = Allocate<BakeOutputImpl>(m_stdAllocator, m_stdAllocator, m_log, m_scheduler, m_cache);
+        ommResult result = implementation->BakeBatch(bakeInputDescs, bakeInputDescCount);
+
+        if (result == ommResult_SUCCESS)
+        {
+            *outBakeommResult = (ommCpuBakeResult)implementation;
+            return ommResult_SUCCESS;
+        }
+
+        Deallocate(m_stdAllocator, implementation);
+        return result;
+    }
+
+    ommResult BakerImpl::BakeOpacityMicromapAsync(const ommCpuBakeInputDesc& bakeInputDesc, ommCpuBakeResult* outBakeommResult)
+    {
+        RETURN_STATUS_IF_FAILED(Validate(bakeInputDesc));
+        BakeOutputImpl* implementation = Allocate<BakeOutputImpl>(m_stdAllocator, m_stdAllocator, m_log, m_scheduler, m_cache);
+        ommResult result = implementation->BakeAsync(bakeInputDesc);
+
+        if (result == ommResult_SUCCESS)
+        {
+            *outBakeommResult = (ommCpuBakeResult)implementation;
+            return ommResult_SUCCESS;
+        }
+
+        Deallocate(m_stdAllocator, implementation);
+        return result;
+    }
+
+    BakeOutputImpl::BakeOutputImpl(const StdAllocator<uint8_t>& stdAllocator, const Logger& log, const parallel::Scheduler& scheduler, const BakeCacheImpl& cache) :
         m_stdAllocator(stdAllocator),
+        m_arena(stdAllocator),
         m_log(log),
+        m_scheduler(scheduler),
+        m_cache(cache),
         m_bakeInputDesc({}),
         m_bakeResult(stdAllocator),
-        bakeDispatchTable(stdAllocator.GetInterface())
+        m_batchResults(stdAllocator),
+        m_batchResultDescs(stdAllocator),
+        m_asyncTask(stdAllocator)
     {
-        #define REGISTER_DISPATCH(x, y, z, w, a)                                                                                               \
-        RegisterDispatch<decltype(x), decltype(y), decltype(z), decltype(w), decltype(a)>(x, y, z, w, a, [&](const ommCpuBakeInputDesc& desc)->ommResult {  \
-            return BakeImpl<x, y, z, w, a>(desc);                                                                                              \
-        });                                                                                                                                 \
-
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::Linear, ommTextureAddressMode_Wrap, ommTextureFilterMode_Linear, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::Linear, ommTextureAddressMode_Mirror, ommTextureFilterMode_Linear, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::Linear, ommTextureAddressMode_Clamp, ommTextureFilterMode_Linear, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::Linear, ommTextureAddressMode_Border, ommTextureFilterMode_Linear, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::Linear, ommTextureAddressMode_MirrorOnce, ommTextureFilterMode_Linear, false);
-
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32,TilingMode::MortonZ, ommTextureAddressMode_Wrap, ommTextureFilterMode_Linear, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32,TilingMode::MortonZ, ommTextureAddressMode_Mirror, ommTextureFilterMode_Linear, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32,TilingMode::MortonZ, ommTextureAddressMode_Clamp, ommTextureFilterMode_Linear, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32,TilingMode::MortonZ, ommTextureAddressMode_Border, ommTextureFilterMode_Linear, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32,TilingMode::MortonZ, ommTextureAddressMode_MirrorOnce, ommTextureFilterMode_Linear, false);
-
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32,TilingMode::Linear, ommTextureAddressMode_Wrap, ommTextureFilterMode_Nearest, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32,TilingMode::Linear, ommTextureAddressMode_Mirror, ommTextureFilterMode_Nearest, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32,TilingMode::Linear, ommTextureAddressMode_Clamp, ommTextureFilterMode_Nearest, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32,TilingMode::Linear, ommTextureAddressMode_Border, ommTextureFilterMode_Nearest, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32,TilingMode::Linear, ommTextureAddressMode_MirrorOnce, ommTextureFilterMode_Nearest, false);
-
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32,TilingMode::MortonZ, ommTextureAddressMode_Wrap, ommTextureFilterMode_Nearest, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32,TilingMode::MortonZ, ommTextureAddressMode_Mirror, ommTextureFilterMode_Nearest, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32,TilingMode::MortonZ, ommTextureAddressMode_Clamp, ommTextureFilterMode_Nearest, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32,TilingMode::MortonZ, ommTextureAddressMode_Border, ommTextureFilterMode_Nearest, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32,TilingMode::MortonZ, ommTextureAddressMode_MirrorOnce, ommTextureFilterMode_Nearest, false);
-
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::Linear, ommTextureAddressMode_Wrap, ommTextureFilterMode_Linear, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::Linear, ommTextureAddressMode_Mirror, ommTextureFilterMode_Linear, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::Linear, ommTextureAddressMode_Clamp, ommTextureFilterMode_Linear, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::Linear, ommTextureAddressMode_Border, ommTextureFilterMode_Linear, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::Linear, ommTextureAddressMode_MirrorOnce, ommTextureFilterMode_Linear, false);
-
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8,TilingMode::MortonZ, ommTextureAddressMode_Wrap, ommTextureFilterMode_Linear, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8,TilingMode::MortonZ, ommTextureAddressMode_Mirror, ommTextureFilterMode_Linear, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8,TilingMode::MortonZ, ommTextureAddressMode_Clamp, ommTextureFilterMode_Linear, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8,TilingMode::MortonZ, ommTextureAddressMode_Border, ommTextureFilterMode_Linear, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8,TilingMode::MortonZ, ommTextureAddressMode_MirrorOnce, ommTextureFilterMode_Linear, false);
-
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8,TilingMode::Linear, ommTextureAddressMode_Wrap, ommTextureFilterMode_Nearest, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8,TilingMode::Linear, ommTextureAddressMode_Mirror, ommTextureFilterMode_Nearest, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8,TilingMode::Linear, ommTextureAddressMode_Clamp, ommTextureFilterMode_Nearest, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8,TilingMode::Linear, ommTextureAddressMode_Border, ommTextureFilterMode_Nearest, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8,TilingMode::Linear, ommTextureAddressMode_MirrorOnce, ommTextureFilterMode_Nearest, false);
-
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8,TilingMode::MortonZ, ommTextureAddressMode_Wrap, ommTextureFilterMode_Nearest, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8,TilingMode::MortonZ, ommTextureAddressMode_Mirror, ommTextureFilterMode_Nearest, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8,TilingMode::MortonZ, ommTextureAddressMode_Clamp, ommTextureFilterMode_Nearest, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8,TilingMode::MortonZ, ommTextureAddressMode_Border, ommTextureFilterMode_Nearest, false);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8,TilingMode::MortonZ, ommTextureAddressMode_MirrorOnce, ommTextureFilterMode_Nearest, false);
-
-
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::Linear, ommTextureAddressMode_Wrap, ommTextureFilterMode_Linear, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::Linear, ommTextureAddressMode_Mirror, ommTextureFilterMode_Linear, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::Linear, ommTextureAddressMode_Clamp, ommTextureFilterMode_Linear, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::Linear, ommTextureAddressMode_Border, ommTextureFilterMode_Linear, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::Linear, ommTextureAddressMode_MirrorOnce, ommTextureFilterMode_Linear, true);
-
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::MortonZ, ommTextureAddressMode_Wrap, ommTextureFilterMode_Linear, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::MortonZ, ommTextureAddressMode_Mirror, ommTextureFilterMode_Linear, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::MortonZ, ommTextureAddressMode_Clamp, ommTextureFilterMode_Linear, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::MortonZ, ommTextureAddressMode_Border, ommTextureFilterMode_Linear, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::MortonZ, ommTextureAddressMode_MirrorOnce, ommTextureFilterMode_Linear, true);
-
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::Linear, ommTextureAddressMode_Wrap, ommTextureFilterMode_Nearest, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::Linear, ommTextureAddressMode_Mirror, ommTextureFilterMode_Nearest, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::Linear, ommTextureAddressMode_Clamp, ommTextureFilterMode_Nearest, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::Linear, ommTextureAddressMode_Border, ommTextureFilterMode_Nearest, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::Linear, ommTextureAddressMode_MirrorOnce, ommTextureFilterMode_Nearest, true);
-
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::MortonZ, ommTextureAddressMode_Wrap, ommTextureFilterMode_Nearest, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::MortonZ, ommTextureAddressMode_Mirror, ommTextureFilterMode_Nearest, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::MortonZ, ommTextureAddressMode_Clamp, ommTextureFilterMode_Nearest, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::MortonZ, ommTextureAddressMode_Border, ommTextureFilterMode_Nearest, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_FP32, TilingMode::MortonZ, ommTextureAddressMode_MirrorOnce, ommTextureFilterMode_Nearest, true);
-
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::Linear, ommTextureAddressMode_Wrap, ommTextureFilterMode_Linear, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::Linear, ommTextureAddressMode_Mirror, ommTextureFilterMode_Linear, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::Linear, ommTextureAddressMode_Clamp, ommTextureFilterMode_Linear, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::Linear, ommTextureAddressMode_Border, ommTextureFilterMode_Linear, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::Linear, ommTextureAddressMode_MirrorOnce, ommTextureFilterMode_Linear, true);
-
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::MortonZ, ommTextureAddressMode_Wrap, ommTextureFilterMode_Linear, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::MortonZ, ommTextureAddressMode_Mirror, ommTextureFilterMode_Linear, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::MortonZ, ommTextureAddressMode_Clamp, ommTextureFilterMode_Linear, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::MortonZ, ommTextureAddressMode_Border, ommTextureFilterMode_Linear, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::MortonZ, ommTextureAddressMode_MirrorOnce, ommTextureFilterMode_Linear, true);
-
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::Linear, ommTextureAddressMode_Wrap, ommTextureFilterMode_Nearest, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::Linear, ommTextureAddressMode_Mirror, ommTextureFilterMode_Nearest, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::Linear, ommTextureAddressMode_Clamp, ommTextureFilterMode_Nearest, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::Linear, ommTextureAddressMode_Border, ommTextureFilterMode_Nearest, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::Linear, ommTextureAddressMode_MirrorOnce, ommTextureFilterMode_Nearest, true);
-
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::MortonZ, ommTextureAddressMode_Wrap, ommTextureFilterMode_Nearest, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::MortonZ, ommTextureAddressMode_Mirror, ommTextureFilterMode_Nearest, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::MortonZ, ommTextureAddressMode_Clamp, ommTextureFilterMode_Nearest, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::MortonZ, ommTextureAddressMode_Border, ommTextureFilterMode_Nearest, true);
-        REGISTER_DISPATCH(ommCpuTextureFormat_UNORM8, TilingMode::MortonZ, ommTextureAddressMode_MirrorOnce, ommTextureFilterMode_Nearest, true);
     }
 
     BakeOutputImpl::~BakeOutputImpl()
     {
+        Cancel();
+        Wait();
+    }
+
+    ommResult BakeOutputImpl::ValidateBatchDesc(const ommCpuBakeInputDesc* descs, uint32_t descCount) const {
+        if (descs == nullptr || descCount == 0)
+            return m_log.InvalidArg("[Invalid Argument] - bakeInputDescs is empty");
+
+        uint64_t totalTriangleCount = 0;
+        for (uint32_t descIt = 0; descIt < descCount; ++descIt)
+        {
+            const ommCpuBakeInputDesc& desc = descs[descIt];
+            RETURN_STATUS_IF_FAILED(ValidateDesc(desc));
+
+            if (desc.maxWorkingSetBytes != 0xFFFFFFFFFFFFFFFF)
+                return m_log.InvalidArg("[Invalid Argument] - maxWorkingSetBytes is not supported by batch bakes");
+            if (desc.maxArrayDataSize != 0xFFFFFFFF)
+                return m_log.InvalidArg("[Invalid Argument] - maxArrayDataSize is not supported by batch bakes");
+            // Deduplication runs over all inputs at once, the settings it depends on must agree.
+            if (desc.bakeFlags != descs[0].bakeFlags)
+                return m_log.InvalidArgf("[Invalid Argument] - bakeInputDescs[%d].bakeFlags differs from bakeInputDescs[0].bakeFlags", descIt);
+            if (desc.rejectionThreshold != descs[0].rejectionThreshold)
+                return m_log.InvalidArgf("[Invalid Argument] - bakeInputDescs[%d].rejectionThreshold differs from bakeInputDescs[0].rejectionThreshold", descIt);
+            if (desc.nearDuplicateDeduplicationFactor != descs[0].nearDuplicateDeduplicationFactor)
+                return m_log.InvalidArgf("[Invalid Argument] - bakeInputDescs[%d].nearDuplicateDeduplicationFactor differs from bakeInputDescs[0].nearDuplicateDeduplicationFactor", descIt);
+
+            totalTriangleCount += desc.indexCount / 3;
+        }
+
+        if (totalTriangleCount > std::numeric_limits<uint32_t>::max())
+            return m_log.InvalidArg("[Invalid Argument] - the total triangle count of a batch bake can't exceed 2^32-1");
+
+        return ommResult_SUCCESS;
     }
 
     ommResult BakeOutputImpl::ValidateDesc(const ommCpuBakeInputDesc& desc) const {
@@ -261,18 +244,31 @@ namespace Cpu
             if (desc.maxSubdivisionLevel > kMaxSubdivLevel)
                 return m_log.InvalidArgf("[Invalid Argument] - maxSubdivisionLevel (%d) is greater than maximum supported (%d)", desc.maxSubdivisionLevel, kMaxSubdivLevel);
         }
-        if ((options.enableNearDuplicateDetection || options.enableNearDuplicateDetectionBruteForce) && options.disableDuplicateDetection)
+        if ((options.enableNearDuplicateDetection || options.enableNearDuplicateDetectionExact) && options.disableDuplicateDetection)
+        {
+            return m_log.InvalidArg("[Invalid Argument] - EnableNearDuplicateDetection or EnableNearDuplicateDetectionExact is used together with DisableDuplicateDetection");
+        }
+        if (options.enableNearDuplicateDetectionExact && !options.enableNearDuplicateDetection)
+        {
+            return m_log.InvalidArg("[Invalid Argument] - EnableNearDuplicateDetectionExact is set without EnableNearDuplicateDetection");
+        }
+        if (desc.maxWorkingSetBytes != 0xFFFFFFFFFFFFFFFF)
         {
-            return m_log.InvalidArg("[Invalid Argument] - EnableNearDuplicateDetection or EnableNearDuplicateDetectionBruteForce is used together with DisableDuplicateDetection");
+            if (options.enableNearDuplicateDetection || options.enableNearDuplicateDetectionExact)
+                return m_log.InvalidArg("[Invalid Argument] - maxWorkingSetBytes can't be used together with EnableNearDuplicateDetection");
+            if (desc.maxArrayDataSize != 0xFFFFFFFF)
+                return m_log.InvalidArg("[Invalid Argument] - maxWorkingSetBytes can't be used together with maxArrayDataSize");
         }
         if (options.enableValidation && !m_log.HasLogger())
             return m_log.InvalidArg("[Invalid Argument] - EnableValidation is set but no message callback was provided"); // this works more as documentation since it won't be logged
 
         if (TextureImpl* texture = GetHandleImpl<TextureImpl>(desc.texture))
         {
-            if (texture->HasAlphaCutoff() && texture->GetAlphaCutoff() != desc.alphaCutoff)
+            // The SAT of the texture only serves its own cutoff, the min/max pyramid serves any.
+            if (options.enableValidation && texture->HasAlphaCutoff() && texture->GetAlphaCutoff() != desc.alphaCutoff && !texture->HasMinMaxPyramid())
             {
-                return m_log.InvalidArgf("[Invalid Argument] - Texture object alpha cutoff threshold (%.6f) is different from alpha cutoff threshold in bake input (%.6f)", texture->GetAlphaCutoff(), desc.alphaCutoff);
+                m_log.PerfWarnf("[Perf Warning] - Texture object alpha cutoff threshold (%.6f) is different from alpha cutoff threshold in bake input (%.6f),"
+                    " its SAT can't be used. Set EnableMinMaxPyramid to bake a texture at several cutoffs.", texture->GetAlphaCutoff(), desc.alphaCutoff);
             }
         }
 
@@ -289,41 +285,109 @@ namespace Cpu
         return ommResult_SUCCESS;
     }
 
-    template<class... TArgs>
-    void BakeOutputImpl::RegisterDispatch(TArgs... args, std::function < ommResult(const ommCpuBakeInputDesc& desc)> fn) {
-        bakeDispatchTable[std::make_tuple(args...)] = fn;
+    constexpr size_t BakeOutputImpl::GetDispatchIndex(ommCpuTextureFormat format, TilingMode tilingMode, ommTextureAddressMode addressMode, ommTextureFilterMode filterMode, bool texIsPow2)
+    {
+        size_t index = size_t(format);
+        index = index * size_t(TilingMode::MAX_NUM) + size_t(tilingMode);
+        index = index * size_t(ommTextureAddressMode_MAX_NUM) + size_t(addressMode);
+        index = index * size_t(ommTextureFilterMode_MAX_NUM) + size_t(filterMode);
+        return index * 2 + (texIsPow2 ? 1 : 0);
     }
 
-    ommResult BakeOutputImpl::InvokeDispatch(const ommCpuBakeInputDesc& desc) {
+    template<size_t kIndex>
+    constexpr BakeOutputImpl::BakeDispatch BakeOutputImpl::MakeDispatch()
+    {
+        constexpr size_t kFilterCount = size_t(ommTextureFilterMode_MAX_NUM);
+        constexpr size_t kAddressModeCount = size_t(ommTextureAddressMode_MAX_NUM);
+        constexpr size_t kTilingModeCount = size_t(TilingMode::MAX_NUM);
+
+        constexpr bool bTexIsPow2 = (kIndex % 2) != 0;
+        constexpr ommTextureFilterMode eFilterMode = ommTextureFilterMode((kIndex / 2) % kFilterCount);
+        constexpr ommTextureAddressMode eAddressMode = ommTextureAddressMode((kIndex / 2 / kFilterCount) % kAddressModeCount);
+        constexpr TilingMode eTilingMode = TilingMode((kIndex / 2 / kFilterCount / kAddressModeCount) % kTilingModeCount);
+        constexpr ommCpuTextureFormat eFormat = ommCpuTextureFormat(kIndex / 2 / kFilterCount / kAddressModeCount / kTilingModeCount);
+        static_assert(GetDispatchIndex(eFormat, eTilingMode, eAddressMode, eFilterMode, bTexIsPow2) == kIndex);
+
+        // UNORM8 and FP32 textures may use any tiling mode, block compressed and bitmask textures are always linear.
+        constexpr bool bIsSwizzledFormat = eFormat == ommCpuTextureFormat_UNORM8 || eFormat == ommCpuTextureFormat_FP32;
+        if constexpr (bIsSwizzledFormat || eTilingMode == TilingMode::Linear)
+        {
+            return BakeDispatch{
+                &BakeOutputImpl::BakeImpl<eFormat, eTilingMode, eAddressMode, eFilterMode, bTexIsPow2>,
+                &BakeOutputImpl::ResampleImpl<eFormat, eTilingMode, eAddressMode, eFilterMode, bTexIsPow2> };
+        }
+        else
+        {
+            return BakeDispatch{ nullptr, nullptr };
+        }
+    }
+
+    const BakeOutputImpl::BakeDispatch* BakeOutputImpl::FindDispatch(const ommCpuBakeInputDesc& desc) const {
+        static constexpr std::array<BakeDispatch, kDispatchCount> kDispatchTable = []<size_t... kIndices>(std::index_sequence<kIndices...>) {
+            return std::array<BakeDispatch, kDispatchCount>{ MakeDispatch<kIndices>()... };
+        }(std::make_index_sequence<kDispatchCount>{});
+
         TextureImpl* texture = GetHandleImpl<TextureImpl>(desc.texture);
-        bool sizeIsPow2 = texture->SizeIsPow2();
-        auto it = bakeDispatchTable.find(std::make_tuple(texture->GetTextureFormat(), texture->GetTilingMode(), desc.runtimeSamplerDesc.addressingMode, desc.runtimeSamplerDesc.filter, sizeIsPow2));
-        if (it == bakeDispatchTable.end())
+        if (desc.runtimeSamplerDesc.addressingMode >= ommTextureAddressMode_MAX_NUM || desc.runtimeSamplerDesc.filter >= ommTextureFilterMode_MAX_NUM)
+            return nullptr;
+
+        const size_t index = GetDispatchIndex(texture->GetTextureFormat(), texture->GetTilingMode(), desc.runtimeSamplerDesc.addressingMode, desc.runtimeSamplerDesc.filter, texture->SizeIsPow2());
+        const BakeDispatch& dispatch = kDispatchTable[index];
+        if (dispatch.bake == nullptr)
+            return nullptr;
+        return &dispatch;
+    }
+
+    ommResult BakeOutputImpl::InvokeDispatch(const ommCpuBakeInputDesc& desc) {
+        const BakeDispatch* dispatch = FindDispatch(desc);
+        if (dispatch == nullptr)
             return ommResult_FAILURE;
-        return it->second(desc);
+        return (this->*dispatch->bake)(desc);
     }
 
     ommResult BakeOutputImpl::Bake(const ommCpuBakeInputDesc& desc)
     {
-        return InvokeDispatch(desc);
+        const ommResult result = m_cache.IsEnabled() ? BakeCached(desc) : InvokeDispatch(desc);
+        m_arena.Reset();
+        if (result == ommResult_SUCCESS)
+            m_progress.BeginStage(ommCpuBakeStage_Done);
+        m_status = result;
+        return result;
+    }
+
+    ommResult BakeOutputImpl::BakeBatch(const ommCpuBakeInputDesc* descs, uint32_t descCount)
+    {
+        const ommResult result = BakeBatchImpl(descs, descCount);
+        m_arena.Reset();
+        if (result == ommResult_SUCCESS)
+            m_progress.BeginStage(ommCpuBakeStage_Done);
+        m_status = result;
+        return result;
     }
 
-    static constexpr uint32_t kCacheLineSize = 128;
-    template<class T>
-    struct alignas(kCacheLineSize) TAligned : public T {
-        using T::T;
-        uint8_t _padding[kCacheLineSize - sizeof(T)];
-        void Validate() {
-            static_assert(sizeof(TAligned) == kCacheLineSize);
-        }
-    };
+    ommResult BakeOutputImpl::BakeAsync(const ommCpuBakeInputDesc& desc)
+    {
+        // Report invalid input to the caller right away rather than through ommCpuPollBake.
+        RETURN_STATUS_IF_FAILED(ValidateDesc(desc));
+
+        m_status = ommResult_NOT_READY;
+        m_bakeInputDesc = desc;
+        m_asyncTask.Start(m_scheduler, &BakeOutputImpl::RunAsync, this);
+        return ommResult_SUCCESS;
+    }
 
-    using Atomic32Aligned = TAligned<std::atomic<uint32_t>>;
+    void BakeOutputImpl::RunAsync(void* arg)
+    {
+        BakeOutputImpl* self = (BakeOutputImpl*)arg;
+        const ommCpuBakeInputDesc desc = self->m_bakeInputDesc;
+        self->Bake(desc);
+    }
 
+    // Histograms are filled by a single thread, plain counters keep them small and cheap to zero for every bake.
     struct VisibilityMapUsageHistogram
     {
     private:
-        Atomic32Aligned visibilityMapUsageStats[(uint16_t)ommFormat_MAX_NUM][kMaxNumSubdivLevels] = { 0, };
+        uint32_t visibilityMapUsageStats[(uint16_t)ommFormat_MAX_NUM][kMaxNumSubdivLevels] = { 0, };
 
         static uint16_t _GetOmmIndex(ommFormat format) {
             OMM_ASSERT(format != ommFormat_INVALID);
@@ -344,54 +408,90 @@ namespace Cpu
         }
     };
 
+    // Micro-triangle states are stored as 2-bit values packed in to 64-bit words (32 states per word).
+    // The bit layout matches the OC1_4_State array data layout on little endian targets, this allows
+    // the 4-state output to be copied as is. The 3-state representation (UnknownTransparent -> UnknownOpaque)
+    // used for deduplication is derived on the fly a word at a time.
     class OmmArrayDataView
     {
-        static void SetStateInternal(uint8_t* targetBuffer, uint32_t index, ommOpacityState state) {
-            targetBuffer[index] = (uint8_t)state;
+        static_assert(std::endian::native == std::endian::little, "Packed state layout assumes little endian");
+    public:
+        static constexpr uint32_t kStatesPerWordLog2 = 5;
+        static constexpr uint32_t kStatesPerWord = 1u << kStatesPerWordLog2;
+        static constexpr uint64_t kLowBitMask = 0x5555555555555555ull;
+
+        static constexpr size_t GetNumWords(size_t numStates) {
+            return (numStates + kStatesPerWord - 1) >> kStatesPerWordLog2;
         }
 
-        static ommOpacityState GetStateInternal(const uint8_t* targetBuffer, uint32_t index) {
-            return (ommOpacityState)targetBuffer[index];
+        // Maps UnknownTransparent (0b10) to UnknownOpaque (0b11) for all states in the word.
+        static constexpr uint64_t To3State(uint64_t word) {
+            static_assert(ommOpacityState_Transparent == 0 && ommOpacityState_Opaque == 1);
+            static_assert(ommOpacityState_UnknownTransparent == 2 && ommOpacityState_UnknownOpaque == 3);
+            return word | ((word >> 1) & kLowBitMask);
+        }
+
+        // Mask of the state bits in use for the word at wordIndex.
+        static constexpr uint64_t GetWordMask(size_t numStates, size_t wordIndex) {
+            const size_t numStatesInWord = std::min<size_t>(numStates - (wordIndex << kStatesPerWordLog2), kStatesPerWord);
+            return numStatesInWord == kStatesPerWord ? ~0ull : ((1ull << (numStatesInWord << 1ull)) - 1ull);
         }
 
-    public:
         OmmArrayDataView() = delete;
-        OmmArrayDataView(ommFormat format, uint8_t* data, uint8_t* data3state, size_t ommArrayDataSize)
+        OmmArrayDataView(ommFormat format, uint64_t* data, size_t numStates)
             : _is2State(format == ommFormat_OC1_2_State),
-             _ommArrayData4or2state(data),
-             _ommArrayData3state(data3state),
-             _ommArrayDataSize(ommArrayDataSize) 
+             _ommArrayData(data),
+             _numStates(numStates)
         {
             OMM_ASSERT(format == ommFormat_OC1_2_State || format == ommFormat_OC1_4_State);
         }
 
-        void SetData(uint8_t* data, uint8_t* data3state, size_t size) {
-            _ommArrayData4or2state = data;
-            _ommArrayData3state = data3state;
-            _ommArrayDataSize = size;
+        void SetData(uint64_t* data, size_t numStates) {
+            _ommArrayData = data;
+            _numStates = numStates;
+            _isDirty = true;
         }
 
         void SetState(uint32_t index, ommOpacityState state) {
-            SetStateInternal(_ommArrayData4or2state, index, state);
-            SetStateInternal(_ommArrayData3state, index, state == ommOpacityState_UnknownTransparent ? ommOpacityState_UnknownOpaque : state);
+            OMM_ASSERT(index < _numStates);
+            const uint32_t shift = (index & (kStatesPerWord - 1)) << 1u;
+            uint64_t& word = _ommArrayData[index >> kStatesPerWordLog2];
+            word = (word & ~(3ull << shift)) | ((uint64_t)state << shift);
         }
 
         ommOpacityState GetState(uint32_t index) const {
-            return GetStateInternal(_ommArrayData4or2state, index);
+            OMM_ASSERT(index < _numStates);
+            const uint32_t shift = (index & (kStatesPerWord - 1)) << 1u;
+            return (ommOpacityState)((_ommArrayData[index >> kStatesPerWordLog2] >> shift) & 3ull);
         }
 
         ommOpacityState Get3State(uint32_t index) const {
-            return GetStateInternal(_ommArrayData3state, index);
+            const ommOpacityState state = GetState(index);
+            return state == ommOpacityState_UnknownTransparent ? ommOpacityState_UnknownOpaque : state;
         }
 
-        uint8_t* GetOmm3StateData() const { return _ommArrayData3state; }
-        size_t GetOmm3StateDataSize() const { return _ommArrayDataSize;  }
+        // Returns the word at wordIndex in 3-state representation, unused trailing states are zero.
+        uint64_t Get3StateWord(size_t wordIndex) const {
+            return To3State(_ommArrayData[wordIndex]);
+        }
+
+        // Writes through the returned pointer aren't tracked, the states count as changed.
+        uint64_t* GetData() { _isDirty = true; return _ommArrayData; }
+        const uint64_t* GetData() const { return _ommArrayData; }
+        size_t GetNumStates() const { return _numStates; }
+        size_t GetNumWords() const { return GetNumWords(_numStates); }
+
+        // Set whenever the states may have changed, lets the owner cache values derived from them. SetState doesn't set it,
+        // threads fill disjoint words of the same view. Views start out dirty, passes that change states later mark them once.
+        bool IsDirty() const { return _isDirty; }
+        void MarkDirty() { _isDirty = true; }
+        void ClearDirty() { _isDirty = false; }
 
     private:
         bool _is2State;
-        uint8_t* _ommArrayData4or2state;
-        uint8_t* _ommArrayData3state;
-        size_t _ommArrayDataSize;
+        bool _isDirty = true;
+        uint64_t* _ommArrayData;
+        size_t _numStates;
     };
 
     class OmmArrayDataVector final : public OmmArrayDataView
@@ -399,38 +499,37 @@ namespace Cpu
     public:
         OmmArrayDataVector() = delete;
         OmmArrayDataVector(const StdAllocator<uint8_t>& stdAllocator, ommFormat format, uint32_t subdivisionLevel)
-            : OmmArrayDataView(format, nullptr, nullptr, 0)
+            : OmmArrayDataView(format, nullptr, 0)
             , data(stdAllocator.GetInterface())
-            , data3state(stdAllocator.GetInterface())
         {
-            const size_t maxSizeInBytes = (size_t)omm::bird::GetNumMicroTriangles(subdivisionLevel);
-            data.resize(maxSizeInBytes);
-            data3state.resize(maxSizeInBytes);
-            OmmArrayDataView::SetData((uint8_t*)data.data(), data3state.data(), maxSizeInBytes);
+            const size_t numStates = (size_t)omm::bird::GetNumMicroTriangles(subdivisionLevel);
+            data.resize(OmmArrayDataView::GetNumWords(numStates));
+            OmmArrayDataView::SetData(data.data(), numStates);
             Init();
         }
 
         void ShrinkTo(uint32_t subdivisionLevel)
         {
-            const size_t maxSizeInBytes = (size_t)omm::bird::GetNumMicroTriangles(subdivisionLevel);
+            const size_t numStates = (size_t)omm::bird::GetNumMicroTriangles(subdivisionLevel);
 
-            assert(maxSizeInBytes < data.size());
-            assert(maxSizeInBytes < data3state.size());
-            data.resize(maxSizeInBytes);
-            data3state.resize(maxSizeInBytes);
+            OMM_ASSERT(numStates < GetNumStates());
+            data.resize(OmmArrayDataView::GetNumWords(numStates));
+            // Keep the unused tail zeroed, digests and distances operate on whole words.
+            data.back() &= GetWordMask(numStates, data.size() - 1);
+            OmmArrayDataView::SetData(data.data(), numStates);
         }
 
     private:
 
         void Init()
         {
-            std::fill(data.begin(), data.end(), ommOpacityState_UnknownOpaque);
-            std::fill(data3state.begin(), data3state.end(), ommOpacityState_UnknownOpaque);
+            static_assert(ommOpacityState_UnknownOpaque == 3);
+            std::fill(data.begin(), data.end(), ~0ull);
+            data.back() &= GetWordMask(GetNumStates(), data.size() - 1);
         }
 
     private:
-        vector<uint8_t> data;
-        vector<uint8_t> data3state;
+        vector<uint64_t> data;
     };
 
     struct OmmWorkItem {
@@ -438,6 +537,7 @@ namespace Cpu
         ommFormat vmFormat;
         Triangle uvTri;
         vector<uint32_t> primitiveIndices; // source primitive and identical indices
+        bool fromTriangleCache = false; // vmStates were loaded from the texture triangle cache, no resampling needed.
 
         OmmWorkItem() = delete;
 
@@ -459,6 +559,7 @@ namespace Cpu
         uint32_t vmDescOffset = 0xFFFFFFFF;
         uint32_t vmSpecialIndex = kNoSpecialIndex;
         OmmArrayDataVector vmStates;
+        uint64_t digest = 0; // Digest of the 3-state representation and format, valid while vmStates isn't dirty.
     };
 
     static float GetArea2D(const float2& p0, const float2& p1, const float2& p2) {
@@ -586,27 +687,37 @@ namespace Cpu
             return FetchUVTriangle(desc.texCoords, texCoordStrideInBytes, desc.texCoordFormat, triangleIndices);
         }
 
+        static constexpr int32_t kDisabledPrimitive = 0xE;
+
+        // Workloads of at most this many primitives (and hence work items) take the small workload path: lookups go through
+        // small_map instead of hash_map and passes that can't change the result are skipped. For runtime streamed meshes of a few
+        // dozen triangles the fixed cost of these otherwise dominates the bake.
+        static constexpr uint32_t kSmallWorkloadSize = 64;
+
+        // Sets up the work items for the primitives in primitiveIndices, or for all primitives when primitiveIndices is null.
+        // Primitives are looked up in and added to triangleIDToWorkItem, so UV-triangles are shared with work items set up by
+        // earlier calls. primitiveIndexOffset is added to the primitive indices stored in the work items.
+        template<class TTriangleIDMap>
         static ommResult SetupWorkItems(
-            const StdAllocator<uint8_t>& allocator, const Logger& log, const ommCpuBakeInputDesc& desc, const Options& options, 
-            vector<OmmWorkItem>& vmWorkItems)
+            const StdAllocator<uint8_t>& allocator, const Logger& log, const ommCpuBakeInputDesc& desc, const Options& options,
+            const uint32_t* primitiveIndices, uint32_t primitiveCount, uint32_t primitiveIndexOffset,
+            TTriangleIDMap& triangleIDToWorkItem, vector<OmmWorkItem>& vmWorkItems)
         {
             const TextureImpl* texture = GetHandleImpl<TextureImpl>(desc.texture);
 
-            const int32_t triangleCount = desc.indexCount / 3u;
+            const int32_t triangleCount = primitiveIndices ? (int32_t)primitiveCount : (int32_t)(desc.indexCount / 3u);
 
 
             // 1. Reserve memory.
-            hash_map<size_t, uint32_t> triangleIDToWorkItem(allocator.GetInterface());
-            vmWorkItems.reserve(triangleCount);
-
-            const int32_t kDisabledPrimitive = 0xE;
+            vmWorkItems.reserve(vmWorkItems.size() + triangleCount);
 
             // 2. Reduce uv.
             {
                 uint32_t numDisabledTri = 0;
 
-                for (int32_t i = 0; i < triangleCount; ++i)
+                for (int32_t primitiveIt = 0; primitiveIt < triangleCount; ++primitiveIt)
                 {
+                    const int32_t i = primitiveIndices ? (int32_t)primitiveIndices[primitiveIt] : primitiveIt;
                     const Triangle uvTri = GetTriangle(desc, i);
 
                     const int32_t subdivisionLevel = GetSubdivisionLevelForPrimitive(desc, options, i, uvTri, texture->GetSize(0 /*always based on mip 0*/));
@@ -642,10 +753,10 @@ namespace Cpu
                         uint32_t workItemIdx = (uint32_t)vmWorkItems.size();
                         // Temporarily set the triangle->vm desc mapping like this.
                         triangleIDToWorkItem.insert(std::make_pair(vmId, workItemIdx));
-                        vmWorkItems.emplace_back(allocator, ommFormat, subdivisionLevel, i, uvTri);
+                        vmWorkItems.emplace_back(allocator, ommFormat, subdivisionLevel, primitiveIndexOffset + i, uvTri);
                     }
                     else {
-                        vmWorkItems[it->second].primitiveIndices.push_back(i);
+                        vmWorkItems[it->second].primitiveIndices.push_back(primitiveIndexOffset + i);
                     }
                 }
 
@@ -659,6 +770,21 @@ namespace Cpu
             return ommResult_SUCCESS;
         }
 
+        static ommResult SetupWorkItems(
+            const StdAllocator<uint8_t>& allocator, const Logger& log, const ommCpuBakeInputDesc& desc, const Options& options,
+            const uint32_t* primitiveIndices, uint32_t primitiveCount, vector<OmmWorkItem>& vmWorkItems)
+        {
+            const uint32_t triangleCount = primitiveIndices ? primitiveCount : desc.indexCount / 3u;
+            if (triangleCount <= kSmallWorkloadSize)
+            {
+                small_map<size_t, uint32_t, kSmallWorkloadSize> triangleIDToWorkItem;
+                return SetupWorkItems(allocator, log, desc, options, primitiveIndices, primitiveCount, 0, triangleIDToWorkItem, vmWorkItems);
+            }
+
+            hash_map<size_t, uint32_t> triangleIDToWorkItem(allocator.GetInterface());
+            return SetupWorkItems(allocator, log, desc, options, primitiveIndices, primitiveCount, 0, triangleIDToWorkItem, vmWorkItems);
+        }
+
         static uint64_t ComputeWorkloadSize(const ommCpuBakeInputDesc& desc, vector<OmmWorkItem>& vmWorkItems)
         {
             const TextureImpl* texture = GetHandleImpl<TextureImpl>(desc.texture);
@@ -679,16 +805,10 @@ namespace Cpu
             return workloadSize;
         }
 
-        static ommResult ValidateWorkloadSize(
-            const StdAllocator<uint8_t>& allocator, Logger log, const ommCpuBakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& ommWorkItems)
+        static ommResult ValidateWorkloadSize(Logger log, const ommCpuBakeInputDesc& desc, const Options& options, uint64_t workloadSize)
         {
             const bool limitWorkloadSize = desc.maxWorkloadSize != 0xFFFFFFFFFFFFFFFF;
 
-            if (!options.enableValidation && !limitWorkloadSize)
-                return ommResult_SUCCESS;
-
-            uint64_t workloadSize = ComputeWorkloadSize(desc, ommWorkItems);
-
             if (limitWorkloadSize)
             {
                 if (workloadSize > desc.maxWorkloadSize)
@@ -712,15 +832,107 @@ namespace Cpu
             return ommResult_SUCCESS;
         }
 
+        static ommResult ValidateWorkloadSize(
+            const StdAllocator<uint8_t>& allocator, Logger log, const ommCpuBakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& ommWorkItems)
+        {
+            const bool limitWorkloadSize = desc.maxWorkloadSize != 0xFFFFFFFFFFFFFFFF;
+
+            if (!options.enableValidation && !limitWorkloadSize)
+                return ommResult_SUCCESS;
+
+            return ValidateWorkloadSize(log, desc, options, ComputeWorkloadSize(desc, ommWorkItems));
+        }
+
+        // A range of micro-triangles within a single work item, the unit of work handed out to the resampling threads.
+        struct WorkRange
+        {
+            uint32_t workItemIndex;
+            uint32_t microTriangleBegin;
+            uint32_t microTriangleEnd;
+            uint64_t cost;
+        };
+
+        // The resampling cost of a work item varies by orders of magnitude with subdivision level and UV-area.
+        // Estimate it from the micro-triangle count and the number of texels covered by the UV-triangle.
+        static uint64_t ComputeResampleCost(const OmmWorkItem& workItem, const float2& texSize)
+        {
+            const int2 aabb = int2((workItem.uvTri.aabb_e - workItem.uvTri.aabb_s) * texSize);
+            return (uint64_t)omm::bird::GetNumMicroTriangles(workItem.subdivisionLevel) + (uint64_t)std::max(aabb.x, 1) * (uint64_t)std::max(aabb.y, 1);
+        }
+
+        // Splits the work items accepted by filter in to ranges of roughly equal cost, most expensive range first.
+        // Ranges are aligned to whole state words so that no two threads ever write to the same word.
+        // Returns whether the ranges are worth spreading over threads, below kMinParallelCost starting the workers costs more
+        // than the resampling itself.
+        template<class TFilter>
+        static bool SetupWorkRanges(const parallel::Scheduler& scheduler, BakeProgressImpl& progress, const ommCpuBakeInputDesc& desc, const Options& options, const vector<OmmWorkItem>& vmWorkItems, TFilter&& filter, vector<WorkRange>& workRanges)
+        {
+            static constexpr uint32_t kRangesPerWorker = 16;
+            static constexpr uint64_t kMinParallelCost = 1u << 14;
+
+            const TextureImpl* texture = GetHandleImpl<TextureImpl>(desc.texture);
+            const float2 texSize = (float2)texture->GetSize(0 /*mip*/);
+
+            workRanges.clear();
+            workRanges.reserve(vmWorkItems.size());
+
+            uint64_t totalCost = 0;
+            for (const OmmWorkItem& workItem : vmWorkItems)
+            {
+                if (!workItem.fromTriangleCache && filter(workItem))
+                    totalCost += ComputeResampleCost(workItem, texSize);
+            }
+            progress.AddStageWork(totalCost);
+
+            const bool enableThreads = options.enableInternalThreads && totalCost >= kMinParallelCost;
+            const uint32_t workerCount = enableThreads ? scheduler.GetWorkerCount() : 1u;
+            const uint64_t targetCost = std::max<uint64_t>(totalCost / (workerCount * kRangesPerWorker), 1);
+
+            for (uint32_t workItemIt = 0; workItemIt < (uint32_t)vmWorkItems.size(); ++workItemIt)
+            {
+                const OmmWorkItem& workItem = vmWorkItems[workItemIt];
+                if (workItem.fromTriangleCache || !filter(workItem))
+                    continue;
+
+                const uint64_t cost = ComputeResampleCost(workItem, texSize);
+                const uint32_t numMicroTriangles = omm::bird::GetNumMicroTriangles(workItem.subdivisionLevel);
+
+                if (workerCount == 1 || cost <= targetCost)
+                {
+                    workRanges.push_back({ workItemIt, 0, numMicroTriangles, cost });
+                    continue;
+                }
+
+                const uint64_t numRanges = std::min<uint64_t>((cost + targetCost - 1) / targetCost, workItem.vmStates.GetNumWords());
+                const uint32_t rangeSize = (uint32_t)(((numMicroTriangles + numRanges - 1) / numRanges + OmmArrayDataView::kStatesPerWord - 1) & ~(uint64_t)(OmmArrayDataView::kStatesPerWord - 1));
+                for (uint32_t begin = 0; begin < numMicroTriangles; begin += rangeSize)
+                {
+                    const uint32_t end = std::min(begin + rangeSize, numMicroTriangles);
+                    workRanges.push_back({ workItemIt, begin, end, cost * (end - begin) / numMicroTriangles });
+                }
+            }
+
+            if (workerCount != 1)
+            {
+                std::stable_sort(workRanges.begin(), workRanges.end(), [](const WorkRange& a, const WorkRange& b) {
+                    return a.cost > b.cost;
+                });
+            }
+
+            return enableThreads;
+        }
+
         template<ommCpuTextureFormat eFormat, TilingMode eTilingMode, ommTextureAddressMode eTextureAddressMode, ommTextureFilterMode eFilterMode, bool bTexIsPow2>
-        static ommResult ResampleCoarse(const ommCpuBakeInputDesc& desc, const Logger& log, const Options& options, vector<OmmWorkItem>& vmWorkItems)
+        static ommResult ResampleCoarse(const StdAllocator<uint8_t>& allocator, const parallel::Scheduler& scheduler, BakeProgressImpl& progress, const ommCpuBakeInputDesc& desc, const Logger& log, const Options& options, vector<OmmWorkItem>& vmWorkItems)
         {
             if (options.enableAABBTesting && !options.disableLevelLineIntersection)
                 return log.InvalidArg("[Invalid Arg] - EnableAABBTesting can't be used without also setting DisableLevelLineIntersection");
 
             const TextureImpl* texture = GetHandleImpl<TextureImpl>(desc.texture);
 
-            if (!texture->HasSAT())
+            // Prefer the SAT when it was built for this cutoff, it answers in constant time.
+            const bool useSAT = texture->HasSAT() && texture->GetAlphaCutoff() == desc.alphaCutoff;
+            if (!useSAT && !texture->HasMinMaxPyramid())
                 return ommResult_SUCCESS;
 
             if (texture->GetMipCount() != 1)
@@ -728,25 +940,27 @@ namespace Cpu
 
             // 3. Process the queue of unique triangles...
             {
-                const int32_t numWorkItems = (int32_t)vmWorkItems.size();
+                vector<WorkRange> workRanges(allocator);
+                const bool enableThreads = SetupWorkRanges(scheduler, progress, desc, options, vmWorkItems, [](const OmmWorkItem&) { return true; }, workRanges);
 
                 // 3.1 Rasterize...
                 {
-                    #pragma omp parallel for if(options.enableInternalThreads)
-                    for (int32_t workItemIt = 0; workItemIt < numWorkItems; ++workItemIt) {
+                    scheduler.ParallelFor(allocator, enableThreads, (uint32_t)workRanges.size(), [&](uint32_t rangeIt) {
+
+                        if (progress.IsCancelled())
+                            return;
 
                         // 3.2 figure out the sub-states via rasterization...
                         {
                             // Subdivide the input triangle in to smaller triangles. They will be "bird-curve" ordered.
-                            OmmWorkItem& workItem = vmWorkItems[workItemIt];
-
-                            const uint32_t numMicroTriangles = omm::bird::GetNumMicroTriangles(workItem.subdivisionLevel);
+                            const WorkRange& range = workRanges[rangeIt];
+                            OmmWorkItem& workItem = vmWorkItems[range.workItemIndex];
 
                             // Perform rasterization of each individual VM.
                             if (eFilterMode == ommTextureFilterMode_Linear)
                             {
                                 // Run conservative rasterization on the micro triangle
-                                for (uint32_t uTriIt = 0; uTriIt < numMicroTriangles; ++uTriIt)
+                                for (uint32_t uTriIt = range.microTriangleBegin; uTriIt < range.microTriangleEnd; ++uTriIt)
                                 {
                                     const Triangle subTri = omm::bird::GetMicroTriangle(workItem.uvTri, uTriIt, workItem.subdivisionLevel);
 
@@ -783,17 +997,26 @@ namespace Cpu
                                         continue;
                                     }
 
-                                    const int2 aabb = (aabb_e - aabb_s);
-                                    const uint32_t area = (aabb.x + 1) * (aabb.y + 1);
+                                    int32_t cmp = 0;
+                                    if (useSAT)
+                                    {
+                                        const int2 aabb = (aabb_e - aabb_s);
+                                        const uint32_t area = (aabb.x + 1) * (aabb.y + 1);
 
-                                    const uint32_t sa = texture->SAT(aabb_s, aabb_e, mip);
+                                        const uint32_t sa = texture->SAT(aabb_s, aabb_e, mip);
+                                        cmp = sa == 0 ? -1 : sa == area ? 1 : 0;
+                                    }
+                                    else
+                                    {
+                                        cmp = texture->CompareRange(aabb_s, aabb_e, mip, desc.alphaCutoff);
+                                    }
 
-                                    if (sa == 0)
+                                    if (cmp < 0)
                                     {
                                         // (Less than or equal to alpha threshold)
                                         workItem.vmStates.SetState(uTriIt, desc.alphaCutoffLessEqual);
                                     }
-                                    else if (sa == area)
+                                    else if (cmp > 0)
                                     {
                                         // (Greater than alpha threshold)
                                         workItem.vmStates.SetState(uTriIt, desc.alphaCutoffGreater);
@@ -801,10 +1024,12 @@ namespace Cpu
                                 }
                             }
                         }
-                    }
+
+                        progress.CompleteStageWork(workRanges[rangeIt].cost);
+                    });
                 }
             }
-            return ommResult_SUCCESS;
+            return progress.CheckCancelled();
         }
 
         enum TriangleClass
@@ -813,8 +1038,81 @@ namespace Cpu
             Degenerate
         };
 
+        // Classifies a micro-triangle from the min/max pyramid of the texture, or from its SAT when useSAT is set, without
+        // rasterizing it. Returns true when the texels under the triangle are above the cutoff in every mip, or below it in
+        // every mip, the state is then the one the coverage kernels would produce.
+        static bool ClassifyFootprint(const TextureImpl* texture, const ommCpuBakeInputDesc& desc, const Triangle& subTri, bool useSAT, ommOpacityState& state)
+        {
+            bool isAbove = false;
+            for (uint32_t mipIt = 0; mipIt < texture->GetMipCount(); ++mipIt)
+            {
+                // Texels the kernels may read: the conservative raster of the triangle with a pixel of slack on each side,
+                // extended by the bilinear footprint. Triangles reaching the texture border depend on the address mode.
+                const float2 size = texture->GetSizef(mipIt);
+                const int2 s = int2(glm::floor(subTri.aabb_s * size - 0.5f)) - 1;
+                const int2 e = int2(glm::floor(subTri.aabb_e * size - 0.5f)) + 2;
+                if (!texture->InTexture(s, mipIt) || !texture->InTexture(e, mipIt))
+                    return false;
+
+                bool mipIsAbove = false;
+                bool mipIsBelow = false;
+                if (useSAT)
+                {
+                    const int2 extent = e - s + 1;
+                    const uint32_t numAbove = texture->SAT(s, e, mipIt);
+                    mipIsAbove = numAbove == uint32_t(extent.x * extent.y);
+                    mipIsBelow = numAbove == 0;
+                }
+                else
+                {
+                    const float2 minMax = texture->GetMinMax(s, e, mipIt);
+                    mipIsAbove = desc.alphaCutoff < minMax.x;
+                    mipIsBelow = minMax.y < desc.alphaCutoff;
+                }
+
+                // Texels on both sides of the cutoff, or the mips disagree.
+                if (mipIsAbove == mipIsBelow || (mipIt != 0 && mipIsAbove != isAbove))
+                    return false;
+                isAbove = mipIsAbove;
+            }
+            state = isAbove ? desc.alphaCutoffGreater : desc.alphaCutoffLessEqual;
+            return true;
+        }
+
+        // Walks the subdivision hierarchy of a work item from the given level k triangle down. The level k triangle j covers the
+        // micro-triangles j * 4^(L-k) to (j + 1) * 4^(L-k) - 1 of the bird curve at level L, all of which lie within it, so one
+        // footprint test on it settles the whole subtree. Only subtrees straddling the cutoff are descended in to, the
+        // micro-triangles left unknown at the leaf level are classified one by one by the caller.
+        static void ClassifyHierarchy(const TextureImpl* texture, const ommCpuBakeInputDesc& desc, bool useSAT, OmmWorkItem& workItem, uint32_t microTriangleBegin, uint32_t microTriangleEnd, uint32_t level, uint32_t index)
+        {
+            if (level == workItem.subdivisionLevel)
+                return;
+
+            const uint32_t numLeaves = 1u << (2u * (workItem.subdivisionLevel - level));
+            const uint32_t begin = std::max(index * numLeaves, microTriangleBegin);
+            const uint32_t end = std::min((index + 1) * numLeaves, microTriangleEnd);
+            if (begin >= end)
+                return;
+
+            const Triangle subTri = omm::bird::GetMicroTriangle(workItem.uvTri, index, level);
+
+            ommOpacityState state;
+            if (ClassifyFootprint(texture, desc, subTri, useSAT, state))
+            {
+                for (uint32_t uTriIt = begin; uTriIt < end; ++uTriIt)
+                {
+                    if (workItem.vmStates.GetState(uTriIt) == ommOpacityState_UnknownOpaque)
+                        workItem.vmStates.SetState(uTriIt, state);
+                }
+                return;
+            }
+
+            for (uint32_t childIt = 0; childIt < 4; ++childIt)
+                ClassifyHierarchy(texture, desc, useSAT, workItem, microTriangleBegin, microTriangleEnd, level + 1, 4 * index + childIt);
+        }
+
         template<ommCpuTextureFormat eFormat, TilingMode eTilingMode, ommTextureAddressMode eTextureAddressMode, ommTextureFilterMode eFilterMode, TriangleClass eTriangleClass, bool bTexIsPow2>
-        static ommResult ResampleFine(const ommCpuBakeInputDesc& desc, const Logger& log, const Options& options, vector<OmmWorkItem>& vmWorkItems)
+        static ommResult ResampleFine(const StdAllocator<uint8_t>& allocator, const parallel::Scheduler& scheduler, BakeProgressImpl& progress, const ommCpuBakeInputDesc& desc, const Logger& log, const Options& options, vector<OmmWorkItem>& vmWorkItems)
         {
             if (options.enableAABBTesting && !options.disableLevelLineIntersection)
                 return log.InvalidArg("[Invalid Arg] - EnableAABBTesting can't be used without also setting DisableLevelLineIntersection");
@@ -824,39 +1122,48 @@ namespace Cpu
 
             const TextureImpl* texture = GetHandleImpl<TextureImpl>(desc.texture);
 
+            // A micro-triangle covering texels on both sides of the cutoff is unknown, the coverage kernels can stop there
+            // unless the unknown state promotion compares the counts.
+            const bool earlyExit = desc.unknownStatePromotion != ommUnknownStatePromotion_Nearest;
+
+            // Degenerate triangles may cover no pixel at all, these are left to the rasterizer.
+            const bool useMinMax = texture->HasMinMaxPyramid() && eTriangleClass == TriangleClass::Normal;
+
+            // The hierarchy is classified from the min/max pyramid, or from the SAT when it was built for this cutoff.
+            const bool useSAT = !texture->HasMinMaxPyramid() && texture->HasSAT() && texture->GetAlphaCutoff() == desc.alphaCutoff;
+            const bool useHierarchy = (useMinMax || useSAT) && eTriangleClass == TriangleClass::Normal;
+
             // 3. Process the queue of unique triangles...
             {
-                const int32_t numWorkItems = (int32_t)vmWorkItems.size();
+                vector<WorkRange> workRanges(allocator);
+                const bool enableThreads = SetupWorkRanges(scheduler, progress, desc, options, vmWorkItems, [](const OmmWorkItem& workItem) {
+                    const bool isDegenerate = workItem.uvTri.GetIsDegenerate();
+                    return eTriangleClass == TriangleClass::Degenerate ? isDegenerate : !isDegenerate;
+                }, workRanges);
 
                 // 3.1 Rasterize...
                 {
-                    #pragma omp parallel for if(options.enableInternalThreads)
-                    for (int32_t workItemIt = 0; workItemIt < numWorkItems; ++workItemIt) {
-                        auto kernel = &LevelLineIntersectionKernel::run<eFormat, eTextureAddressMode, eTilingMode, eTriangleClass, bTexIsPow2>;
+                    scheduler.ParallelFor(allocator, enableThreads, (uint32_t)workRanges.size(), [&](uint32_t rangeIt) {
+
+                        if (progress.IsCancelled())
+                            return;
 
                         // 3.2 figure out the sub-states via rasterization...
                         {
                             // Subdivide the input triangle in to smaller triangles. They will be "bird-curve" ordered.
-                            OmmWorkItem& workItem = vmWorkItems[workItemIt];
-                            const bool isDegenerate = workItem.uvTri.GetIsDegenerate();
-
-                            if (eTriangleClass == TriangleClass::Normal && isDegenerate)
-                            {
-                                continue;
-                            }
-
-                            if (eTriangleClass == TriangleClass::Degenerate && !isDegenerate)
-                            {
-                                continue;
-                            }
+                            const WorkRange& range = workRanges[rangeIt];
+                            OmmWorkItem& workItem = vmWorkItems[range.workItemIndex];
 
-                            const uint32_t numMicroTriangles = omm::bird::GetNumMicroTriangles(workItem.subdivisionLevel);
+                            // Settle whole subtrees first, on mostly solid textures only the micro-triangles along the alpha
+                            // edges are left to the classification below.
+                            if (useHierarchy)
+                                ClassifyHierarchy(texture, desc, useSAT, workItem, range.microTriangleBegin, range.microTriangleEnd, 0 /*level*/, 0 /*index*/);
 
                             // Perform rasterization of each individual VM.
                             if (eFilterMode == ommTextureFilterMode_Linear)
                             {
                                 // Run conservative rasterization on the micro triangle
-                                for (uint32_t uTriIt = 0; uTriIt < numMicroTriangles; ++uTriIt)
+                                for (uint32_t uTriIt = range.microTriangleBegin; uTriIt < range.microTriangleEnd; ++uTriIt)
                                 {
                                     if (workItem.vmStates.GetState(uTriIt) != ommOpacityState_UnknownOpaque)
                                     {
@@ -865,6 +1172,13 @@ namespace Cpu
 
                                     const Triangle subTri = omm::bird::GetMicroTriangle(workItem.uvTri, uTriIt, workItem.subdivisionLevel);
 
+                                    ommOpacityState minMaxState;
+                                    if (useMinMax && ClassifyFootprint(texture, desc, subTri, false /*useSAT*/, minMaxState))
+                                    {
+                                        workItem.vmStates.SetState(uTriIt, minMaxState);
+                                        continue;
+                                    }
+
                                     // Figure out base-state by sampling at the center of the triangle.
                                     if (!options.disableLevelLineIntersection) 
                                     {
@@ -877,7 +1191,7 @@ namespace Cpu
                                             const int2 rasterSize = texture->GetSize(mipIt);
 
 
-                                            LevelLineIntersectionKernel::Params params = { &vmCoverage,  &subTri, texture->GetRcpSize(mipIt), rasterSize, texture, desc.alphaCutoff, desc.runtimeSamplerDesc.borderAlpha, mipIt };
+                                            LevelLineIntersectionKernel::Params params = { &vmCoverage,  &subTri, texture->GetRcpSize(mipIt), rasterSize, texture, desc.alphaCutoff, desc.runtimeSamplerDesc.borderAlpha, mipIt, earlyExit };
 
                                             // This offset (in pixel units) will be applied to the triangle,
                                             // the effect is that the raster grid is being mapped such that bilinear interpolation region defined by
@@ -885,12 +1199,18 @@ namespace Cpu
                                             // This is only correct for bilinear version, nearest sampling should map exactly to the source alpha texture.
                                             float2 pixelOffset = -float2(0.5, 0.5);
 
-                                            if (desc.alphaCutoff < texture->Bilinear(eTextureAddressMode, subTri.p0, mipIt))
+                                            if (desc.alphaCutoff < texture->Bilinear(eTextureAddressMode, subTri.p0, mipIt, desc.runtimeSamplerDesc.borderAlpha))
                                                 vmCoverage.numAboveAlpha++;
                                             else
                                                 vmCoverage.numBelowAlpha++;
 
 
+                                            // The sample above may already have decided the state together with the previous mips.
+                                            const bool isDecided = earlyExit && vmCoverage.numAboveAlpha != 0 && vmCoverage.numBelowAlpha != 0;
+
+                                            if (isDecided)
+                                                break;
+
                                             if constexpr (eTriangleClass == TriangleClass::Normal)
                                             {
                                                 auto kernel = &LevelLineIntersectionKernel::run<eFormat, eTextureAddressMode, eTilingMode, false /*degenerate*/, bTexIsPow2>;
@@ -925,13 +1245,14 @@ namespace Cpu
                                         float2 pixelOffset = -float2(0.5, 0.5);
 
                                         OmmCoverage vmCoverage = { 0, };
-                                        ConservativeBilinearKernel::Params params = { &vmCoverage,  texture->GetRcpSize(mip), rasterSize, texture->GetSizeLog2(mip), texture, desc.alphaCutoff, desc.runtimeSamplerDesc.borderAlpha, mip };
+                                        ConservativeBilinearKernel::Params params = { &vmCoverage,  texture->GetRcpSize(mip), rasterSize, texture->GetSizeLog2(mip), texture, desc.alphaCutoff, desc.runtimeSamplerDesc.borderAlpha, mip, earlyExit };
 
                                         Triangle subTri0 = Triangle(subTri.aabb_s, float2(subTri.aabb_e.x, subTri.aabb_s.y), float2(subTri.aabb_s.x, subTri.aabb_e.y));
                                         Triangle subTri1 = Triangle(subTri.aabb_e, float2(subTri.aabb_e.x, subTri.aabb_s.y), float2(subTri.aabb_s.x, subTri.aabb_e.y));
-                                        auto kernel = &ConservativeBilinearKernel::run<eFormat, eTextureAddressMode, eTilingMode, bTexIsPow2>;
-                                        RasterizeConservativeSerialWithOffsetCoverage(subTri0, rasterSize, pixelOffset, kernel, &params);
-                                        RasterizeConservativeSerialWithOffsetCoverage(subTri1, rasterSize, pixelOffset, kernel, &params);
+                                        auto kernel = &ConservativeBilinearKernel::runSpan<eFormat, eTextureAddressMode, eTilingMode, bTexIsPow2>;
+                                        RasterizeConservativeSpansSerialWithOffset(subTri0, rasterSize, pixelOffset, kernel, &params);
+                                        if (!earlyExit || vmCoverage.numAboveAlpha == 0 || vmCoverage.numBelowAlpha == 0)
+                                            RasterizeConservativeSpansSerialWithOffset(subTri1, rasterSize, pixelOffset, kernel, &params);
 
                                         OMM_ASSERT(vmCoverage.numAboveAlpha != 0 || vmCoverage.numBelowAlpha != 0);
 
@@ -953,10 +1274,10 @@ namespace Cpu
                                         float2 pixelOffset = -float2(0.5, 0.5);
 
                                         OmmCoverage vmCoverage = { 0, };
-                                        ConservativeBilinearKernel::Params params = { &vmCoverage,  texture->GetRcpSize(mip), rasterSize, rasterSizeLog2, texture, desc.alphaCutoff, desc.runtimeSamplerDesc.borderAlpha, mip };
+                                        ConservativeBilinearKernel::Params params = { &vmCoverage,  texture->GetRcpSize(mip), rasterSize, rasterSizeLog2, texture, desc.alphaCutoff, desc.runtimeSamplerDesc.borderAlpha, mip, earlyExit };
 
-                                        auto kernel = &ConservativeBilinearKernel::run<eFormat, eTextureAddressMode, eTilingMode, bTexIsPow2>;
-                                        RasterizeConservativeSerialWithOffsetCoverage(subTri, rasterSize, pixelOffset, kernel, &params);
+                                        auto kernel = &ConservativeBilinearKernel::runSpan<eFormat, eTextureAddressMode, eTilingMode, bTexIsPow2>;
+                                        RasterizeConservativeSpansSerialWithOffset(subTri, rasterSize, pixelOffset, kernel, &params);
 
                                         OMM_ASSERT(vmCoverage.numBelowAlpha != 0 || vmCoverage.numAboveAlpha != 0);
 
@@ -968,49 +1289,32 @@ namespace Cpu
                             }
                             else if (eFilterMode == ommTextureFilterMode_Nearest)
                             {
-                                struct KernelParams {
-                                    OmmCoverage*        vmState;
-                                    float2              invSize;
-                                    int2                size;
-                                    int2                sizeLog2;
-                                    ommSamplerDesc      runtimeSamplerDesc;
-                                    const TextureImpl* texture;
-                                    float               alphaCutoff;
-                                    float               borderAlpha;
-                                    uint32_t            mipIt;
-                                };
-
-                                for (uint32_t uTriIt = 0; uTriIt < numMicroTriangles; ++uTriIt)
+                                for (uint32_t uTriIt = range.microTriangleBegin; uTriIt < range.microTriangleEnd; ++uTriIt)
                                 {
+                                    if (workItem.vmStates.GetState(uTriIt) != ommOpacityState_UnknownOpaque)
+                                    {
+                                        continue;
+                                    }
+
+                                    const Triangle subTri = omm::bird::GetMicroTriangle(workItem.uvTri, uTriIt, workItem.subdivisionLevel);
+
+                                    ommOpacityState minMaxState;
+                                    if (useMinMax && ClassifyFootprint(texture, desc, subTri, false /*useSAT*/, minMaxState))
+                                    {
+                                        workItem.vmStates.SetState(uTriIt, minMaxState);
+                                        continue;
+                                    }
+
                                     OmmCoverage vmCoverage = { 0, };
                                     for (uint32_t mipIt = 0; mipIt < texture->GetMipCount(); ++mipIt)
                                     {
                                         const int2 rasterSize = texture->GetSize(mipIt);
                                         const int2 rasterSizeLog2 = texture->GetSizeLog2(mipIt);
-                                        KernelParams params = { nullptr, texture->GetRcpSize(mipIt), rasterSize, rasterSizeLog2,desc.runtimeSamplerDesc, texture, desc.alphaCutoff, desc.runtimeSamplerDesc.borderAlpha, mipIt };
-
-                                        params.vmState = &vmCoverage;
-
-                                        auto kernel = [](int2 pixel, void* ctx)
-                                        {
-                                            KernelParams* p = (KernelParams*)ctx;
-
-                                            const int2 coord = omm::GetTexCoord<eTextureAddressMode, bTexIsPow2>(pixel, p->size, p->sizeLog2);
+                                        NearestKernel::Params params = { &vmCoverage, rasterSize, rasterSizeLog2, texture, desc.alphaCutoff, desc.runtimeSamplerDesc.borderAlpha, mipIt, earlyExit };
 
-                                            const bool isBorder = eTextureAddressMode == ommTextureAddressMode_Border && (coord.x == kTexCoordBorder || coord.y == kTexCoordBorder);
-                                            const float alpha = isBorder ? p->borderAlpha : p->texture->template Load<eFormat, eTilingMode>(coord, p->mipIt);
+                                        auto kernel = &NearestKernel::runSpan<eFormat, eTextureAddressMode, eTilingMode, bTexIsPow2>;
 
-                                            if (p->alphaCutoff < alpha) {
-                                                p->vmState->numAboveAlpha++;
-                                            }
-                                            else {
-                                                p->vmState->numBelowAlpha++;
-                                            }
-                                        };
-
-                                        const Triangle subTri = omm::bird::GetMicroTriangle(workItem.uvTri, uTriIt, workItem.subdivisionLevel);
-
-                                        RasterizeConservativeSerial(subTri, rasterSize, kernel, &params);
+                                        RasterizeConservativeSpansSerial(subTri, rasterSize, kernel, &params);
                                         OMM_ASSERT(vmCoverage.numAboveAlpha != 0 || vmCoverage.numBelowAlpha != 0);
 
                                         const ommOpacityState state = GetStateFromCoverage(desc.format, desc.unknownStatePromotion, desc.alphaCutoffGreater, desc.alphaCutoffLessEqual, vmCoverage);
@@ -1022,79 +1326,273 @@ namespace Cpu
                                 }
                             }
                         }
-                    }
+
+                        progress.CompleteStageWork(workRanges[rangeIt].cost);
+                    });
                 }
             }
-            return ommResult_SUCCESS;
+            return progress.CheckCancelled();
         }
 
-        static ommResult DeduplicateExact(const StdAllocator<uint8_t>& allocator, const Options& options, vector<OmmWorkItem>& vmWorkItems)
+        // Key words of the texture triangle cache. The resampled states of a work item depend on its UV-triangle, format and
+        // subdivision level, and on the alpha test and sampler settings of the bake.
+        static constexpr size_t kTriangleCacheSettingsWords = 5;
+        static constexpr size_t kTriangleCacheKeyWords = kTriangleCacheSettingsWords + 4;
+
+        static void GetTriangleCacheSettingsKey(const ommCpuBakeInputDesc& desc, const Options& options, uint64_t* key)
         {
-            if (options.disableDuplicateDetection)
-                return ommResult_SUCCESS;
+            auto Pack = [](uint32_t lo, uint32_t hi) { return (uint64_t)lo | ((uint64_t)hi << 32ull); };
+            key[0] = Pack(std::bit_cast<uint32_t>(desc.alphaCutoff), std::bit_cast<uint32_t>(desc.runtimeSamplerDesc.borderAlpha));
+            key[1] = Pack((uint32_t)desc.runtimeSamplerDesc.addressingMode, (uint32_t)desc.runtimeSamplerDesc.filter);
+            key[2] = Pack((uint32_t)desc.alphaCutoffLessEqual, (uint32_t)desc.alphaCutoffGreater);
+            key[3] = Pack((uint32_t)desc.format, (uint32_t)desc.unknownStatePromotion);
+            key[4] = Pack((uint32_t)options.disableLevelLineIntersection | ((uint32_t)options.enableAABBTesting << 1u) | ((uint32_t)options.disableFineClassification << 2u), 0);
+        }
 
-            uint32_t dupesFound = 0;
+        static void GetTriangleCacheKey(const OmmWorkItem& workItem, uint64_t* key)
+        {
+            auto Pack = [](float lo, float hi) { return (uint64_t)std::bit_cast<uint32_t>(lo) | ((uint64_t)std::bit_cast<uint32_t>(hi) << 32ull); };
+            key[kTriangleCacheSettingsWords + 0] = Pack(workItem.uvTri.p0.x, workItem.uvTri.p0.y);
+            key[kTriangleCacheSettingsWords + 1] = Pack(workItem.uvTri.p1.x, workItem.uvTri.p1.y);
+            key[kTriangleCacheSettingsWords + 2] = Pack(workItem.uvTri.p2.x, workItem.uvTri.p2.y);
+            key[kTriangleCacheSettingsWords + 3] = (uint64_t)workItem.subdivisionLevel | ((uint64_t)workItem.vmFormat << 32ull);
+        }
 
-            auto CalcDigest = [&allocator](const OmmWorkItem& workItem) {
-                return XXH64((const void*)workItem.vmStates.GetOmm3StateData(), workItem.vmStates.GetOmm3StateDataSize(), 42/*seed*/);
-            };
+        // Loads the states of work items resampled by earlier bakes with the same texture, these are skipped by SetupWorkRanges.
+        // Returns the number of work items found in the cache.
+        static uint32_t LoadFromTriangleCache(const ommCpuBakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems)
+        {
+            const TextureImpl* texture = GetHandleImpl<TextureImpl>(desc.texture);
 
-            hash_map<uint64_t, uint32_t> digestToWorkItemIndex(allocator.GetInterface());
-            for (uint32_t i = 0; i < vmWorkItems.size(); ++i)
+            uint64_t key[kTriangleCacheKeyWords];
+            GetTriangleCacheSettingsKey(desc, options, key);
+
+            uint32_t hitCount = 0;
+            for (OmmWorkItem& workItem : vmWorkItems)
             {
-                const OmmWorkItem& workItem = vmWorkItems[i];
-                uint64_t digest = CalcDigest(workItem);
-                auto it = digestToWorkItemIndex.find(digest);
-                if (it == digestToWorkItemIndex.end())
-                {
-                    digestToWorkItemIndex.insert(std::make_pair(digest, i));
-                }
-                else
-                {
-                    // Transfer primitives to the new VM index...
-                    OmmWorkItem& existingWorkItem = vmWorkItems[it->second];
-                    existingWorkItem.primitiveIndices.insert(existingWorkItem.primitiveIndices.end(), workItem.primitiveIndices.begin(), workItem.primitiveIndices.end());
-
-                    // Get rid if this work item. Forver.
-                    vmWorkItems[i].primitiveIndices.clear();
-                    vmWorkItems[i].vmSpecialIndex = -1;
-                    dupesFound++;
-                }
+                GetTriangleCacheKey(workItem, key);
+                workItem.fromTriangleCache = texture->LoadTriangleCache(key, kTriangleCacheKeyWords, workItem.vmStates.GetData(), workItem.vmStates.GetNumWords());
+                hitCount += workItem.fromTriangleCache ? 1 : 0;
             }
-
-            return ommResult_SUCCESS;
+            return hitCount;
         }
 
-        static float HammingDistance3State(const OmmWorkItem& workItemA, const OmmWorkItem& workItemB)
+        static void StoreToTriangleCache(const ommCpuBakeInputDesc& desc, const Options& options, const vector<OmmWorkItem>& vmWorkItems)
         {
-            OMM_ASSERT(workItemA.subdivisionLevel == workItemB.subdivisionLevel);
-            const uint32_t numMicroTriangles = omm::bird::GetNumMicroTriangles(workItemA.subdivisionLevel);
-            uint32_t numDiff = 0;
-            for (uint32_t uTriIt = 0; uTriIt < numMicroTriangles; ++uTriIt) {
+            const TextureImpl* texture = GetHandleImpl<TextureImpl>(desc.texture);
 
-                ommOpacityState stateA = workItemA.vmStates.Get3State(uTriIt);
-                ommOpacityState stateB = workItemB.vmStates.Get3State(uTriIt);
+            uint64_t key[kTriangleCacheKeyWords];
+            GetTriangleCacheSettingsKey(desc, options, key);
 
-                if (stateA != stateB)
-                    numDiff++;
+            for (const OmmWorkItem& workItem : vmWorkItems)
+            {
+                if (workItem.fromTriangleCache)
+                    continue;
+                GetTriangleCacheKey(workItem, key);
+                texture->StoreTriangleCache(key, kTriangleCacheKeyWords, workItem.vmStates.GetData(), workItem.vmStates.GetNumWords());
             }
+        }
 
-            return float(numDiff);
-        };
-
-        // Computes hamming distnace, returns false if sizes don't match.
-        static float NormalizedHammingDistance3State(const OmmWorkItem& workItemA, const OmmWorkItem& workItemB)
+        // Resolves the micro-triangle states of all work items, coarse classification first and then the remaining unknown
+        // states at full resolution.
+        template<ommCpuTextureFormat eFormat, TilingMode eTilingMode, ommTextureAddressMode eTextureAddressMode, ommTextureFilterMode eFilterMode, bool bTexIsPow2>
+        static ommResult Resample(const StdAllocator<uint8_t>& allocator, const parallel::Scheduler& scheduler, BakeProgressImpl& progress, const ommCpuBakeInputDesc& desc, const Logger& log, const Options& options, vector<OmmWorkItem>& vmWorkItems)
         {
-            OMM_ASSERT(workItemA.subdivisionLevel == workItemB.subdivisionLevel);
-            const uint32_t numMicroTriangles = omm::bird::GetNumMicroTriangles(workItemA.subdivisionLevel);
-            return HammingDistance3State(workItemA, workItemB) / numMicroTriangles;
-        };
+            const bool useTriangleCache = GetHandleImpl<TextureImpl>(desc.texture)->HasTriangleCache();
+            if (useTriangleCache)
+            {
+                const uint32_t hitCount = LoadFromTriangleCache(desc, options, vmWorkItems);
+                progress.AddTriangleCacheLookups(hitCount, (uint32_t)vmWorkItems.size());
+                if (options.enableValidation)
+                    log.Infof("[Info] - %u of %u work items were loaded from the triangle cache.", hitCount, (uint32_t)vmWorkItems.size());
+            }
 
-        static ommResult MergeWorkItems(OmmWorkItem& to, OmmWorkItem& from)
-        {
-            OMM_ASSERT(to.subdivisionLevel == from.subdivisionLevel);
+            progress.BeginStage(ommCpuBakeStage_Coarse);
+            RETURN_STATUS_IF_FAILED((ResampleCoarse<eFormat, eTilingMode, eTextureAddressMode, eFilterMode, bTexIsPow2>(allocator, scheduler, progress, desc, log, options, vmWorkItems)));
 
-            // Transfer primitives to the new VM index...
+            progress.BeginStage(ommCpuBakeStage_Fine);
+            RETURN_STATUS_IF_FAILED((ResampleFine<eFormat, eTilingMode, eTextureAddressMode, eFilterMode, TriangleClass::Normal, bTexIsPow2>(allocator, scheduler, progress, desc, log, options, vmWorkItems)));
+
+            RETURN_STATUS_IF_FAILED((ResampleFine<eFormat, eTilingMode, eTextureAddressMode, eFilterMode, TriangleClass::Degenerate, bTexIsPow2>(allocator, scheduler, progress, desc, log, options, vmWorkItems)));
+
+            if (useTriangleCache)
+                StoreToTriangleCache(desc, options, vmWorkItems);
+
+            return ommResult_SUCCESS;
+        }
+
+        static uint64_t CalcDigest(const OmmWorkItem& workItem)
+        {
+            // Hash the 3-state representation in chunks, the state count is part of the digest
+            // since the trailing unused states of the packed words are zero.
+            static constexpr size_t kChunkSize = 64;
+            uint64_t chunk[kChunkSize];
+
+            const OmmArrayDataView& states = workItem.vmStates;
+            const uint64_t numStates = states.GetNumStates();
+            const size_t numWords = states.GetNumWords();
+
+            uint64_t digest = XXH64((const void*)&numStates, sizeof(numStates), 42/*seed*/);
+            for (size_t wordIt = 0; wordIt < numWords; wordIt += kChunkSize)
+            {
+                const size_t chunkSize = std::min(kChunkSize, numWords - wordIt);
+                for (size_t i = 0; i < chunkSize; ++i)
+                    chunk[i] = states.Get3StateWord(wordIt + i);
+                digest = XXH64((const void*)chunk, chunkSize * sizeof(uint64_t), digest);
+            }
+            return digest;
+        }
+
+        // Only items whose states changed since the last call are rehashed, e.g. the ones Compress downsampled.
+        static uint64_t GetDigest(OmmWorkItem& workItem)
+        {
+            if (workItem.vmStates.IsDirty())
+            {
+                workItem.digest = CalcDigest(workItem);
+                hash_combine(workItem.digest, workItem.vmFormat);
+                workItem.vmStates.ClearDirty();
+            }
+            return workItem.digest;
+        }
+
+        static bool IsEqual3State(const OmmWorkItem& workItemA, const OmmWorkItem& workItemB)
+        {
+            if (workItemA.vmFormat != workItemB.vmFormat || workItemA.vmStates.GetNumStates() != workItemB.vmStates.GetNumStates())
+                return false;
+
+            const size_t numWords = workItemA.vmStates.GetNumWords();
+            for (size_t wordIt = 0; wordIt < numWords; ++wordIt)
+            {
+                if (workItemA.vmStates.Get3StateWord(wordIt) != workItemB.vmStates.Get3StateWord(wordIt))
+                    return false;
+            }
+            return true;
+        }
+
+        // The work items as seen by dedup::DeduplicateExact.
+        struct ExactDedupWorkItems
+        {
+            vector<OmmWorkItem>& vmWorkItems;
+
+            uint64_t GetDigest(uint32_t i) const
+            {
+                return vmWorkItems[i].digest;
+            }
+
+            bool IsEqual(uint32_t a, uint32_t b) const
+            {
+                return IsEqual3State(vmWorkItems[a], vmWorkItems[b]);
+            }
+
+            void Merge(uint32_t survivor, uint32_t i)
+            {
+                OmmWorkItem& existingWorkItem = vmWorkItems[survivor];
+                OmmWorkItem& workItem = vmWorkItems[i];
+
+                // Transfer primitives to the new VM index...
+                existingWorkItem.primitiveIndices.insert(existingWorkItem.primitiveIndices.end(), workItem.primitiveIndices.begin(), workItem.primitiveIndices.end());
+
+                // Get rid if this work item. Forver.
+                workItem.primitiveIndices.clear();
+                workItem.vmSpecialIndex = -1;
+            }
+        };
+
+        static ommResult DeduplicateExact(const StdAllocator<uint8_t>& allocator, const parallel::Scheduler& scheduler, const Logger& log, const Options& options, vector<OmmWorkItem>& vmWorkItems)
+        {
+            if (options.disableDuplicateDetection)
+                return ommResult_SUCCESS;
+
+            // Below this the digests and shards are cheaper to process on the calling thread than to hand out to workers.
+            static constexpr uint32_t kMinParallelWorkItems = 4096;
+            static constexpr uint32_t kDigestsPerTask = 1024;
+
+            const uint32_t workItemCount = (uint32_t)vmWorkItems.size();
+            const bool enableThreads = options.enableInternalThreads && workItemCount >= kMinParallelWorkItems;
+
+            // Work items without primitives were merged in to another one by an earlier pass, they must not absorb live ones.
+            std::atomic<uint32_t> liveCount = 0;
+            std::atomic<uint32_t> rehashCount = 0;
+            scheduler.ParallelForBlocks(allocator, enableThreads, workItemCount, kDigestsPerTask, [&](uint32_t begin, uint32_t end) {
+                uint32_t blockLiveCount = 0;
+                uint32_t blockRehashCount = 0;
+                for (uint32_t i = begin; i < end; ++i)
+                {
+                    if (!vmWorkItems[i].primitiveIndices.empty())
+                    {
+                        blockLiveCount++;
+                        blockRehashCount += vmWorkItems[i].vmStates.IsDirty();
+                        GetDigest(vmWorkItems[i]);
+                    }
+                }
+                liveCount += blockLiveCount;
+                rehashCount += blockRehashCount;
+            });
+
+            if (options.enableValidation)
+                log.Infof("[Info] - %d of %d work items were rehashed for exact deduplication.", rehashCount.load(), liveCount.load());
+
+            ExactDedupWorkItems items = { vmWorkItems };
+
+            if (workItemCount <= kSmallWorkloadSize)
+            {
+                uint32_t workItemIndices[kSmallWorkloadSize];
+                uint32_t count = 0;
+                for (uint32_t i = 0; i < workItemCount; ++i)
+                {
+                    if (!vmWorkItems[i].primitiveIndices.empty())
+                        workItemIndices[count++] = i;
+                }
+
+                small_map<uint64_t, uint32_t, kSmallWorkloadSize> digestToWorkItemIndex;
+                dedup::DeduplicateExact(digestToWorkItemIndex, workItemIndices, count, items);
+                return ommResult_SUCCESS;
+            }
+
+            vector<uint32_t> workItemIndices(allocator);
+            workItemIndices.reserve(liveCount.load());
+            for (uint32_t i = 0; i < workItemCount; ++i)
+            {
+                if (!vmWorkItems[i].primitiveIndices.empty())
+                    workItemIndices.push_back(i);
+            }
+
+            dedup::DeduplicateExactSharded(allocator, scheduler, enableThreads, workItemIndices.data(), (uint32_t)workItemIndices.size(), items);
+
+            return ommResult_SUCCESS;
+        }
+
+        static float HammingDistance3State(const OmmWorkItem& workItemA, const OmmWorkItem& workItemB)
+        {
+            OMM_ASSERT(workItemA.subdivisionLevel == workItemB.subdivisionLevel);
+            const size_t numWords = workItemA.vmStates.GetNumWords();
+            OMM_ASSERT(numWords == workItemB.vmStates.GetNumWords());
+            const uint64_t* a = workItemA.vmStates.GetData();
+            const uint64_t* b = workItemB.vmStates.GetData();
+
+#if OMM_SIMD_X86
+            static const bool useAVX2 = raster::GetSimdLevel() >= raster::SimdLevel::AVX2;
+            if (useAVX2)
+                return float(hamming::CountDiff3StateAVX2(a, b, numWords));
+#elif OMM_SIMD_NEON
+            return float(hamming::CountDiff3StateNEON(a, b, numWords));
+#endif
+            return float(hamming::CountDiff3StateScalar(a, b, numWords));
+        };
+
+        // Computes hamming distnace, returns false if sizes don't match.
+        static float NormalizedHammingDistance3State(const OmmWorkItem& workItemA, const OmmWorkItem& workItemB)
+        {
+            OMM_ASSERT(workItemA.subdivisionLevel == workItemB.subdivisionLevel);
+            const uint32_t numMicroTriangles = omm::bird::GetNumMicroTriangles(workItemA.subdivisionLevel);
+            return HammingDistance3State(workItemA, workItemB) / numMicroTriangles;
+        };
+
+        static ommResult MergeWorkItems(OmmWorkItem& to, OmmWorkItem& from)
+        {
+            OMM_ASSERT(to.subdivisionLevel == from.subdivisionLevel);
+
+            // Transfer primitives to the new VM index...
             to.primitiveIndices.insert(to.primitiveIndices.end(), from.primitiveIndices.begin(), from.primitiveIndices.end());
 
             // Get rid if this work item. Forver.
@@ -1127,46 +1625,48 @@ namespace Cpu
                     }
                 }
             }
+            to.vmStates.MarkDirty();
 
             return ommResult_SUCCESS;
         }
 
-        static ommResult DeduplicateSimilarLSH(const StdAllocator<uint8_t>& allocator, const ommCpuBakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems, uint32_t iterations)
+        static ommResult DeduplicateSimilarLSH(const StdAllocator<uint8_t>& allocator, const parallel::Scheduler& scheduler, const ommCpuBakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems, uint32_t iterations)
         {
             if (options.disableDuplicateDetection)
                 return ommResult_SUCCESS;
-            if (!options.enableNearDuplicateDetection || options.enableNearDuplicateDetectionBruteForce)
+            if (!options.enableNearDuplicateDetection || options.enableNearDuplicateDetectionExact)
                 return ommResult_SUCCESS;
 
             // LHS (locality sensitive hashing) implemented via hamming bit sampling 
             // ref1: https://citeseerx.ist.psu.edu/viewdoc/download?doi=10.1.1.712.8703&rep=rep1&type=pdf
             // ref2: https://www.vldb.org/conf/1999/P49.pdf
 
+            // Below this the hash tables are cheaper to build on the calling thread than to hand out to workers.
+            static constexpr uint32_t kMinParallelWorkItems = 1024;
+
             std::mt19937 mt(42);
 
-            uint32_t match = 0;
-            uint32_t trueMatch = 0;
-            uint32_t falseMatch = 0;
-            uint32_t noMatch = 0;
+            vector<uint32_t> batchWorkItems(allocator);
+            batchWorkItems.reserve(vmWorkItems.size());
 
-            for (uint32_t attempts = 0; attempts < iterations; ++attempts)
+            // A bucket is the run of entries sharing a hash in the sorted entry list of a table, entries of a bucket are in
+            // increasing batch order. Flat arrays replace a map of vectors, building a table is a sort.
+            struct HashTable
             {
-                vector<uint32_t> batchWorkItems(allocator);
-                batchWorkItems.reserve(vmWorkItems.size());
-
-                struct HashTable
-                {
-                    vector<uint32_t> bitIndices; // random bit indices
-                    vector<uint64_t> workItemHashes;
-                    hash_map<uint64_t, vector<uint32_t>> layerHashToWorkItem;
-                    HashTable(const StdAllocator<uint8_t>& allocator) :bitIndices(allocator), workItemHashes(allocator), layerHashToWorkItem(allocator)
-                    { }
-                };
+                vector<uint32_t> bitIndices; // random bit indices
+                vector<std::pair<uint64_t, uint32_t>> entries; // (hash, batch index), sorted
+                vector<uint32_t> bucketBegin; // per batch index, first entry of its bucket
+                vector<uint32_t> bucketEnd; // per batch index, one past the last entry of its bucket
+                HashTable(const StdAllocator<uint8_t>& allocator) : bitIndices(allocator), entries(allocator), bucketBegin(allocator), bucketEnd(allocator)
+                { }
+            };
 
-                vector<HashTable> hashTables(allocator);
-                vector<uint32_t> bitSamples(allocator);
-                set<uint32_t> potentialMatches(allocator);
+            vector<HashTable> hashTables(allocator);
+            vector<uint32_t> potentialMatches(allocator);
+            vector<uint32_t> lastQuery(allocator); // per batch index, the last query it was added to the potential matches of
 
+            for (uint32_t attempts = 0; attempts < iterations; ++attempts)
+            {
                 for (uint32_t subdivisionLevel = 1; subdivisionLevel <= kMaxSubdivLevel; ++subdivisionLevel)
                 {
                     batchWorkItems.clear();
@@ -1203,9 +1703,6 @@ namespace Cpu
                     const float r = desc.nearDuplicateDeduplicationFactor /* 0.15f*/ * d;   // Distance must be at most 25%
                     const float c = 4.0f;        // Allow 2x deviation from this
 
-                    const float p1 = 1 - r / d;         // Lower bound probability, for close two points
-                    const float p2 = 1 - (c * r) / d;   // Upper bound probability, for far two points
-
                     const float p = 1.f / c;
                     const float Lf = glm::ceil(std::pow((float)n, p));
                     const uint32_t L = (uint32_t)Lf;
@@ -1217,18 +1714,11 @@ namespace Cpu
                     if (k == 0)
                         continue;
 
-                    const uint32_t bigO = L * (d + k);  // O(L(d+k)), for instance c = 2 => O(sqrt(n)*(d + k))
-                    const uint32_t bigO2 = n * n;       // O(N^2)
-
-                    const float ratio = (float)bigO / bigO2;
-
                     hashTables.resize(L, allocator);
 
                     for (HashTable& hashTable : hashTables)
                     {
-                        hashTable.workItemHashes.resize(vmWorkItems.size(), 0);
                         hashTable.bitIndices.resize(k);
-                        hashTable.layerHashToWorkItem.clear();
                         for (uint32_t& bitIndex : hashTable.bitIndices)
                         {
                             // We're not using std::uniform_int_distribution, the output is not defined in spec and may differ between compilers
@@ -1237,42 +1727,61 @@ namespace Cpu
                         }
                     }
 
-                    bitSamples.resize(k);
-                    for (uint32_t workItemIndex : batchWorkItems)
-                    {
-                        const OmmWorkItem& workItem = vmWorkItems[workItemIndex];
+                    // The tables are independent, each one is hashed and sorted by a single task.
+                    const bool enableThreads = options.enableInternalThreads && n >= kMinParallelWorkItems;
+                    scheduler.ParallelFor(allocator, enableThreads, L, [&](uint32_t tableIt) {
+                        HashTable& hashTable = hashTables[tableIt];
 
-                        for (HashTable& hashTable : hashTables)
+                        // The sampled 3-state values are packed 32 to a word before hashing.
+                        static constexpr uint32_t kMaxSampleWords = 64;
+                        uint64_t sampleWords[kMaxSampleWords];
+
+                        hashTable.entries.resize(n);
+                        for (uint32_t batchIt = 0; batchIt < n; ++batchIt)
                         {
-                            for (uint32_t kIt = 0; kIt < k; ++kIt)
+                            const OmmWorkItem& workItem = vmWorkItems[batchWorkItems[batchIt]];
+
+                            uint64_t hash = 42;
+                            for (uint32_t kIt = 0; kIt < k; kIt += kMaxSampleWords * OmmArrayDataView::kStatesPerWord)
                             {
-                                const uint32_t randomBitIndex = hashTable.bitIndices[kIt];
-                                ommOpacityState state = workItem.vmStates.Get3State(randomBitIndex);
-                                bitSamples[kIt] = (uint32_t)state;
+                                const uint32_t numSamples = std::min(k - kIt, kMaxSampleWords * OmmArrayDataView::kStatesPerWord);
+                                const uint32_t numWords = (uint32_t)OmmArrayDataView::GetNumWords(numSamples);
+                                std::fill(sampleWords, sampleWords + numWords, 0ull);
+                                for (uint32_t sampleIt = 0; sampleIt < numSamples; ++sampleIt)
+                                {
+                                    const uint64_t state = (uint64_t)workItem.vmStates.Get3State(hashTable.bitIndices[kIt + sampleIt]);
+                                    sampleWords[sampleIt >> OmmArrayDataView::kStatesPerWordLog2] |= state << ((sampleIt & (OmmArrayDataView::kStatesPerWord - 1)) << 1u);
+                                }
+                                hash = XXH64((const void*)sampleWords, sizeof(uint64_t) * numWords, hash);
                             }
 
-                            uint64_t hash = XXH64((const void*)bitSamples.data(), sizeof(uint32_t) * bitSamples.size(), 42/*seed*/);
+                            hashTable.entries[batchIt] = std::make_pair(hash, batchIt);
+                        }
 
-                            hashTable.workItemHashes[workItemIndex] = hash;
+                        std::sort(hashTable.entries.begin(), hashTable.entries.end());
 
-                            auto it = hashTable.layerHashToWorkItem.find(hash);
-                            if (it != hashTable.layerHashToWorkItem.end())
-                            {
-                                it->second.push_back(workItemIndex);
-                            }
-                            else
+                        hashTable.bucketBegin.resize(n);
+                        hashTable.bucketEnd.resize(n);
+                        for (uint32_t begin = 0; begin < n;)
+                        {
+                            uint32_t end = begin + 1;
+                            while (end < n && hashTable.entries[end].first == hashTable.entries[begin].first)
+                                ++end;
+
+                            for (uint32_t entryIt = begin; entryIt < end; ++entryIt)
                             {
-                                vector<uint32_t> layerHashToWorkItem(allocator);
-                                layerHashToWorkItem.push_back(workItemIndex);
-                                hashTable.layerHashToWorkItem.insert(std::make_pair(hash, layerHashToWorkItem));
+                                hashTable.bucketBegin[hashTable.entries[entryIt].second] = begin;
+                                hashTable.bucketEnd[hashTable.entries[entryIt].second] = end;
                             }
+                            begin = end;
                         }
-                    }
+                    });
 
                     // Now we can do the merging.
-                    for (uint32_t workItemIndex : batchWorkItems)
+                    lastQuery.assign(n, 0xFFFFFFFF);
+                    for (uint32_t batchIt = 0; batchIt < n; ++batchIt)
                     {
-                        OmmWorkItem& workItem = vmWorkItems[workItemIndex];
+                        OmmWorkItem& workItem = vmWorkItems[batchWorkItems[batchIt]];
 
                         if (workItem.HasSpecialIndex()) // This might happen if we have already merged this work item.
                             continue;
@@ -1280,20 +1789,13 @@ namespace Cpu
                         potentialMatches.clear();
                         for (const HashTable& hashTable : hashTables)
                         {
-                            uint64_t hash = hashTable.workItemHashes[workItemIndex];
-
-                            OMM_ASSERT(hash != 0);
-
-                            auto it = hashTable.layerHashToWorkItem.find(hash);
-
-                            OMM_ASSERT(it != hashTable.layerHashToWorkItem.end());
-
-                            for (uint32_t potentialWorkItemIndex : it->second)
+                            for (uint32_t entryIt = hashTable.bucketBegin[batchIt]; entryIt < hashTable.bucketEnd[batchIt]; ++entryIt)
                             {
-                                if (potentialWorkItemIndex == workItemIndex)
+                                const uint32_t potentialBatchIt = hashTable.entries[entryIt].second;
+                                if (potentialBatchIt == batchIt)
                                     continue;
 
-                                const OmmWorkItem& potentialWorkItem = vmWorkItems[potentialWorkItemIndex];
+                                const OmmWorkItem& potentialWorkItem = vmWorkItems[batchWorkItems[potentialBatchIt]];
 
                                 if (potentialWorkItem.HasSpecialIndex())
                                     continue;
@@ -1301,11 +1803,17 @@ namespace Cpu
                                 if (potentialMatches.size() > 3 * L)
                                     break;
 
-                                potentialMatches.insert(potentialWorkItemIndex);
+                                if (lastQuery[potentialBatchIt] == batchIt)
+                                    continue;
+
+                                lastQuery[potentialBatchIt] = batchIt;
+                                potentialMatches.push_back(batchWorkItems[potentialBatchIt]);
                             }
                         }
 
-                        // out of potential matches... pick best one.
+                        // out of potential matches... pick best one, the lowest index wins a tie.
+                        std::sort(potentialMatches.begin(), potentialMatches.end());
+
                         float minDist = std::numeric_limits<float>::max();
                         int32_t nearestIndex = -1;
                         for (uint32_t potentialMatch : potentialMatches)
@@ -1324,105 +1832,228 @@ namespace Cpu
                         {
                             OmmWorkItem& similarWorkItem = vmWorkItems[nearestIndex];
 
-                            trueMatch++;
                             MergeWorkItems(workItem /*to*/, similarWorkItem /*from*/);
                             OMM_ASSERT(similarWorkItem.HasSpecialIndex());
                         }
-                        else
-                        {
-                            falseMatch++;
-                        }
-
-                        if (potentialMatches.size() == 1)
-                            match++;
-                        else
-                            noMatch++;
-
-                        uint32_t dummy = (uint32_t)potentialMatches.size();
-                        const uint32_t dummy2 = dummy;
                     }
                 }
             }
-            
-           // const float ratio = float(match) / noMatch;
-            volatile const float ratio = float(noMatch) / trueMatch;
-            volatile const float ratio2 = float(noMatch) / trueMatch;
 
             return ommResult_SUCCESS;
         }
 
-        static ommResult DeduplicateSimilarBruteForce(const StdAllocator<uint8_t>& allocator, const Options& options, vector<OmmWorkItem>& vmWorkItems)
+        // Vantage point tree over work items of one subdivision level, by 3-state hamming distance (a metric).
+        // Nodes are implicit: the first item of a range is its vantage point, the items at most threshold away from it
+        // follow, the others start at split. Splitting at the median keeps the depth logarithmic.
+        class VPTree
+        {
+        public:
+            struct Neighbour
+            {
+                float dist;
+                uint32_t workItemIndex;
+            };
+
+            VPTree(const StdAllocator<uint8_t>& allocator, const vector<OmmWorkItem>& vmWorkItems) :
+                m_vmWorkItems(vmWorkItems),
+                m_nodes(allocator),
+                m_distances(allocator)
+            { }
+
+            void Build(const vector<uint32_t>& workItemIndices)
+            {
+                const uint32_t count = (uint32_t)workItemIndices.size();
+                m_nodes.resize(count);
+                m_distances.resize(count);
+                for (uint32_t it = 0; it < count; ++it)
+                    m_nodes[it] = { workItemIndices[it], 0.f, 0 };
+
+                Build(0, count);
+            }
+
+            // Writes up to maxCount work items closer than maxDist to the query, nearest first. Returns their number.
+            uint32_t FindNearest(uint32_t workItemIndex, float maxDist, Neighbour* neighbours, uint32_t maxCount) const
+            {
+                uint32_t count = 0;
+                float tau = maxDist;
+                Search(0, (uint32_t)m_nodes.size(), m_vmWorkItems[workItemIndex], workItemIndex, tau, neighbours, count, maxCount);
+                return count;
+            }
+
+        private:
+            struct Node
+            {
+                uint32_t workItemIndex;
+                float threshold;
+                uint32_t split;
+            };
+
+            void Build(uint32_t begin, uint32_t end)
+            {
+                if (end - begin <= 1)
+                {
+                    if (begin != end)
+                        m_nodes[begin].split = end;
+                    return;
+                }
+
+                const OmmWorkItem& vantagePoint = m_vmWorkItems[m_nodes[begin].workItemIndex];
+                for (uint32_t it = begin + 1; it < end; ++it)
+                    m_distances[it] = { HammingDistance3State(vantagePoint, m_vmWorkItems[m_nodes[it].workItemIndex]), m_nodes[it].workItemIndex };
+
+                const uint32_t split = begin + 1 + (end - begin - 1) / 2;
+                std::nth_element(m_distances.begin() + begin + 1, m_distances.begin() + split, m_distances.begin() + end, [](const Neighbour& a, const Neighbour& b) {
+                    return a.dist != b.dist ? a.dist < b.dist : a.workItemIndex < b.workItemIndex;
+                });
+                for (uint32_t it = begin + 1; it < end; ++it)
+                    m_nodes[it].workItemIndex = m_distances[it].workItemIndex;
+
+                m_nodes[begin].threshold = split < end ? m_distances[split].dist : 0.f;
+                m_nodes[begin].split = split;
+
+                Build(begin + 1, split);
+                Build(split, end);
+            }
+
+            void Search(uint32_t begin, uint32_t end, const OmmWorkItem& query, uint32_t queryIndex, float& tau, Neighbour* neighbours, uint32_t& count, uint32_t maxCount) const
+            {
+                if (begin >= end)
+                    return;
+
+                const Node& node = m_nodes[begin];
+                const float dist = HammingDistance3State(query, m_vmWorkItems[node.workItemIndex]);
+                if (node.workItemIndex != queryIndex && dist < tau)
+                {
+                    // Insertion sort, the list is short.
+                    uint32_t it = std::min(count, maxCount - 1);
+                    for (; it > 0 && dist < neighbours[it - 1].dist; --it)
+                        neighbours[it] = neighbours[it - 1];
+                    neighbours[it] = { dist, node.workItemIndex };
+                    count = std::min(count + 1, maxCount);
+                    if (count == maxCount)
+                        tau = neighbours[count - 1].dist;
+                }
+
+                // Items inside are at least dist - threshold away from the query, items outside threshold - dist.
+                // The side the query falls in is visited first, it's the likelier one to tighten tau.
+                if (dist <= node.threshold)
+                {
+                    Search(begin + 1, node.split, query, queryIndex, tau, neighbours, count, maxCount);
+                    if (node.threshold - dist < tau)
+                        Search(node.split, end, query, queryIndex, tau, neighbours, count, maxCount);
+                }
+                else
+                {
+                    Search(node.split, end, query, queryIndex, tau, neighbours, count, maxCount);
+                    if (dist - node.threshold < tau)
+                        Search(begin + 1, node.split, query, queryIndex, tau, neighbours, count, maxCount);
+                }
+            }
+
+            const vector<OmmWorkItem>& m_vmWorkItems;
+            vector<Node> m_nodes;
+            vector<Neighbour> m_distances;
+        };
+
+        static ommResult DeduplicateSimilarVPTree(const StdAllocator<uint8_t>& allocator, const parallel::Scheduler& scheduler, const ommCpuBakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems)
         {
             if (options.disableDuplicateDetection)
                 return ommResult_SUCCESS;
 
-            if (!options.enableNearDuplicateDetection || !options.enableNearDuplicateDetectionBruteForce)
+            if (!options.enableNearDuplicateDetection || !options.enableNearDuplicateDetectionExact)
                return ommResult_SUCCESS;
 
             if (vmWorkItems.size() == 0)
                 return ommResult_SUCCESS;
 
             // The purpose of this pass is to identify "similar" OMMs, and then merge those.
-            // Unfortunatley the search is O(n^2) - Is this a problem? Yes. 
-            // Possible solutions:
-            // - If set is too large - don't do an exhaustive search, just sample. (Current solution).
-            // - Look in to LSH (locality senstive hashing) approaches.
+            // Unlike the LSH pass the search is exact: the nearest neighbours of every OMM closer than
+            // nearDuplicateDeduplicationFactor are looked up in a vantage point tree, in parallel and independent of the
+            // order of the OMMs. The closest pairs are then merged first, each OMM takes part in at most one merge.
 
-            static constexpr float kMergeThreshold = 0.1f; // If two OMMs differ less than kMergeThreshold % (treating all unknowns as equal) -> then we combine them.
-            static constexpr uint32_t kMaxComparsions = 2048; // Covert the O(n^2) nature of the algorithm to a -> O(kN) version...
+            // Below this the queries are cheaper to run on the calling thread than to hand out to workers.
+            static constexpr uint32_t kMinParallelWorkItems = 1024;
+            static constexpr uint32_t kQueriesPerTask = 64;
+            // Neighbours kept per OMM, the farther ones are used when the nearest was merged with another OMM first.
+            static constexpr uint32_t kMaxNeighbours = 4;
 
-            set<uint32_t> mergedWorkItems(allocator);
-            for (uint32_t itA = 0; itA < vmWorkItems.size() - 1; ++itA)
+            struct MergeCandidate
             {
-                OmmWorkItem& workItemA = vmWorkItems[itA];
-
-                if (workItemA.vmSpecialIndex != OmmWorkItem::kNoSpecialIndex)
-                    continue;
-
-                if (workItemA.vmFormat != ommFormat_OC1_4_State)
-                    continue;
+                float dist;
+                uint32_t to; // The lower work item index of the pair.
+                uint32_t from;
+            };
 
-                const uint32_t searchOffsetBase = itA + 1;
-                const uint32_t searchStart = searchOffsetBase;
-                const uint32_t searchEnd = std::min<uint32_t>(kMaxComparsions + searchStart, (uint32_t)vmWorkItems.size());
+            vector<uint32_t> workItemIndices(allocator);
+            vector<VPTree::Neighbour> neighbours(allocator);
+            vector<uint32_t> neighbourCounts(allocator);
+            vector<MergeCandidate> candidates(allocator);
+            vector<uint8_t> isMerged(vmWorkItems.size(), 0, allocator);
 
-                float minDist = std::numeric_limits<float>::max();
-                int32_t nearestIndex = -1;
-                for (uint32_t itB = searchStart; itB < searchEnd; ++itB)
+            for (uint32_t subdivisionLevel = 1; subdivisionLevel <= kMaxSubdivLevel; ++subdivisionLevel)
+            {
+                workItemIndices.clear();
+                for (uint32_t i = 0; i < vmWorkItems.size(); ++i)
                 {
-                    const OmmWorkItem& workItemB = vmWorkItems[itB];
+                    const OmmWorkItem& workItem = vmWorkItems[i];
 
-                    if (workItemB.vmSpecialIndex != OmmWorkItem::kNoSpecialIndex)
+                    if (workItem.vmSpecialIndex != OmmWorkItem::kNoSpecialIndex)
                         continue;
 
-                    if (workItemB.vmFormat != ommFormat_OC1_4_State)
+                    if (workItem.vmFormat != ommFormat_OC1_4_State)
                         continue;
 
-                    if (workItemB.primitiveIndices.empty())
+                    if (workItem.primitiveIndices.empty())
                         continue;
 
-                    if (workItemA.subdivisionLevel != workItemB.subdivisionLevel)
+                    if (workItem.subdivisionLevel != subdivisionLevel)
                         continue;
 
-                    if (mergedWorkItems.find(itB) != mergedWorkItems.end())
-                        continue;
+                    workItemIndices.push_back(i);
+                }
+
+                const uint32_t n = (uint32_t)workItemIndices.size();
+                if (n < 2)
+                    continue;
+
+                const float r = desc.nearDuplicateDeduplicationFactor * omm::bird::GetNumMicroTriangles(subdivisionLevel);
 
-                    const float dist = NormalizedHammingDistance3State(workItemA, workItemB);
+                VPTree tree(allocator, vmWorkItems);
+                tree.Build(workItemIndices);
 
-                    if (dist < kMergeThreshold && dist < minDist)
+                neighbours.resize(size_t(n) * kMaxNeighbours);
+                neighbourCounts.resize(n);
+                const bool enableThreads = options.enableInternalThreads && n >= kMinParallelWorkItems;
+                scheduler.ParallelForBlocks(allocator, enableThreads, n, kQueriesPerTask, [&](uint32_t begin, uint32_t end) {
+                    for (uint32_t it = begin; it < end; ++it)
+                        neighbourCounts[it] = tree.FindNearest(workItemIndices[it], r, &neighbours[size_t(it) * kMaxNeighbours], kMaxNeighbours);
+                });
+
+                candidates.clear();
+                for (uint32_t it = 0; it < n; ++it)
+                {
+                    for (uint32_t neighbourIt = 0; neighbourIt < neighbourCounts[it]; ++neighbourIt)
                     {
-                        minDist = dist;
-                        nearestIndex = (int32_t)itB;
+                        const VPTree::Neighbour& neighbour = neighbours[size_t(it) * kMaxNeighbours + neighbourIt];
+                        const uint32_t a = workItemIndices[it];
+                        const uint32_t b = neighbour.workItemIndex;
+                        candidates.push_back({ neighbour.dist, std::min(a, b), std::max(a, b) });
                     }
                 }
 
-                if (nearestIndex >= 0)
+                std::sort(candidates.begin(), candidates.end(), [](const MergeCandidate& a, const MergeCandidate& b) {
+                    return a.dist != b.dist ? a.dist < b.dist : a.to != b.to ? a.to < b.to : a.from < b.from;
+                });
+
+                // The states of an OMM only change when it's merged, the distances of the pairs left are still exact.
+                for (const MergeCandidate& candidate : candidates)
                 {
-                    OmmWorkItem& workItemB = vmWorkItems[nearestIndex];
+                    if (isMerged[candidate.to] || isMerged[candidate.from])
+                        continue;
 
-                    mergedWorkItems.insert(itA);
-                    mergedWorkItems.insert(nearestIndex);
-                    MergeWorkItems(workItemA /*to*/, workItemB /*from*/);
+                    isMerged[candidate.to] = 1;
+                    isMerged[candidate.from] = 1;
+                    MergeWorkItems(vmWorkItems[candidate.to] /*to*/, vmWorkItems[candidate.from] /*from*/);
                 }
             }
 
@@ -1473,17 +2104,15 @@ namespace Cpu
 
         static ommResult ComputeKnownStates(const OmmWorkItem& item, uint32_t& known, uint32_t& total)
         {
-            known = 0;
             total = omm::bird::GetNumMicroTriangles(item.subdivisionLevel);
-            for (uint i = 0; i < total; ++i)
+            uint32_t unknown = 0;
+            for (size_t wordIt = 0; wordIt < item.vmStates.GetNumWords(); ++wordIt)
             {
-                ommOpacityState state0 = item.vmStates.Get3State(i);
-
-                if (IsKnown(state0))
-                {
-                    known++;
-                }
+                // Unknown states have the high bit set, unused trailing states are zero.
+                const uint64_t word = item.vmStates.Get3StateWord(wordIt);
+                unknown += (uint32_t)std::popcount((word >> 1) & OmmArrayDataView::kLowBitMask);
             }
+            known = total - unknown;
             return ommResult_SUCCESS;
         }
 
@@ -1496,6 +2125,10 @@ namespace Cpu
             return ommResult_SUCCESS;
         }
 
+        // Four consecutive 3-state micro-triangles packed in a byte, that are all known and equal.
+        static constexpr uint8_t kAllTransparent3State = 0x00;
+        static constexpr uint8_t kAllOpaque3State = 0x55;
+
         static ommResult DownsampleOneLevel(OmmWorkItem& item)
         {
             if (item.subdivisionLevel == 0)
@@ -1506,16 +2139,20 @@ namespace Cpu
 
             const size_t numOmmForSubDivLvl = (size_t)omm::bird::GetNumMicroTriangles(subdivisionLevel);
 
+            // Each parent state is formed from one byte (four children) of the packed data,
+            // parents are written in increasing order so the data can be downsampled in place.
             for (uint i = 0; i < numOmmForSubDivLvl; ++i)
             {
-                ommOpacityState state0 = item.vmStates.Get3State(4 * i);
-                ommOpacityState state1 = item.vmStates.Get3State(4 * i + 1);
-                ommOpacityState state2 = item.vmStates.Get3State(4 * i + 2);
-                ommOpacityState state3 = item.vmStates.Get3State(4 * i + 3);
+                const uint64_t word = item.vmStates.Get3StateWord(i >> 3u);
+                const uint8_t children = (uint8_t)(word >> ((i & 7u) << 3u));
 
-                if (IsKnown(state0) && state0 == state1 && state0 == state2 && state0 == state3)
+                if (children == kAllTransparent3State)
+                {
+                    item.vmStates.SetState(i, ommOpacityState_Transparent);
+                }
+                else if (children == kAllOpaque3State)
                 {
-                    item.vmStates.SetState(i, state0);
+                    item.vmStates.SetState(i, ommOpacityState_Opaque);
                 }
                 else
                 {
@@ -1540,12 +2177,10 @@ namespace Cpu
             uint32_t known = 0;
             for (uint i = 0; i < numOmmForSubDivLvl; ++i)
             {
-                ommOpacityState state0 = item.vmStates.Get3State(4 * i);
-                ommOpacityState state1 = item.vmStates.Get3State(4 * i + 1);
-                ommOpacityState state2 = item.vmStates.Get3State(4 * i + 2);
-                ommOpacityState state3 = item.vmStates.Get3State(4 * i + 3);
+                const uint64_t word = item.vmStates.Get3StateWord(i >> 3u);
+                const uint8_t children = (uint8_t)(word >> ((i & 7u) << 3u));
 
-                if (IsKnown(state0) && state0 == state1 && state0 == state2 && state0 == state3)
+                if (children == kAllTransparent3State || children == kAllOpaque3State)
                 {
                     known++;
                 }
@@ -1704,7 +2339,21 @@ namespace Cpu
             return ommResult_SUCCESS;
         }
 
-        static ommResult MicromapSpatialSort(const StdAllocator<uint8_t>& allocator, const Options& options, const vector<OmmWorkItem>& vmWorkItems,
+        // Quantized morton code of the UV-triangle centroid.
+        static uint64_t GetSpatialSortKey(const Triangle& uvTri)
+        {
+            constexpr const uint32_t k = 13;
+            const int2 qSize = int2(1u << k, 1u << k);
+            const int2 qUV = int2(float2(qSize) * ((uvTri.p0 + uvTri.p1 + uvTri.p2) / 3.f));
+            const int2 qPosMirrored = GetTexCoord<ommTextureAddressMode_MirrorOnce, false>(qUV, qSize, {0,0});
+            OMM_ASSERT(qPosMirrored.x >= 0 && qPosMirrored.y >= 0);
+            const uint64_t mCode = xy_to_morton(qPosMirrored.x, qPosMirrored.y);
+            OMM_ASSERT(mCode < (1ull << (k << 1ull)));
+            OMM_ASSERT(mCode < (1ull << 60ull));
+            return mCode;
+        }
+
+        static ommResult MicromapSpatialSort(const StdAllocator<uint8_t>& allocator, const parallel::Scheduler& scheduler, const Options& options, const vector<OmmWorkItem>& vmWorkItems,
             vector<std::pair<uint64_t, uint32_t>>& sortKeys)
         {
             // The VMs should be sorted to respect the following rules:
@@ -1716,59 +2365,169 @@ namespace Cpu
 
             static constexpr uint32_t kTargetDeviceCacheLineSize = 128;
 
+            static constexpr uint32_t kSortKeysPerTask = 4096;
+
             sortKeys.resize(vmWorkItems.size());
             {
-                #pragma omp parallel for if(options.enableInternalThreads)
-                for (int32_t vmIndex = 0; vmIndex < vmWorkItems.size(); ++vmIndex) {
+                scheduler.ParallelForBlocks(allocator, options.enableInternalThreads, (uint32_t)vmWorkItems.size(), kSortKeysPerTask, [&](uint32_t begin, uint32_t end) {
+                    for (uint32_t vmIndex = begin; vmIndex < end; ++vmIndex) {
 
-                    const OmmWorkItem& vm = vmWorkItems[vmIndex];
-                    if (vm.vmSpecialIndex != OmmWorkItem::kNoSpecialIndex)
-                    {
-                        // For special indices, maintain original order.
-                        uint64_t key = (1ull << 63) | (uint64_t)vmIndex;
-                        sortKeys[vmIndex] = std::make_pair(key, vmIndex);
-                    }
-                    else {
-                        // For regular VMs,  Sort on Sub-div lvl and 
-                        // Order VMs in Morton-order in UV-space. 
-                        constexpr const uint32_t k = 13;
-                        const int2 qSize = int2(1u << k, 1u << k);
-                        const int2 qUV = int2(float2(qSize) * ((vm.uvTri.p0 + vm.uvTri.p1 + vm.uvTri.p2) / 3.f));
-                        const int2 qPosMirrored = GetTexCoord<ommTextureAddressMode_MirrorOnce, false>(qUV, qSize, {0,0});
-                        OMM_ASSERT(qPosMirrored.x >= 0 && qPosMirrored.y >= 0);
-                        const uint64_t mCode = xy_to_morton(qPosMirrored.x, qPosMirrored.y);
-                        OMM_ASSERT(mCode < (1ull << (k << 1ull)));
-                        OMM_ASSERT(mCode < (1ull << 60ull));
-
-                        // First sort on sub-div lvl.
-                        uint64_t key = 0;
-                        key |= (uint64_t)vm.subdivisionLevel << 60;
-                        key |= mCode;
-                        sortKeys[vmIndex] = std::make_pair(key, vmIndex);
+                        const OmmWorkItem& vm = vmWorkItems[vmIndex];
+                        if (vm.vmSpecialIndex != OmmWorkItem::kNoSpecialIndex)
+                        {
+                            // For special indices, maintain original order.
+                            uint64_t key = (1ull << 63) | (uint64_t)vmIndex;
+                            sortKeys[vmIndex] = std::make_pair(key, vmIndex);
+                        }
+                        else {
+                            // For regular VMs,  Sort on Sub-div lvl and 
+                            // Order VMs in Morton-order in UV-space. 
+                            const uint64_t mCode = GetSpatialSortKey(vm.uvTri);
+
+                            // First sort on sub-div lvl.
+                            uint64_t key = 0;
+                            key |= (uint64_t)vm.subdivisionLevel << 60;
+                            key |= mCode;
+                            sortKeys[vmIndex] = std::make_pair(key, vmIndex);
+                        }
                     }
-                }
+                });
 
                 std::sort(sortKeys.begin(), sortKeys.end(), std::greater<std::pair<uint64_t, uint32_t>>());
             }
             return ommResult_SUCCESS;
         }
 
-        static ommResult Serialize(
-            const StdAllocator<uint8_t>& allocator, 
-            const ommCpuBakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems, const VisibilityMapUsageHistogram& ommArrayHistogram, const VisibilityMapUsageHistogram& ommIndexHistogram,
-            const vector<std::pair<uint64_t, uint32_t>>& sortKeys,
-            BakeResultImpl& res)
+        static void SerializeStates(const OmmWorkItem& vm, uint8_t* ommArrayDataPtr)
+        {
+            const uint32_t numMicroTriangles = bird::GetNumMicroTriangles(vm.subdivisionLevel);
+            if (vm.vmFormat == ommFormat_OC1_2_State)
+            {
+                // Keep the low bit of each 2-bit state, 32 states -> 4 bytes per word.
+                const size_t numWords = vm.vmStates.GetNumWords();
+                const uint32_t numBytes = std::max(numMicroTriangles >> 3u, 1u);
+                for (size_t wordIt = 0; wordIt < numWords; ++wordIt)
+                {
+                    uint64_t x = vm.vmStates.GetData()[wordIt] & OmmArrayDataView::kLowBitMask;
+                    x = (x | (x >> 1)) & 0x3333333333333333ull;
+                    x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+                    x = (x | (x >> 4)) & 0x00FF00FF00FF00FFull;
+                    x = (x | (x >> 8)) & 0x0000FFFF0000FFFFull;
+                    x = (x | (x >> 16)) & 0x00000000FFFFFFFFull;
+
+                    const uint32_t bits = (uint32_t)x;
+                    const uint32_t byteOffset = (uint32_t)wordIt << 2u;
+                    std::memcpy(ommArrayDataPtr + byteOffset, &bits, std::min(numBytes - byteOffset, 4u));
+                }
+            }
+            else
+            {
+                // The packed layout is the OC1_4_State layout.
+                const uint32_t numBytes = std::max(numMicroTriangles >> 2u, 1u);
+                std::memcpy(ommArrayDataPtr, vm.vmStates.GetData(), numBytes);
+            }
+        }
+
+        static uint32_t GetSerializedSize(const OmmWorkItem& vm)
+        {
+            const uint32_t numMicroTriangles = bird::GetNumMicroTriangles(vm.subdivisionLevel);
+            // Offsets must be at least 1B aligned.
+            return std::max((numMicroTriangles * omm::bird::GetBitCount(vm.vmFormat)) >> 3u, 1u);
+        }
+
+        // Compares serialized states the way DeduplicateExact compares work items, unknown states match either way.
+        static bool IsEqual3StateSerialized(ommFormat format, const uint8_t* a, const uint8_t* b, size_t size)
+        {
+            if (format == ommFormat_OC1_2_State)
+                return std::memcmp(a, b, size) == 0;
+
+            for (size_t i = 0; i < size; ++i)
+            {
+                if ((a[i] | ((a[i] >> 1) & 0x55)) != (b[i] | ((b[i] >> 1) & 0x55)))
+                    return false;
+            }
+            return true;
+        }
+
+        // Allocate the final ommArrayHistogram & ommIndexHistogram
+        static void AllocateUsageHistograms(const VisibilityMapUsageHistogram& ommArrayHistogram, const VisibilityMapUsageHistogram& ommIndexHistogram, BakeResultImpl& res)
+        {
+            static constexpr uint32_t kMaxFormats = 2;
+            static_assert(kMaxFormats == (int)ommFormat_MAX_NUM - 1);
+            res.ommArrayHistogram.reserve(kMaxFormats * kMaxNumSubdivLevels);
+            res.ommIndexHistogram.reserve(kMaxFormats * kMaxNumSubdivLevels);
+            for (ommFormat vmFormat : { ommFormat_OC1_2_State, ommFormat_OC1_4_State, }) {
+                for (uint32_t subDivLvl = 0; subDivLvl < kMaxNumSubdivLevels; ++subDivLvl) {
+
+                    {
+                        uint32_t vmCount = ommArrayHistogram.GetOmmCount(vmFormat, subDivLvl);
+                        if (vmCount != 0) {
+                            res.ommArrayHistogram.push_back({ vmCount, (uint16_t)subDivLvl, (uint16_t)vmFormat });
+                        }
+                    }
+
+                    {
+                        uint32_t vmCount = ommIndexHistogram.GetOmmCount(vmFormat, subDivLvl);
+                        if (vmCount != 0) {
+                            res.ommIndexHistogram.push_back({ vmCount, (uint16_t)subDivLvl, (uint16_t)vmFormat });
+                        }
+                    }
+                }
+            }
+        }
+
+        // Compress to 16 bit indices if possible & allowed. The indices address ommCount OMMs, a single bake never produces more
+        // OMMs than triangles, a batch bake shares its OMM array between all inputs.
+        static ommIndexFormat CompressIndexBuffer(const ommCpuBakeInputDesc& desc, size_t ommCount, BakeResultImpl& res)
         {
+            const int32_t triangleCount = desc.indexCount / 3;
+
+            const bool allow8bitIndices = ((int32_t)desc.bakeFlags & (int32_t)ommCpuBakeFlags_Allow8BitIndices) == (int32_t)ommCpuBakeFlags_Allow8BitIndices;
+            const bool force32bitIndices = ((int32_t)desc.bakeFlags & (int32_t)ommCpuBakeFlags_Force32BitIndices) == (int32_t)ommCpuBakeFlags_Force32BitIndices;
+            const bool canCompressTo8Bit = ommCount <= (size_t)std::numeric_limits<int8_t>::max();
+            const bool canCompressTo16Bit = ommCount <= (size_t)std::numeric_limits<int16_t>::max();
+
+            if (allow8bitIndices && canCompressTo8Bit && !force32bitIndices)
+            {
+                int8_t* ommIndexBuffer8 = (int8_t*)res.ommIndexBuffer.data();
+                for (int32_t i = 0; i < triangleCount; ++i) {
+                    int32_t idx = res.ommIndexBuffer[i];
+                    int8_t idx8 = (int8_t)idx;
+                    ommIndexBuffer8[i] = idx8;
+                }
+
+                return ommIndexFormat_UINT_8;
+            }
+            else if (canCompressTo16Bit && !force32bitIndices)
             {
-                const uint32_t ommBitCount = omm::bird::GetBitCount(desc.format);
+                int16_t* ommIndexBuffer16 = (int16_t*)res.ommIndexBuffer.data();
+                for (int32_t i = 0; i < triangleCount; ++i) {
+                    int32_t idx = res.ommIndexBuffer[i];
+                    int16_t idx16 = (int16_t)idx;
+                    ommIndexBuffer16[i] = idx16;
+                }
+
+                return ommIndexFormat_UINT_16;
+            }
+
+            return ommIndexFormat_UINT_32;
+        }
 
+        // Writes the OMM array data and desc array, in sortKeys order, and assigns vmDescOffset to every non-special work item.
+        static ommResult SerializeArrayData(vector<OmmWorkItem>& vmWorkItems, const VisibilityMapUsageHistogram& ommArrayHistogram,
+            const vector<std::pair<uint64_t, uint32_t>>& sortKeys, BakeResultImpl& res)
+        {
+            {
                 uint32_t ommDescArrayCount = 0;
                 size_t ommArrayDataSize = 0;
-                for (uint32_t i = 0; i < kMaxNumSubdivLevels; ++i) {
-                    const uint32_t ommCount = ommArrayHistogram.GetOmmCount(desc.format, i);
-                    ommDescArrayCount += ommCount;
-                    const size_t numOmmForSubDivLvl = (size_t)omm::bird::GetNumMicroTriangles(i) * ommBitCount;
-                    ommArrayDataSize += size_t(ommCount) * std::max<size_t>(numOmmForSubDivLvl >> 3ull, 1ull);
+                for (ommFormat vmFormat : { ommFormat_OC1_2_State, ommFormat_OC1_4_State, }) {
+                    const uint32_t ommBitCount = omm::bird::GetBitCount(vmFormat);
+                    for (uint32_t i = 0; i < kMaxNumSubdivLevels; ++i) {
+                        const uint32_t ommCount = ommArrayHistogram.GetOmmCount(vmFormat, i);
+                        ommDescArrayCount += ommCount;
+                        const size_t numOmmForSubDivLvl = (size_t)omm::bird::GetNumMicroTriangles(i) * ommBitCount;
+                        ommArrayDataSize += size_t(ommCount) * std::max<size_t>(numOmmForSubDivLvl >> 3ull, 1ull);
+                    }
                 }
 
                 if (ommArrayDataSize > std::numeric_limits<uint32_t>::max()) // Array data > 4GB? ouch
@@ -1799,57 +2558,25 @@ namespace Cpu
                             res.ommDescArray[vmDescOffset].offset = ommArrayDataOffset;
                             vm.vmDescOffset = vmDescOffset++;
 
-                            const uint32_t numMicroTriangles = bird::GetNumMicroTriangles(vm.subdivisionLevel);
-
-                            uint8_t* ommArrayDataPtr = res.ommArrayData.data() + ommArrayDataOffset;
-                            const uint32_t is2State = vm.vmFormat == ommFormat_OC1_2_State;
-                            for (uint32_t uTriIt = 0; uTriIt < numMicroTriangles; ++uTriIt)
-                            {
-                                uint32_t state = ((uint32_t)vm.vmStates.GetState(uTriIt));
-
-                                uint8_t val;
-                                if (is2State)   val = state << ((uTriIt & 7));
-                                else            val = state << ((uTriIt & 3) << 1u);
-
-                                uint32_t byteIndex = uTriIt >> (2 + is2State);
-                                ommArrayDataPtr[byteIndex] |= val;
-                            }
+                            SerializeStates(vm, res.ommArrayData.data() + ommArrayDataOffset);
 
-                            // Offsets must be at least 1B aligned.
-                            ommArrayDataOffset += std::max((numMicroTriangles * ommBitCount) >> 3u, 1u);
+                            ommArrayDataOffset += GetSerializedSize(vm);
                         }
                     }
                 }
             }
+            return ommResult_SUCCESS;
+        }
 
-            // Allocate the final ommArrayHistogram & ommIndexHistogram
-            {
-                static constexpr uint32_t kMaxFormats = 2;
-                static_assert(kMaxFormats == (int)ommFormat_MAX_NUM - 1);
-                res.ommArrayHistogram.reserve(kMaxFormats * kMaxNumSubdivLevels);
-                res.ommIndexHistogram.reserve(kMaxFormats * kMaxNumSubdivLevels);
-                uint32_t ommUsageDescCount = 0;
-                {
-                    for (ommFormat vmFormat : { ommFormat_OC1_2_State, ommFormat_OC1_4_State, }) {
-                        for (uint32_t subDivLvl = 0; subDivLvl < kMaxNumSubdivLevels; ++subDivLvl) {
-
-                            {
-                                uint32_t vmCount = ommArrayHistogram.GetOmmCount(vmFormat, subDivLvl);
-                                if (vmCount != 0) {
-                                    res.ommArrayHistogram.push_back({ vmCount, (uint16_t)subDivLvl, (uint16_t)vmFormat });
-                                }
-                            }
+        static ommResult Serialize(
+            const StdAllocator<uint8_t>& allocator, 
+            const ommCpuBakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems, const VisibilityMapUsageHistogram& ommArrayHistogram, const VisibilityMapUsageHistogram& ommIndexHistogram,
+            const vector<std::pair<uint64_t, uint32_t>>& sortKeys,
+            BakeResultImpl& res)
+        {
+            RETURN_STATUS_IF_FAILED(SerializeArrayData(vmWorkItems, ommArrayHistogram, sortKeys, res));
 
-                            {
-                                uint32_t vmCount = ommIndexHistogram.GetOmmCount(vmFormat, subDivLvl);
-                                if (vmCount != 0) {
-                                    res.ommIndexHistogram.push_back({ vmCount, (uint16_t)subDivLvl, (uint16_t)vmFormat });
-                                }
-                            }
-                        }
-                    }
-                }
-            }
+            AllocateUsageHistograms(ommArrayHistogram, ommIndexHistogram, res);
 
             const int32_t triangleCount = desc.indexCount / 3;
 
@@ -1869,57 +2596,491 @@ namespace Cpu
                 }
             }
 
-            // Compress to 16 bit indices if possible & allowed.
-            ommIndexFormat ommIndexFormat = ommIndexFormat_UINT_32;
+            const ommIndexFormat ommIndexFormat = CompressIndexBuffer(desc, desc.indexCount / 3, res);
+
             {
-                const bool allow8bitIndices = ((int32_t)desc.bakeFlags & (int32_t)ommCpuBakeFlags_Allow8BitIndices) == (int32_t)ommCpuBakeFlags_Allow8BitIndices;
-                const bool force32bitIndices = ((int32_t)desc.bakeFlags & (int32_t)ommCpuBakeFlags_Force32BitIndices) == (int32_t)ommCpuBakeFlags_Force32BitIndices;
-                const bool canCompressTo8Bit = triangleCount <= std::numeric_limits<int8_t>::max();
-                const bool canCompressTo16Bit = triangleCount <= std::numeric_limits<int16_t>::max();
+                res.ommTriangleArea.resize(triangleCount);
+                for (const OmmWorkItem& item : vmWorkItems)
+                {
+                    for (uint32_t primitiveIndex : item.primitiveIndices)
+                    {
+                        const Triangle uvTri = GetTriangle(desc, primitiveIndex);
+
+                        res.ommTriangleArea[primitiveIndex] = GetArea2D(uvTri);
+                    }
+                }
+            }
+
+            res.Finalize(ommIndexFormat);
+
+            return ommResult_SUCCESS;
+        }
+
+        // Writes the index buffer, index histogram and triangle areas of each input of a batch bake. The work item primitive
+        // indices address the concatenated primitives of all inputs, input i starts at primitiveOffsets[i]. The OMM array is
+        // shared by all inputs and must have been serialized to shared.
+        static ommResult SerializeBatchIndexBuffers(
+            const StdAllocator<uint8_t>& allocator, const ommCpuBakeInputDesc* descs, uint32_t descCount, const vector<uint32_t>& primitiveOffsets,
+            const vector<OmmWorkItem>& vmWorkItems, const BakeResultImpl& shared, vector<BakeResultImpl>& results)
+        {
+            const uint32_t totalTriangleCount = primitiveOffsets[descCount];
+
+            vector<int32_t> ommIndexBuffer(totalTriangleCount, allocator);
+            vector<float> ommTriangleArea(totalTriangleCount, 0.f, allocator);
+            for (uint32_t descIt = 0; descIt < descCount; ++descIt)
+                std::fill(ommIndexBuffer.begin() + primitiveOffsets[descIt], ommIndexBuffer.begin() + primitiveOffsets[descIt + 1], (int32_t)descs[descIt].unresolvedTriState);
 
-                if (allow8bitIndices && canCompressTo8Bit && !force32bitIndices)
+            for (const OmmWorkItem& vm : vmWorkItems)
+            {
+                for (uint32_t primitiveIndex : vm.primitiveIndices)
+                {
+                    if (vm.vmSpecialIndex != OmmWorkItem::kNoSpecialIndex)
+                        ommIndexBuffer[primitiveIndex] = vm.vmSpecialIndex;
+                    else
+                        ommIndexBuffer[primitiveIndex] = vm.vmDescOffset;
+
+                    const uint32_t descIt = (uint32_t)(std::upper_bound(primitiveOffsets.begin(), primitiveOffsets.end(), primitiveIndex) - primitiveOffsets.begin()) - 1;
+                    ommTriangleArea[primitiveIndex] = GetArea2D(GetTriangle(descs[descIt], primitiveIndex - primitiveOffsets[descIt]));
+                }
+            }
+
+            results.reserve(descCount);
+            for (uint32_t descIt = 0; descIt < descCount; ++descIt)
+            {
+                results.emplace_back(allocator);
+                BakeResultImpl& res = results.back();
+
+                const uint32_t begin = primitiveOffsets[descIt];
+                const uint32_t end = primitiveOffsets[descIt + 1];
+
+                res.ommIndexBuffer.assign(ommIndexBuffer.begin() + begin, ommIndexBuffer.begin() + end);
+                res.ommTriangleArea.assign(ommTriangleArea.begin() + begin, ommTriangleArea.begin() + end);
+
+                VisibilityMapUsageHistogram indexHistogram;
+                for (int32_t index : res.ommIndexBuffer)
                 {
-                    int8_t* ommIndexBuffer8 = (int8_t*)res.ommIndexBuffer.data();
-                    for (int32_t i = 0; i < triangleCount; ++i) {
-                        int32_t idx = res.ommIndexBuffer[i];
-                        int8_t idx8 = (int8_t)idx;
-                        ommIndexBuffer8[i] = idx8;
+                    if (index >= 0)
+                    {
+                        const ommCpuOpacityMicromapDesc& ommDesc = shared.ommDescArray[index];
+                        indexHistogram.Inc((ommFormat)ommDesc.format, ommDesc.subdivisionLevel, 1 /*vm count*/);
                     }
+                }
+
+                AllocateUsageHistograms(VisibilityMapUsageHistogram(), indexHistogram, res);
 
-                    ommIndexFormat = ommIndexFormat_UINT_8;
+                const ommIndexFormat ommIndexFormat = CompressIndexBuffer(descs[descIt], shared.ommDescArray.size(), res);
+
+                res.Finalize(ommIndexFormat);
+                res.ShareArrayData(shared);
+            }
+
+            return ommResult_SUCCESS;
+        }
+
+        // Rough footprint of one hash_map entry, the node with its link plus a bucket.
+        template<class TKey, class TVal>
+        static constexpr size_t GetHashMapEntrySize()
+        {
+            return sizeof(std::pair<const TKey, TVal>) + 2 * sizeof(void*);
+        }
+
+        // Streaming bake, used when desc.maxWorkingSetBytes is set.
+        // Primitives are ordered spatially and processed in chunks whose working set fits within maxWorkingSetBytes, minus what
+        // the global digest table holds by then. Each finished chunk is deduplicated against the global digest table, and new
+        // OMM blocks are appended to one stream per subdivision level and format. The streams are concatenated (largest
+        // subdivision level first) in to the final result.
+        template<ommCpuTextureFormat eFormat, TilingMode eTilingMode, ommTextureAddressMode eTextureAddressMode, ommTextureFilterMode eFilterMode, bool bTexIsPow2>
+        static ommResult BakeStreaming(const StdAllocator<uint8_t>& allocator, const parallel::Scheduler& scheduler, BakeProgressImpl& progress, const Logger& log, const ommCpuBakeInputDesc& desc, const Options& options, BakeResultImpl& res)
+        {
+            const TextureImpl* texture = GetHandleImpl<TextureImpl>(desc.texture);
+            const int32_t triangleCount = desc.indexCount / 3u;
+
+            struct PrimitiveKey
+            {
+                uint64_t spatialKey;
+                uint32_t primitiveIndex;
+                uint32_t workingSetSize;
+            };
+
+            // 1. Order primitives spatially, and estimate the working set of each.
+            vector<PrimitiveKey> primitives(allocator);
+            {
+                primitives.reserve(triangleCount);
+
+                uint32_t numDisabledTri = 0;
+                for (int32_t i = 0; i < triangleCount; ++i)
+                {
+                    const Triangle uvTri = GetTriangle(desc, i);
+                    const int32_t subdivisionLevel = GetSubdivisionLevelForPrimitive(desc, options, i, uvTri, texture->GetSize(0 /*always based on mip 0*/));
+
+                    if (subdivisionLevel == kDisabledPrimitive || GetIsInvalid(options, uvTri))
+                    {
+                        numDisabledTri++;
+                        continue; // These indices will be set to special index unknown later.
+                    }
+
+                    if (kMaxSubdivLevel < subdivisionLevel)
+                    {
+                        return log.InvalidArg("[Invalid Argument] - subdivisionLevel for primitive (i) is (d) which exceeds kMaxSubdivLevel(12)");
+                    }
+
+                    // The work item and its states, its entry in the chunk's primitive list, the work item's primitive list and the
+                    // index list of exact deduplication, and its entries in the triangle ID and digest maps.
+                    const size_t numWords = OmmArrayDataView::GetNumWords(omm::bird::GetNumMicroTriangles(subdivisionLevel));
+                    const uint32_t workingSetSize = (uint32_t)(sizeof(OmmWorkItem) + numWords * sizeof(uint64_t) + 3 * sizeof(uint32_t) +
+                        GetHashMapEntrySize<size_t, uint32_t>() + GetHashMapEntrySize<uint64_t, uint32_t>());
+                    primitives.push_back({ GetSpatialSortKey(uvTri), (uint32_t)i, workingSetSize });
                 }
-                else if (canCompressTo16Bit && !force32bitIndices)
+
+                if (options.enableValidation && numDisabledTri != 0)
                 {
-                    int16_t* ommIndexBuffer16 = (int16_t*)res.ommIndexBuffer.data();
-                    for (int32_t i = 0; i < triangleCount; ++i) {
-                        int32_t idx = res.ommIndexBuffer[i];
-                        int16_t idx16 = (int16_t)idx;
-                        ommIndexBuffer16[i] = idx16;
+                    const char* specialIndex = ToString(desc.unresolvedTriState);
+                    log.Infof("[Info] - The workload consists of %d unclassifiable triangles, these will be classified as unresolvedTriState = %s.",
+                        numDisabledTri, specialIndex);
+                }
+
+                std::sort(primitives.begin(), primitives.end(), [](const PrimitiveKey& a, const PrimitiveKey& b) {
+                    return a.spatialKey < b.spatialKey || (a.spatialKey == b.spatialKey && a.primitiveIndex < b.primitiveIndex);
+                });
+            }
+
+            // Until the streams are concatenated the index buffer holds either a special index (negative) or the streamed omm index.
+            res.ommIndexBuffer.resize(triangleCount);
+            std::fill(res.ommIndexBuffer.begin(), res.ommIndexBuffer.end(), (int32_t)desc.unresolvedTriState);
+            res.ommTriangleArea.resize(triangleCount);
+
+            static constexpr uint32_t kNumStreams = 2 * kMaxNumSubdivLevels;
+            auto GetStreamIndex = [](ommFormat format, uint32_t subdivisionLevel)->uint32_t {
+                return 2 * subdivisionLevel + (format == ommFormat_OC1_4_State ? 1 : 0);
+            };
+
+            static constexpr uint32_t kNoStreamedOmm = 0xFFFFFFFF;
+            struct StreamedOmm
+            {
+                uint32_t stream;
+                uint32_t localIndex;
+                uint32_t nextWithDigest; // Next streamed omm sharing the same digest, or kNoStreamedOmm.
+                uint32_t minPrimitiveIndex; // Lowest primitive using the omm, its states are the ones streamed.
+            };
+            static constexpr size_t kStreamedOmmSize = sizeof(StreamedOmm) + GetHashMapEntrySize<uint64_t, uint32_t>();
+
+            vector<StreamedOmm> streamedOmms(allocator);
+            vector<vector<uint8_t>> streams(kNumStreams, vector<uint8_t>(allocator), allocator);
+            hash_map<uint64_t, uint32_t> digestToStreamedOmm(allocator.GetInterface());
+            VisibilityMapUsageHistogram arrayHistogram;
+            VisibilityMapUsageHistogram indexHistogram;
+
+            // 2. Process the primitives chunk by chunk.
+            {
+                vector<OmmWorkItem> vmWorkItems(allocator);
+                vector<uint32_t> chunkPrimitives(allocator);
+                vector<uint8_t> serializedStates(allocator);
+                uint64_t workloadSize = 0;
+
+                size_t primitiveIt = 0;
+                while (primitiveIt < primitives.size())
+                {
+                    RETURN_STATUS_IF_FAILED(progress.CheckCancelled());
+
+                    // The global digest table grows with every new omm and takes its share of the budget.
+                    const uint64_t globalWorkingSetSize = streamedOmms.size() * kStreamedOmmSize;
+                    const uint64_t chunkBudget = desc.maxWorkingSetBytes > globalWorkingSetSize ? desc.maxWorkingSetBytes - globalWorkingSetSize : 0;
+
+                    chunkPrimitives.clear();
+                    uint64_t chunkWorkingSetSize = 0;
+                    while (primitiveIt < primitives.size())
+                    {
+                        const PrimitiveKey& primitive = primitives[primitiveIt];
+                        // A single primitive exceeding the budget is processed on its own.
+                        if (!chunkPrimitives.empty() && chunkWorkingSetSize + primitive.workingSetSize > chunkBudget)
+                            break;
+
+                        chunkWorkingSetSize += primitive.workingSetSize;
+                        chunkPrimitives.push_back(primitive.primitiveIndex);
+                        primitiveIt++;
+                    }
+
+                    // In primitive order, so that exact deduplication keeps the states of the chunk's lowest primitive like
+                    // the bake in one go does.
+                    std::sort(chunkPrimitives.begin(), chunkPrimitives.end());
+
+                    vmWorkItems.clear();
+
+                    RETURN_STATUS_IF_FAILED(SetupWorkItems(allocator, log, desc, options, chunkPrimitives.data(), (uint32_t)chunkPrimitives.size(), vmWorkItems));
+
+                    if (desc.maxWorkloadSize != 0xFFFFFFFFFFFFFFFF || options.enableValidation)
+                    {
+                        workloadSize += ComputeWorkloadSize(desc, vmWorkItems);
+                        if (workloadSize > desc.maxWorkloadSize)
+                            return ommResult_WORKLOAD_TOO_BIG;
+                    }
+
+                    RETURN_STATUS_IF_FAILED((Resample<eFormat, eTilingMode, eTextureAddressMode, eFilterMode, bTexIsPow2>(allocator, scheduler, progress, desc, log, options, vmWorkItems)));
+
+                    progress.BeginStage(ommCpuBakeStage_Deduplicate);
+                    RETURN_STATUS_IF_FAILED(PromoteToSpecialIndices(desc, options, vmWorkItems));
+
+                    RETURN_STATUS_IF_FAILED(DeduplicateExact(allocator, scheduler, log, options, vmWorkItems));
+
+                    // Merge the chunk in to the global result.
+                    for (OmmWorkItem& vm : vmWorkItems)
+                    {
+                        if (vm.primitiveIndices.empty())
+                            continue;
+
+                        int32_t index = (int32_t)vm.vmSpecialIndex;
+                        if (!vm.HasSpecialIndex())
+                        {
+                            const uint32_t stream = GetStreamIndex(vm.vmFormat, vm.subdivisionLevel);
+                            const size_t ommSize = GetSerializedSize(vm);
+                            serializedStates.resize(ommSize);
+                            std::fill(serializedStates.begin(), serializedStates.end(), (uint8_t)0);
+                            SerializeStates(vm, serializedStates.data());
+
+                            // Digests may collide, so a hit only counts when the states already in the stream match. Like exact
+                            // deduplication within a chunk this ignores the unknown state, and the states of the lowest primitive
+                            // are kept, so chunk boundaries don't change the result.
+                            uint64_t digest = 0;
+                            auto it = digestToStreamedOmm.end();
+                            uint32_t match = kNoStreamedOmm;
+                            if (!options.disableDuplicateDetection)
+                            {
+                                digest = GetDigest(vm);
+                                it = digestToStreamedOmm.find(digest);
+                                for (uint32_t candidate = it != digestToStreamedOmm.end() ? it->second : kNoStreamedOmm; candidate != kNoStreamedOmm; candidate = streamedOmms[candidate].nextWithDigest)
+                                {
+                                    const StreamedOmm& omm = streamedOmms[candidate];
+                                    if (omm.stream == stream && IsEqual3StateSerialized(vm.vmFormat, streams[stream].data() + omm.localIndex * ommSize, serializedStates.data(), ommSize))
+                                    {
+                                        match = candidate;
+                                        break;
+                                    }
+                                }
+                            }
+
+                            const uint32_t minPrimitiveIndex = *std::min_element(vm.primitiveIndices.begin(), vm.primitiveIndices.end());
+                            if (match != kNoStreamedOmm)
+                            {
+                                index = (int32_t)match;
+
+                                StreamedOmm& omm = streamedOmms[match];
+                                if (minPrimitiveIndex < omm.minPrimitiveIndex)
+                                {
+                                    std::memcpy(streams[stream].data() + omm.localIndex * ommSize, serializedStates.data(), ommSize);
+                                    omm.minPrimitiveIndex = minPrimitiveIndex;
+                                }
+                            }
+                            else
+                            {
+                                index = (int32_t)streamedOmms.size();
+
+                                const uint32_t localIndex = arrayHistogram.GetOmmCount(vm.vmFormat, vm.subdivisionLevel);
+                                arrayHistogram.Inc(vm.vmFormat, vm.subdivisionLevel, 1 /*vm count*/);
+
+                                streams[stream].insert(streams[stream].end(), serializedStates.begin(), serializedStates.end());
+
+                                const uint32_t nextWithDigest = it != digestToStreamedOmm.end() ? it->second : kNoStreamedOmm;
+                                streamedOmms.push_back({ stream, localIndex, nextWithDigest, minPrimitiveIndex });
+
+                                if (it != digestToStreamedOmm.end())
+                                    it->second = (uint32_t)index;
+                                else if (!options.disableDuplicateDetection)
+                                    digestToStreamedOmm.insert(std::make_pair(digest, (uint32_t)index));
+                            }
+
+                            indexHistogram.Inc(vm.vmFormat, vm.subdivisionLevel, (uint32_t)vm.primitiveIndices.size() /*vm count*/);
+                        }
+
+                        for (uint32_t primitiveIndex : vm.primitiveIndices)
+                        {
+                            res.ommIndexBuffer[primitiveIndex] = index;
+                            res.ommTriangleArea[primitiveIndex] = GetArea2D(GetTriangle(desc, primitiveIndex));
+                        }
                     }
+                }
 
-                    ommIndexFormat = ommIndexFormat_UINT_16;
+                if (options.enableValidation)
+                {
+                    RETURN_STATUS_IF_FAILED(ValidateWorkloadSize(log, desc, options, workloadSize));
                 }
             }
 
+            // 3. Concatenate the streams, largest subdivision level first.
+            progress.BeginStage(ommCpuBakeStage_Serialize);
             {
-                res.ommTriangleArea.resize(triangleCount);
-                for (const OmmWorkItem& item : vmWorkItems)
+                size_t ommArrayDataSize = 0;
+                for (const vector<uint8_t>& stream : streams)
+                    ommArrayDataSize += stream.size();
+
+                if (ommArrayDataSize > std::numeric_limits<uint32_t>::max()) // Array data > 4GB? ouch
+                    return ommResult_FAILURE;
+
+                res.ommArrayData.resize(ommArrayDataSize);
+                res.ommDescArray.resize(streamedOmms.size());
+
+                uint32_t streamDescOffset[kNumStreams];
+                uint32_t ommArrayDataOffset = 0;
+                uint32_t vmDescOffset = 0;
+                for (int32_t subdivisionLevel = kMaxSubdivLevel; subdivisionLevel >= 0; --subdivisionLevel)
                 {
-                    for (uint32_t primitiveIndex : item.primitiveIndices)
+                    for (ommFormat vmFormat : { ommFormat_OC1_2_State, ommFormat_OC1_4_State, })
                     {
-                        const Triangle uvTri = GetTriangle(desc, primitiveIndex);
+                        const uint32_t streamIndex = GetStreamIndex(vmFormat, subdivisionLevel);
+                        vector<uint8_t>& stream = streams[streamIndex];
+                        streamDescOffset[streamIndex] = vmDescOffset;
 
-                        res.ommTriangleArea[primitiveIndex] = GetArea2D(uvTri);
+                        const uint32_t ommCount = arrayHistogram.GetOmmCount(vmFormat, subdivisionLevel);
+                        if (ommCount == 0)
+                            continue;
+
+                        const uint32_t ommSize = (uint32_t)(stream.size() / ommCount);
+                        for (uint32_t i = 0; i < ommCount; ++i)
+                        {
+                            res.ommDescArray[vmDescOffset].subdivisionLevel = (uint16_t)subdivisionLevel;
+                            res.ommDescArray[vmDescOffset].format = (uint16_t)vmFormat;
+                            res.ommDescArray[vmDescOffset].offset = ommArrayDataOffset + i * ommSize;
+                            vmDescOffset++;
+                        }
+
+                        std::memcpy(res.ommArrayData.data() + ommArrayDataOffset, stream.data(), stream.size());
+                        ommArrayDataOffset += (uint32_t)stream.size();
+
+                        // Release the stream as soon as it's been copied.
+                        vector<uint8_t>(allocator).swap(stream);
+                    }
+                }
+
+                for (int32_t& index : res.ommIndexBuffer)
+                {
+                    if (index >= 0)
+                    {
+                        const StreamedOmm& omm = streamedOmms[index];
+                        index = (int32_t)(streamDescOffset[omm.stream] + omm.localIndex);
                     }
                 }
             }
 
+            AllocateUsageHistograms(arrayHistogram, indexHistogram, res);
+
+            const ommIndexFormat ommIndexFormat = CompressIndexBuffer(desc, desc.indexCount / 3, res);
+
             res.Finalize(ommIndexFormat);
 
             return ommResult_SUCCESS;
         }
+
+        // Hashes everything the result of a bake depends on: the texture contents, the per-triangle UVs, formats and
+        // subdivision levels and the bake settings. The UVs are hashed after decoding, so the key doesn't depend on the
+        // index format, the vertex layout or the texture tiling.
+        static uint64_t ComputeCacheKey(const ommCpuBakeInputDesc& desc)
+        {
+            const TextureImpl* texture = GetHandleImpl<TextureImpl>(desc.texture);
+
+            struct KeyHeader
+            {
+                uint32_t versionMajor;
+                uint32_t versionMinor;
+                uint32_t versionBuild;
+                uint32_t serializeVersion;
+                uint64_t textureHash;
+                uint64_t maxWorkloadSize;
+                uint64_t maxWorkingSetBytes;
+                uint32_t bakeFlags;
+                uint32_t addressingMode;
+                uint32_t filter;
+                float borderAlpha;
+                uint32_t alphaMode;
+                float dynamicSubdivisionScale;
+                float rejectionThreshold;
+                float alphaCutoff;
+                float nearDuplicateDeduplicationFactor;
+                uint32_t alphaCutoffLessEqual;
+                uint32_t alphaCutoffGreater;
+                uint32_t format;
+                uint32_t unknownStatePromotion;
+                uint32_t unresolvedTriState;
+                uint32_t maxSubdivisionLevel;
+                uint32_t maxArrayDataSize;
+                uint32_t triangleCount;
+            };
+
+            KeyHeader header;
+            std::memset(&header, 0, sizeof(header));
+            header.versionMajor                     = OMM_VERSION_MAJOR;
+            header.versionMinor                     = OMM_VERSION_MINOR;
+            header.versionBuild                     = OMM_VERSION_BUILD;
+            header.serializeVersion                 = Serialize::VERSION;
+            header.textureHash                      = texture->GetContentHash();
+            header.maxWorkloadSize                  = desc.maxWorkloadSize;
+            header.maxWorkingSetBytes               = desc.maxWorkingSetBytes;
+            header.bakeFlags                        = (uint32_t)desc.bakeFlags;
+            header.addressingMode                   = (uint32_t)desc.runtimeSamplerDesc.addressingMode;
+            header.filter                           = (uint32_t)desc.runtimeSamplerDesc.filter;
+            header.borderAlpha                      = desc.runtimeSamplerDesc.borderAlpha;
+            header.alphaMode                        = (uint32_t)desc.alphaMode;
+            header.dynamicSubdivisionScale          = desc.dynamicSubdivisionScale;
+            header.rejectionThreshold               = desc.rejectionThreshold;
+            header.alphaCutoff                      = desc.alphaCutoff;
+            header.nearDuplicateDeduplicationFactor = desc.nearDuplicateDeduplicationFactor;
+            header.alphaCutoffLessEqual             = (uint32_t)desc.alphaCutoffLessEqual;
+            header.alphaCutoffGreater               = (uint32_t)desc.alphaCutoffGreater;
+            header.format                           = (uint32_t)desc.format;
+            header.unknownStatePromotion            = (uint32_t)desc.unknownStatePromotion;
+            header.unresolvedTriState               = (uint32_t)desc.unresolvedTriState;
+            header.maxSubdivisionLevel              = desc.maxSubdivisionLevel;
+            header.maxArrayDataSize                 = desc.maxArrayDataSize;
+            header.triangleCount                    = desc.indexCount / 3;
+
+            // The key inputs are copied to 64-bit words, the type XXH64 reads its input as.
+            static_assert(sizeof(KeyHeader) % sizeof(uint64_t) == 0);
+            uint64_t headerWords[sizeof(KeyHeader) / sizeof(uint64_t)];
+            std::memcpy(headerWords, &header, sizeof(header));
+
+            uint64_t digest = XXH64((const void*)headerWords, sizeof(headerWords), 42/*seed*/);
+
+            struct KeyTriangle
+            {
+                float2 p0;
+                float2 p1;
+                float2 p2;
+                uint32_t format;
+                uint32_t subdivisionLevel;
+            };
+
+            static_assert(sizeof(KeyTriangle) % sizeof(uint64_t) == 0);
+            static constexpr uint32_t kChunkSize = 256;
+            static constexpr uint32_t kWordsPerTriangle = sizeof(KeyTriangle) / sizeof(uint64_t);
+            uint64_t chunk[kChunkSize * kWordsPerTriangle];
+            uint32_t chunkCount = 0;
+            for (uint32_t i = 0; i < header.triangleCount; ++i)
+            {
+                const Triangle uvTri = GetTriangle(desc, i);
+
+                KeyTriangle entry;
+                entry.p0 = uvTri.p0;
+                entry.p1 = uvTri.p1;
+                entry.p2 = uvTri.p2;
+                entry.format = (uint32_t)(!desc.formats || desc.formats[i] == ommFormat_INVALID ? desc.format : desc.formats[i]);
+                entry.subdivisionLevel = desc.subdivisionLevels ? desc.subdivisionLevels[i] : 0xFF;
+                std::memcpy(chunk + chunkCount * kWordsPerTriangle, &entry, sizeof(entry));
+
+                if (++chunkCount == kChunkSize || i + 1 == header.triangleCount)
+                {
+                    digest = XXH64((const void*)chunk, chunkCount * sizeof(KeyTriangle), digest);
+                    chunkCount = 0;
+                }
+            }
+
+            return digest;
+        }
     } // namespace impl
 
+    template<ommCpuTextureFormat eFormat, TilingMode eTilingMode, ommTextureAddressMode eTextureAddressMode, ommTextureFilterMode eFilterMode, bool bTexIsPow2>
+    ommResult BakeOutputImpl::ResampleImpl(const ommCpuBakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems)
+    {
+        return impl::Resample<eFormat, eTilingMode, eTextureAddressMode, eFilterMode, bTexIsPow2>(m_arena.GetStdAllocator(), m_scheduler, m_progress, desc, m_log, options, vmWorkItems);
+    }
+
     template<ommCpuTextureFormat eFormat, TilingMode eTilingMode, ommTextureAddressMode eTextureAddressMode, ommTextureFilterMode eFilterMode, bool bTexIsPow2>
     ommResult BakeOutputImpl::BakeImpl(const ommCpuBakeInputDesc& desc)
     {
@@ -1929,60 +3090,243 @@ namespace Cpu
 
         m_bakeInputDesc = desc;
 
-        auto impl__ResampleCoarse = [](const ommCpuBakeInputDesc& desc, const Logger& log, const Options& options, vector<OmmWorkItem>& vmWorkItems) {
-            return impl::ResampleCoarse<eFormat, eTilingMode, eTextureAddressMode, eFilterMode, bTexIsPow2>(desc, log, options, vmWorkItems);
-        };
+        if (desc.maxWorkingSetBytes != 0xFFFFFFFFFFFFFFFF)
+        {
+            // The arena only gives memory back at the end of the bake, streaming has to free each chunk to stay within its
+            // working set.
+            return impl::BakeStreaming<eFormat, eTilingMode, eTextureAddressMode, eFilterMode, bTexIsPow2>(m_stdAllocator, m_scheduler, m_progress, m_log, desc, options, m_bakeResult);
+        }
 
-        auto impl__ResampleFineNormal = [](const ommCpuBakeInputDesc& desc, const Logger& log, const Options& options, vector<OmmWorkItem>& vmWorkItems) {
-            return impl::ResampleFine<eFormat, eTilingMode, eTextureAddressMode, eFilterMode, impl::TriangleClass::Normal, bTexIsPow2>(desc, log, options, vmWorkItems);
-        };
+        {
+            const StdAllocator<uint8_t>& allocator = m_arena.GetStdAllocator();
 
-        auto impl__ResampleFineDegen = [](const ommCpuBakeInputDesc& desc, const Logger& log, const Options& options, vector<OmmWorkItem>& vmWorkItems) {
-            return impl::ResampleFine<eFormat, eTilingMode, eTextureAddressMode, eFilterMode, impl::TriangleClass::Degenerate, bTexIsPow2>(desc, log, options, vmWorkItems);
-        };
+            vector<OmmWorkItem> vmWorkItems(allocator.GetInterface());
 
-        {
-            vector<OmmWorkItem> vmWorkItems(m_stdAllocator.GetInterface());
+            RETURN_STATUS_IF_FAILED(impl::SetupWorkItems(allocator, m_log, desc, options, nullptr /*all primitives*/, 0, vmWorkItems));
 
-            RETURN_STATUS_IF_FAILED(impl::SetupWorkItems(m_stdAllocator, m_log, desc, options, vmWorkItems));
+            RETURN_STATUS_IF_FAILED(impl::ValidateWorkloadSize(allocator, m_log, desc, options, vmWorkItems));
 
-            RETURN_STATUS_IF_FAILED(impl::ValidateWorkloadSize(m_stdAllocator, m_log, desc, options, vmWorkItems));
+            RETURN_STATUS_IF_FAILED((ResampleImpl<eFormat, eTilingMode, eTextureAddressMode, eFilterMode, bTexIsPow2>(desc, options, vmWorkItems)));
 
-            RETURN_STATUS_IF_FAILED(impl__ResampleCoarse(desc, m_log, options, vmWorkItems));
+            m_progress.BeginStage(ommCpuBakeStage_Deduplicate);
+            RETURN_STATUS_IF_FAILED(impl::PromoteToSpecialIndices(desc, options, vmWorkItems));
 
-            RETURN_STATUS_IF_FAILED(impl__ResampleFineNormal(desc, m_log, options, vmWorkItems));
+            RETURN_STATUS_IF_FAILED(impl::DeduplicateExact(allocator, m_scheduler, m_log, options, vmWorkItems));
 
-            RETURN_STATUS_IF_FAILED(impl__ResampleFineDegen(desc, m_log, options, vmWorkItems));
+            // Only near duplicate merging and compression change states after this point. Without them the repeated
+            // deduplication and promotion passes below can't change the result.
+            const bool statesMayChange = options.enableNearDuplicateDetection || desc.maxArrayDataSize != 0xFFFFFFFF;
 
-            RETURN_STATUS_IF_FAILED(impl::PromoteToSpecialIndices(desc, options, vmWorkItems));
+            if (statesMayChange)
+            {
+                RETURN_STATUS_IF_FAILED(impl::DeduplicateSimilarLSH(allocator, m_scheduler, desc, options, vmWorkItems, 3 /*iterations*/));
 
-            RETURN_STATUS_IF_FAILED(impl::DeduplicateExact(m_stdAllocator, options, vmWorkItems));
+                RETURN_STATUS_IF_FAILED(impl::DeduplicateSimilarVPTree(allocator, m_scheduler, desc, options, vmWorkItems));
 
-            RETURN_STATUS_IF_FAILED(impl::DeduplicateSimilarLSH(m_stdAllocator, desc, options, vmWorkItems, 3 /*iterations*/));
+                RETURN_STATUS_IF_FAILED(impl::PromoteToSpecialIndices(desc, options, vmWorkItems));
+            }
 
-            RETURN_STATUS_IF_FAILED(impl::DeduplicateSimilarBruteForce(m_stdAllocator, options, vmWorkItems));
+            RETURN_STATUS_IF_FAILED(m_progress.CheckCancelled());
 
-            RETURN_STATUS_IF_FAILED(impl::PromoteToSpecialIndices(desc, options, vmWorkItems));
+            m_progress.BeginStage(ommCpuBakeStage_Compress);
+            if (statesMayChange)
+            {
+                RETURN_STATUS_IF_FAILED(impl::Compress(allocator, desc, options, vmWorkItems));
 
-            RETURN_STATUS_IF_FAILED(impl::Compress(m_stdAllocator, desc, options, vmWorkItems));
+                RETURN_STATUS_IF_FAILED(impl::DeduplicateExact(allocator, m_scheduler, m_log, options, vmWorkItems));
 
-            RETURN_STATUS_IF_FAILED(impl::DeduplicateExact(m_stdAllocator, options, vmWorkItems));
+                RETURN_STATUS_IF_FAILED(impl::PromoteToSpecialIndices(desc, options, vmWorkItems));
+            }
 
-            RETURN_STATUS_IF_FAILED(impl::PromoteToSpecialIndices(desc, options, vmWorkItems));
+            RETURN_STATUS_IF_FAILED(m_progress.CheckCancelled());
 
+            m_progress.BeginStage(ommCpuBakeStage_Serialize);
             VisibilityMapUsageHistogram arrayHistogram;
             VisibilityMapUsageHistogram indexHistogram;
             RETURN_STATUS_IF_FAILED(impl::CreateUsageHistograms(vmWorkItems, arrayHistogram, indexHistogram));
 
-            vector<std::pair<uint64_t, uint32_t>> sortKeys(m_stdAllocator.GetInterface());
-            RETURN_STATUS_IF_FAILED(impl::MicromapSpatialSort(m_stdAllocator, options, vmWorkItems, sortKeys));
+            vector<std::pair<uint64_t, uint32_t>> sortKeys(allocator.GetInterface());
+            RETURN_STATUS_IF_FAILED(impl::MicromapSpatialSort(allocator, m_scheduler, options, vmWorkItems, sortKeys));
 
-            RETURN_STATUS_IF_FAILED(impl::Serialize(m_stdAllocator, desc, options, vmWorkItems, arrayHistogram, indexHistogram,
+            RETURN_STATUS_IF_FAILED(impl::Serialize(allocator, desc, options, vmWorkItems, arrayHistogram, indexHistogram,
                 sortKeys, m_bakeResult));
         }
 
         return ommResult_SUCCESS;
     }
 
+    ommResult BakeOutputImpl::BakeBatchImpl(const ommCpuBakeInputDesc* descs, uint32_t descCount)
+    {
+        RETURN_STATUS_IF_FAILED(ValidateBatchDesc(descs, descCount));
+
+        const Options options(descs[0].bakeFlags);
+
+        m_bakeInputDesc = descs[0];
+
+        // Inputs that sample the same texture with the same settings resample identical UV-triangles only once.
+        auto CanShareWorkItems = [](const ommCpuBakeInputDesc& a, const ommCpuBakeInputDesc& b) {
+            return a.texture == b.texture &&
+                a.runtimeSamplerDesc.addressingMode == b.runtimeSamplerDesc.addressingMode &&
+                a.runtimeSamplerDesc.filter == b.runtimeSamplerDesc.filter &&
+                a.runtimeSamplerDesc.borderAlpha == b.runtimeSamplerDesc.borderAlpha &&
+                a.alphaCutoff == b.alphaCutoff &&
+                a.alphaCutoffLessEqual == b.alphaCutoffLessEqual &&
+                a.alphaCutoffGreater == b.alphaCutoffGreater &&
+                a.format == b.format &&
+                a.unknownStatePromotion == b.unknownStatePromotion &&
+                a.maxWorkloadSize == b.maxWorkloadSize;
+        };
+
+        const StdAllocator<uint8_t>& allocator = m_arena.GetStdAllocator();
+
+        vector<uint32_t> primitiveOffsets(descCount + 1, 0, allocator);
+        for (uint32_t descIt = 0; descIt < descCount; ++descIt)
+            primitiveOffsets[descIt + 1] = primitiveOffsets[descIt] + descs[descIt].indexCount / 3;
+
+        vector<OmmWorkItem> vmWorkItems(allocator.GetInterface());
+        {
+            vector<bool> processed(descCount, false, allocator);
+            for (uint32_t groupIt = 0; groupIt < descCount; ++groupIt)
+            {
+                if (processed[groupIt])
+                    continue;
+
+                const ommCpuBakeInputDesc& groupDesc = descs[groupIt];
+
+                vector<OmmWorkItem> groupWorkItems(allocator.GetInterface());
+                hash_map<size_t, uint32_t> triangleIDToWorkItem(allocator.GetInterface());
+
+                m_progress.BeginStage(ommCpuBakeStage_Setup);
+                for (uint32_t descIt = groupIt; descIt < descCount; ++descIt)
+                {
+                    if (processed[descIt] || !CanShareWorkItems(groupDesc, descs[descIt]))
+                        continue;
+
+                    RETURN_STATUS_IF_FAILED(impl::SetupWorkItems(allocator, m_log, descs[descIt], options, nullptr /*all primitives*/, 0,
+                        primitiveOffsets[descIt], triangleIDToWorkItem, groupWorkItems));
+                    processed[descIt] = true;
+                }
+
+                RETURN_STATUS_IF_FAILED(impl::ValidateWorkloadSize(allocator, m_log, groupDesc, options, groupWorkItems));
+
+                const BakeDispatch* dispatch = FindDispatch(groupDesc);
+                if (dispatch == nullptr)
+                    return ommResult_FAILURE;
+
+                RETURN_STATUS_IF_FAILED((this->*dispatch->resample)(groupDesc, options, groupWorkItems));
+
+                for (OmmWorkItem& workItem : groupWorkItems)
+                    vmWorkItems.push_back(std::move(workItem));
+            }
+        }
+
+        m_progress.BeginStage(ommCpuBakeStage_Deduplicate);
+
+        RETURN_STATUS_IF_FAILED(impl::PromoteToSpecialIndices(descs[0], options, vmWorkItems));
+
+        RETURN_STATUS_IF_FAILED(impl::DeduplicateExact(allocator, m_scheduler, m_log, options, vmWorkItems));
+
+        RETURN_STATUS_IF_FAILED(impl::DeduplicateSimilarLSH(allocator, m_scheduler, descs[0], options, vmWorkItems, 3 /*iterations*/));
+
+        RETURN_STATUS_IF_FAILED(impl::DeduplicateSimilarVPTree(allocator, m_scheduler, descs[0], options, vmWorkItems));
+
+        RETURN_STATUS_IF_FAILED(impl::PromoteToSpecialIndices(descs[0], options, vmWorkItems));
+
+        RETURN_STATUS_IF_FAILED(m_progress.CheckCancelled());
+
+        m_progress.BeginStage(ommCpuBakeStage_Serialize);
+
+        VisibilityMapUsageHistogram arrayHistogram;
+        VisibilityMapUsageHistogram indexHistogram;
+        RETURN_STATUS_IF_FAILED(impl::CreateUsageHistograms(vmWorkItems, arrayHistogram, indexHistogram));
+
+        vector<std::pair<uint64_t, uint32_t>> sortKeys(allocator.GetInterface());
+        RETURN_STATUS_IF_FAILED(impl::MicromapSpatialSort(allocator, m_scheduler, options, vmWorkItems, sortKeys));
+
+        RETURN_STATUS_IF_FAILED(impl::SerializeArrayData(vmWorkItems, arrayHistogram, sortKeys, m_bakeResult));
+
+        impl::AllocateUsageHistograms(arrayHistogram, VisibilityMapUsageHistogram(), m_bakeResult);
+
+        RETURN_STATUS_IF_FAILED(impl::SerializeBatchIndexBuffers(m_stdAllocator, descs, descCount, primitiveOffsets, vmWorkItems, m_bakeResult, m_batchResults));
+
+        m_batchResultDescs.reserve(descCount);
+        for (const BakeResultImpl& res : m_batchResults)
+            m_batchResultDescs.push_back(res.bakeOutputDesc);
+
+        return ommResult_SUCCESS;
+    }
+
+    ommResult BakeOutputImpl::BakeCached(const ommCpuBakeInputDesc& desc)
+    {
+        // The key is only meaningful for valid inputs.
+        RETURN_STATUS_IF_FAILED(ValidateDesc(desc));
+
+        const uint64_t key = impl::ComputeCacheKey(desc);
+
+        vector<uint8_t> blob(m_stdAllocator);
+        if (m_cache.Load(key, blob))
+        {
+            if (LoadCachedResult(desc, blob) == ommResult_SUCCESS)
+                return ommResult_SUCCESS;
+            m_log.PerfWarnf("Bake cache entry %016llx is stale or corrupt, baking again", (unsigned long long)key);
+        }
+
+        RETURN_STATUS_IF_FAILED(InvokeDispatch(desc));
+
+        m_cache.Store(key, m_bakeResult.bakeOutputDesc);
+        return ommResult_SUCCESS;
+    }
+
+    ommResult BakeOutputImpl::LoadCachedResult(const ommCpuBakeInputDesc& desc, const vector<uint8_t>& blob)
+    {
+        if (blob.size() < (size_t)HeaderSize[Serialize::VERSION - 1])
+            return ommResult_FAILURE;
+
+        ommCpuBlobDesc blobDesc = ommCpuBlobDescDefault();
+        blobDesc.data = (void*)blob.data();
+        blobDesc.size = blob.size();
+
+        DeserializedResultImpl deserialized(m_stdAllocator, m_log, m_scheduler);
+        RETURN_STATUS_IF_FAILED(deserialized.Deserialize(blobDesc));
+
+        const ommCpuDeserializedDesc* deserializedDesc = deserialized.GetDesc();
+        if (deserializedDesc->numResultDescs != 1)
+            return ommResult_FAILURE;
+
+        const ommCpuBakeResultDesc& cached = deserializedDesc->resultDescs[0];
+        const uint32_t triangleCount = desc.indexCount / 3;
+        if (cached.indexCount != triangleCount)
+            return ommResult_FAILURE;
+
+        const size_t indexSize = cached.indexFormat == ommIndexFormat_UINT_8 ? sizeof(uint8_t) : cached.indexFormat == ommIndexFormat_UINT_16 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+        m_bakeInputDesc = desc;
+
+        m_bakeResult.ommArrayData.assign((const uint8_t*)cached.arrayData, (const uint8_t*)cached.arrayData + cached.arrayDataSize);
+        m_bakeResult.ommDescArray.assign(cached.descArray, cached.descArray + cached.descArrayCount);
+        m_bakeResult.ommArrayHistogram.assign(cached.descArrayHistogram, cached.descArrayHistogram + cached.descArrayHistogramCount);
+        m_bakeResult.ommIndexHistogram.assign(cached.indexHistogram, cached.indexHistogram + cached.indexHistogramCount);
+        m_bakeResult.ommIndexBuffer.resize(triangleCount);
+        if (triangleCount != 0)
+            std::memcpy(m_bakeResult.ommIndexBuffer.data(), cached.indexBuffer, indexSize * triangleCount);
+
+        // The triangle areas are not part of the serialized result, recompute them for the baked (non-special) primitives
+        // the same way SetupWorkItems filters them.
+        const Options options(desc.bakeFlags);
+        const TextureImpl* texture = GetHandleImpl<TextureImpl>(desc.texture);
+        m_bakeResult.ommTriangleArea.assign(triangleCount, 0.f);
+        for (uint32_t i = 0; i < triangleCount; ++i)
+        {
+            const Triangle uvTri = impl::GetTriangle(desc, i);
+            if (GetSubdivisionLevelForPrimitive(desc, options, i, uvTri, texture->GetSize(0)) == impl::kDisabledPrimitive || GetIsInvalid(options, uvTri))
+                continue;
+            m_bakeResult.ommTriangleArea[i] = GetArea2D(uvTri);
+        }
+
+        m_bakeResult.Finalize(cached.indexFormat);
+
+        return ommResult_SUCCESS;
+    }
+
 } // namespace Cpu
 } // namespace omm
@@ -14,12 +14,18 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 #include "omm_handle.h"
 #include "defines.h"
 #include "std_containers.h"
+#include "arena_allocator.h"
 #include "texture_impl.h"
+#include "bake_cache_impl.h"
 #include "log.h"
 
 #include "util/math.h"
 #include "util/texture.h"
+#include "util/parallel.h"
 
+#include <array>
+#include <atomic>
+#include <utility>
 #include <map>
 #include <set>
 
@@ -29,6 +35,9 @@ namespace omm
 {
 namespace Cpu
 {
+    struct Options;
+    struct OmmWorkItem;
+
     class BakerImpl
     {
     // Internal
@@ -37,7 +46,9 @@ namespace Cpu
         static inline constexpr HandleType kHandleType = HandleType::CpuBaker;
         
         inline BakerImpl(const StdAllocator<uint8_t>& stdAllocator) :
-            m_stdAllocator(stdAllocator)
+            m_stdAllocator(stdAllocator),
+            m_scheduler(stdAllocator),
+            m_cache(stdAllocator)
         {}
 
         ~BakerImpl();
@@ -48,14 +59,21 @@ namespace Cpu
         inline const Logger& GetLog() const
         { return m_log; }
 
+        inline const parallel::Scheduler& GetScheduler() const
+        { return m_scheduler; }
+
         ommResult Create(const ommBakerCreationDesc& bakeCreationDesc);
         ommResult BakeOpacityMicromap(const ommCpuBakeInputDesc& bakeInputDesc, ommCpuBakeResult* bakeOutput);
+        ommResult BakeOpacityMicromapAsync(const ommCpuBakeInputDesc& bakeInputDesc, ommCpuBakeResult* bakeOutput);
+        ommResult BakeOpacityMicromapBatch(const ommCpuBakeInputDesc* bakeInputDescs, uint32_t bakeInputDescCount, ommCpuBakeResult* bakeOutput);
 
     private:
         ommResult Validate(const ommCpuBakeInputDesc& desc);
     private:
         StdAllocator<uint8_t> m_stdAllocator;
         Logger m_log;
+        parallel::Scheduler m_scheduler;
+        BakeCacheImpl m_cache;
     };
 
     struct BakeResultImpl
@@ -92,12 +110,94 @@ namespace Cpu
             bakeOutputDesc.indexHistogram            = ommIndexHistogram.data();
             bakeOutputDesc.indexHistogramCount       = (uint32_t)ommIndexHistogram.size();
         }
+
+        // Points the OMM array outputs at the arrays of another result. Used by batch bakes, where all inputs share one OMM array.
+        void ShareArrayData(const BakeResultImpl& other)
+        {
+            bakeOutputDesc.arrayData                 = other.ommArrayData.data();
+            bakeOutputDesc.arrayDataSize             = (uint32_t)other.ommArrayData.size();
+            bakeOutputDesc.descArray                 = other.ommDescArray.data();
+            bakeOutputDesc.descArrayCount            = (uint32_t)other.ommDescArray.size();
+            bakeOutputDesc.descArrayHistogram        = other.ommArrayHistogram.data();
+            bakeOutputDesc.descArrayHistogramCount   = (uint32_t)other.ommArrayHistogram.size();
+        }
+    };
+
+    // Stage progress, work counters and cancellation flag of a bake, written by the baking threads and read by ommCpuPollBake
+    // and ommDebugGetStats2.
+    class BakeProgressImpl
+    {
+    public:
+        void BeginStage(ommCpuBakeStage stage)
+        {
+            m_stageWorkDone = 0;
+            m_stageWorkTotal = 0;
+            m_stage = stage;
+        }
+
+        void AddStageWork(uint64_t work)
+        {
+            m_stageWorkTotal.fetch_add(work, std::memory_order_relaxed);
+        }
+
+        void CompleteStageWork(uint64_t work)
+        {
+            m_stageWorkDone.fetch_add(work, std::memory_order_relaxed);
+        }
+
+        void Cancel()
+        {
+            m_cancelled = true;
+        }
+
+        bool IsCancelled() const
+        {
+            return m_cancelled.load(std::memory_order_relaxed);
+        }
+
+        ommResult CheckCancelled() const
+        {
+            return IsCancelled() ? ommResult_CANCELLED : ommResult_SUCCESS;
+        }
+
+        ommCpuBakeProgress Get() const
+        {
+            ommCpuBakeProgress progress = ommCpuBakeProgressDefault();
+            progress.stage = m_stage;
+            const uint64_t workTotal = m_stageWorkTotal.load(std::memory_order_relaxed);
+            const uint64_t workDone = m_stageWorkDone.load(std::memory_order_relaxed);
+            if (progress.stage == ommCpuBakeStage_Done)
+                progress.stageProgress = 1.f;
+            else if (workTotal != 0)
+                progress.stageProgress = std::min(1.f, float(double(workDone) / double(workTotal)));
+            return progress;
+        }
+
+        void AddTriangleCacheLookups(uint32_t hitCount, uint32_t lookupCount)
+        {
+            m_triangleCacheHits.fetch_add(hitCount, std::memory_order_relaxed);
+            m_triangleCacheLookups.fetch_add(lookupCount, std::memory_order_relaxed);
+        }
+
+        void GetCounters(ommDebugStats& stats) const
+        {
+            stats.triangleCacheHits = m_triangleCacheHits.load(std::memory_order_relaxed);
+            stats.triangleCacheLookups = m_triangleCacheLookups.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<ommCpuBakeStage> m_stage = ommCpuBakeStage_Setup;
+        std::atomic<uint64_t> m_stageWorkDone = 0;
+        std::atomic<uint64_t> m_stageWorkTotal = 0;
+        std::atomic<bool> m_cancelled = false;
+        std::atomic<uint32_t> m_triangleCacheHits = 0;
+        std::atomic<uint32_t> m_triangleCacheLookups = 0;
     };
 
     class BakeOutputImpl
     {
     public:
-        BakeOutputImpl(const StdAllocator<uint8_t>& stdAllocator, const Logger& log);
+        BakeOutputImpl(const StdAllocator<uint8_t>& stdAllocator, const Logger& log, const parallel::Scheduler& scheduler, const BakeCacheImpl& cache);
         ~BakeOutputImpl();
 
         inline const StdAllocator<uint8_t>& GetStdAllocator() const
@@ -115,33 +215,118 @@ namespace Cpu
             if (desc == nullptr)
                 return m_log.InvalidArg("[Invalid Arg] - No BakeResultDesc provided");
 
-            *desc = &m_bakeResult.bakeOutputDesc;
+            const ommResult status = m_status;
+            if (status != ommResult_SUCCESS)
+                return status;
+
+            *desc = m_batchResults.empty() ? &m_bakeResult.bakeOutputDesc : &m_batchResultDescs[0];
+            return ommResult_SUCCESS;
+        }
+
+        inline ommResult GetBakeBatchResultDesc(const ommCpuBakeResultDesc** descs, uint32_t* descCount)
+        {
+            if (descs == nullptr || descCount == nullptr)
+                return m_log.InvalidArg("[Invalid Arg] - No BakeResultDesc provided");
+
+            const ommResult status = m_status;
+            if (status != ommResult_SUCCESS)
+                return status;
+
+            if (m_batchResults.empty())
+            {
+                *descs = &m_bakeResult.bakeOutputDesc;
+                *descCount = 1;
+            }
+            else
+            {
+                *descs = m_batchResultDescs.data();
+                *descCount = (uint32_t)m_batchResultDescs.size();
+            }
             return ommResult_SUCCESS;
         }
 
         inline ommResult GetBakeResultAreaData(const float*& area) const
         {
-            area = m_bakeResult.ommTriangleArea.data();
+            area = m_batchResults.empty() ? m_bakeResult.ommTriangleArea.data() : m_batchResults[0].ommTriangleArea.data();
             return ommResult_SUCCESS;
         }
 
         ommResult Bake(const ommCpuBakeInputDesc& desc);
+        ommResult BakeAsync(const ommCpuBakeInputDesc& desc);
+        ommResult BakeBatch(const ommCpuBakeInputDesc* descs, uint32_t descCount);
+
+        inline ommResult Poll(ommCpuBakeProgress* outProgress) const
+        {
+            if (outProgress != nullptr)
+                *outProgress = m_progress.Get();
+            return m_status;
+        }
+
+        inline void GetCounters(ommDebugStats& stats) const
+        {
+            m_progress.GetCounters(stats);
+        }
+
+        inline void Cancel()
+        {
+            m_progress.Cancel();
+        }
+
+        // Blocks until a bake started by BakeAsync has finished.
+        inline void Wait()
+        {
+            m_asyncTask.Wait();
+        }
 
     private:
         ommResult ValidateDesc(const ommCpuBakeInputDesc& desc) const;
+        ommResult ValidateBatchDesc(const ommCpuBakeInputDesc* descs, uint32_t descCount) const;
+
+        // Entry point of the task started by BakeAsync, bakes m_bakeInputDesc.
+        static void RunAsync(void* arg);
 
         template<ommCpuTextureFormat format, TilingMode eTextureFormat, ommTextureAddressMode eTextureAddressMode, ommTextureFilterMode eFilterMode, bool bTexIsPow2>
         ommResult BakeImpl(const ommCpuBakeInputDesc& desc);
 
-        template<class... TArgs>
-        void RegisterDispatch(TArgs... args, std::function < ommResult(const ommCpuBakeInputDesc& desc)> fn);
-        map<std::tuple<ommCpuTextureFormat, TilingMode, ommTextureAddressMode, ommTextureFilterMode, bool /*texIsPow2*/>, std::function<ommResult(const ommCpuBakeInputDesc& desc)>> bakeDispatchTable;
+        template<ommCpuTextureFormat format, TilingMode eTextureFormat, ommTextureAddressMode eTextureAddressMode, ommTextureFilterMode eFilterMode, bool bTexIsPow2>
+        ommResult ResampleImpl(const ommCpuBakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems);
+
+        ommResult BakeBatchImpl(const ommCpuBakeInputDesc* descs, uint32_t descCount);
+
+        // Returns the cached result of an identical earlier bake when present, otherwise bakes and stores the result.
+        ommResult BakeCached(const ommCpuBakeInputDesc& desc);
+        ommResult LoadCachedResult(const ommCpuBakeInputDesc& desc, const vector<uint8_t>& blob);
+
+        struct BakeDispatch
+        {
+            ommResult (BakeOutputImpl::*bake)(const ommCpuBakeInputDesc& desc);
+            ommResult (BakeOutputImpl::*resample)(const ommCpuBakeInputDesc& desc, const Options& options, vector<OmmWorkItem>& vmWorkItems);
+        };
+
+        // The dispatch table is built at compile time and indexed by texture format, tiling mode, address mode, filter mode and
+        // whether the texture size is a power of two. Combinations the textures never use are left null.
+        static constexpr size_t kDispatchCount = size_t(ommCpuTextureFormat_MAX_NUM) * size_t(TilingMode::MAX_NUM) * size_t(ommTextureAddressMode_MAX_NUM) * size_t(ommTextureFilterMode_MAX_NUM) * 2;
+        static constexpr size_t GetDispatchIndex(ommCpuTextureFormat format, TilingMode tilingMode, ommTextureAddressMode addressMode, ommTextureFilterMode filterMode, bool texIsPow2);
+        template<size_t kIndex>
+        static constexpr BakeDispatch MakeDispatch();
+        const BakeDispatch* FindDispatch(const ommCpuBakeInputDesc& desc) const;
         ommResult InvokeDispatch(const ommCpuBakeInputDesc& desc);
     private:
         StdAllocator<uint8_t> m_stdAllocator;
-        const Logger& m_log;
+        // Transient allocations of a bake come from the arena, it's reset once the result has been serialized.
+        ArenaAllocator m_arena;
+        // Copies rather than references to the baker, an async bake may still be running when the baker is destroyed.
+        const Logger m_log;
+        const parallel::Scheduler m_scheduler;
+        const BakeCacheImpl m_cache;
         ommCpuBakeInputDesc m_bakeInputDesc;
         BakeResultImpl m_bakeResult;
+        // Per input results of a batch bake, these share the OMM array of m_bakeResult.
+        vector<BakeResultImpl> m_batchResults;
+        vector<ommCpuBakeResultDesc> m_batchResultDescs;
+        BakeProgressImpl m_progress;
+        std::atomic<ommResult> m_status = ommResult_NOT_READY;
+        parallel::AsyncTask m_asyncTask;
     };
 } // namespace Cpu
 } // namespace omm
@@ -73,6 +73,7 @@ struct LevelLineIntersectionKernel
         float                   alphaCutoff;
         float                   borderAlpha;
         uint32_t                mipLevel;
+        bool                    earlyExit;      //< Stop once both counts are non-zero, valid when the state doesn't depend on the counts.
     };
 
 private:
@@ -238,8 +239,9 @@ private:
     }
 public:
 
+    // Returns false once the coverage is mixed and earlyExit is set, the rasterizer then stops.
     template<ommCpuTextureFormat eFormat, ommTextureAddressMode eTextureAddressMode, TilingMode eTilingMode, bool bIsDegenerate, bool bTexIsPow2>
-    static void run(int2 pixel, void* ctx)
+    static bool run(int2 pixel, void* ctx)
     {
         Params* p = (Params*)ctx;
 
@@ -326,7 +328,7 @@ public:
             // We've already concluded it's unknown -> return!
             if (IsOpaque && IsTransparent)
             {
-                return;
+                return !p->earlyExit;
             }
         }
 
@@ -396,6 +398,8 @@ public:
                 
             }
         }
+
+        return !(p->earlyExit && p->vmCoverage->numAboveAlpha != 0 && p->vmCoverage->numBelowAlpha != 0);
     }
 };
 
@@ -412,6 +416,7 @@ struct ConservativeBilinearKernel
         float                   alphaCutoff;
         float                   borderAlpha;
         uint32_t                mipLevel;
+        bool                    earlyExit;      //< Stop once both counts are non-zero, valid when the state doesn't depend on the counts.
     };
 
     template<ommCpuTextureFormat eFormat, ommTextureAddressMode eTextureAddressMode, TilingMode eTilingMode, bool bTexIsPow2>
@@ -449,6 +454,122 @@ struct ConservativeBilinearKernel
             p->vmCoverage->numBelowAlpha += 1;
         }
     }
+
+    // Same as run for the pixels [pixel, pixel + (count, 0)). Returns false once the coverage is mixed and earlyExit is set.
+    template<ommCpuTextureFormat eFormat, ommTextureAddressMode eTextureAddressMode, TilingMode eTilingMode, bool bTexIsPow2>
+    static bool runSpan(int2 pixel, int count, void* ctx)
+    {
+        Params* p = (Params*)ctx;
+        OmmCoverage* coverage = p->vmCoverage;
+
+        // Pixels whose 2x2 texel footprint is inside the mip need no address mode handling, for those the footprints of
+        // a whole segment are classified from the above / below masks of two texel rows.
+        const int end = pixel.x + count;
+        const bool rowInside = pixel.y >= 0 && pixel.y + 1 < p->size.y;
+        const int insideBegin = rowInside ? std::min(std::max(pixel.x, 0), end) : end;
+        const int insideEnd = rowInside ? std::max(std::min(end, p->size.x - 1), insideBegin) : end;
+
+        int x = pixel.x;
+        for (; x < insideBegin; ++x)
+            run<eFormat, eTextureAddressMode, eTilingMode, bTexIsPow2>(int2(x, pixel.y), ctx);
+
+        static constexpr int kMaxSegment = 63;
+        for (; x < insideEnd; x += kMaxSegment)
+        {
+            const uint32_t segment = (uint32_t)std::min(kMaxSegment, insideEnd - x);
+            uint64_t above0, below0, above1, below1;
+            p->texture->CompareSpan<eFormat, eTilingMode>(int2(x, pixel.y), segment + 1, p->mipLevel, p->alphaCutoff, above0, below0);
+            p->texture->CompareSpan<eFormat, eTilingMode>(int2(x, pixel.y + 1), segment + 1, p->mipLevel, p->alphaCutoff, above1, below1);
+
+            const uint64_t above = above0 | above1;
+            const uint64_t below = below0 | below1;
+            const uint64_t segmentMask = (1ull << segment) - 1ull;
+            coverage->numAboveAlpha += (uint32_t)std::popcount((above | (above >> 1)) & segmentMask);
+            coverage->numBelowAlpha += (uint32_t)std::popcount((below | (below >> 1)) & segmentMask);
+
+            if (p->earlyExit && coverage->numAboveAlpha != 0 && coverage->numBelowAlpha != 0)
+                return false;
+        }
+        x = insideEnd;
+
+        for (; x < end; ++x)
+            run<eFormat, eTextureAddressMode, eTilingMode, bTexIsPow2>(int2(x, pixel.y), ctx);
+
+        return !(p->earlyExit && coverage->numAboveAlpha != 0 && coverage->numBelowAlpha != 0);
+    }
+};
+
+// ~~~~~~ NearestKernel ~~~~~~ 
+// 
+struct NearestKernel
+{
+    struct Params {
+        OmmCoverage*            vmCoverage;
+        int2                    size;
+        int2                    sizeLog2;
+        const TextureImpl*      texture;
+        float                   alphaCutoff;
+        float                   borderAlpha;
+        uint32_t                mipLevel;
+        bool                    earlyExit;      //< Stop once both counts are non-zero, valid when the state doesn't depend on the counts.
+    };
+
+    template<ommCpuTextureFormat eFormat, ommTextureAddressMode eTextureAddressMode, TilingMode eTilingMode, bool bTexIsPow2>
+    static void run(int2 pixel, void* ctx)
+    {
+        Params* p = (Params*)ctx;
+
+        const int2 coord = omm::GetTexCoord<eTextureAddressMode, bTexIsPow2>(pixel, p->size, p->sizeLog2);
+
+        const bool isBorder = eTextureAddressMode == ommTextureAddressMode_Border && (coord.x == kTexCoordBorder || coord.y == kTexCoordBorder);
+        const float alpha = isBorder ? p->borderAlpha : p->texture->template Load<eFormat, eTilingMode>(coord, p->mipLevel);
+
+        if (p->alphaCutoff < alpha) {
+            p->vmCoverage->numAboveAlpha++;
+        }
+        else {
+            p->vmCoverage->numBelowAlpha++;
+        }
+    }
+
+    // Same as run for the pixels [pixel, pixel + (count, 0)). Returns false once the coverage is mixed and earlyExit is set.
+    template<ommCpuTextureFormat eFormat, ommTextureAddressMode eTextureAddressMode, TilingMode eTilingMode, bool bTexIsPow2>
+    static bool runSpan(int2 pixel, int count, void* ctx)
+    {
+        Params* p = (Params*)ctx;
+        OmmCoverage* coverage = p->vmCoverage;
+
+        // Pixels inside the mip map to themselves in all address modes and are compared a row segment at a time.
+        const int end = pixel.x + count;
+        const bool rowInside = pixel.y >= 0 && pixel.y < p->size.y;
+        const int insideBegin = rowInside ? std::min(std::max(pixel.x, 0), end) : end;
+        const int insideEnd = rowInside ? std::max(std::min(end, p->size.x), insideBegin) : end;
+
+        int x = pixel.x;
+        for (; x < insideBegin; ++x)
+            run<eFormat, eTextureAddressMode, eTilingMode, bTexIsPow2>(int2(x, pixel.y), ctx);
+
+        static constexpr int kMaxSegment = 64;
+        for (; x < insideEnd; x += kMaxSegment)
+        {
+            const uint32_t segment = (uint32_t)std::min(kMaxSegment, insideEnd - x);
+            uint64_t above, below;
+            p->texture->CompareSpan<eFormat, eTilingMode>(int2(x, pixel.y), segment, p->mipLevel, p->alphaCutoff, above, below);
+
+            const uint32_t numAbove = (uint32_t)std::popcount(above);
+            coverage->numAboveAlpha += numAbove;
+            coverage->numBelowAlpha += segment - numAbove;
+
+            if (p->earlyExit && coverage->numAboveAlpha != 0 && coverage->numBelowAlpha != 0)
+                return false;
+        }
+        x = insideEnd;
+
+        for (; x < end; ++x)
+            run<eFormat, eTextureAddressMode, eTilingMode, bTexIsPow2>(int2(x, pixel.y), ctx);
+
+        return !(p->earlyExit && coverage->numAboveAlpha != 0 && coverage->numBelowAlpha != 0);
+    }
 };
 
 } // namespace omm
\ No newline at end of file
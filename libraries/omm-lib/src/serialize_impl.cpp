@@ -83,7 +83,7 @@ namespace Cpu
     {
         std::ostream os(&buffer);
 
-        static_assert(sizeof(ommCpuBakeInputDesc) == 136);
+        static_assert(sizeof(ommCpuBakeInputDesc) == 144);
 
         os.write(reinterpret_cast<const char*>(&inputDesc.bakeFlags), sizeof(inputDesc.bakeFlags));
 
@@ -152,6 +152,7 @@ namespace Cpu
         }
 
         os.write(reinterpret_cast<const char*>(&inputDesc.maxWorkloadSize), sizeof(inputDesc.maxWorkloadSize));
+        os.write(reinterpret_cast<const char*>(&inputDesc.maxWorkingSetBytes), sizeof(inputDesc.maxWorkingSetBytes));
 
         return ommResult_SUCCESS;
     }
@@ -275,9 +276,10 @@ namespace Cpu
         return ommResult_SUCCESS;
     }
 
-    DeserializedResultImpl::DeserializedResultImpl(const StdAllocator<uint8_t>& stdAllocator, const Logger& log)
+    DeserializedResultImpl::DeserializedResultImpl(const StdAllocator<uint8_t>& stdAllocator, const Logger& log, const parallel::Scheduler& scheduler)
         : m_stdAllocator(stdAllocator)
         , m_log(log)
+        , m_scheduler(scheduler)
         , m_inputDesc(ommCpuDeserializedDescDefault())
         , m_deserializedData(m_stdAllocator)
     {
@@ -382,12 +384,12 @@ namespace Cpu
     {
         std::istream os(&buffer);
 
-        static_assert(sizeof(ommCpuBakeInputDesc) == 136);
+        static_assert(sizeof(ommCpuBakeInputDesc) == 144);
 
         os.read(reinterpret_cast<char*>(&inputDesc.bakeFlags), sizeof(inputDesc.bakeFlags));
 
         TextureImpl* texture = Allocate<TextureImpl>(m_stdAllocator, m_stdAllocator, m_log);
-        texture->Deserialize(buffer, header.inputDescVersion);
+        texture->Deserialize(buffer, header.inputDescVersion, m_scheduler);
 
         inputDesc.texture = CreateHandle<omm::Cpu::Texture, TextureImpl>(texture);
 
@@ -469,6 +471,10 @@ namespace Cpu
         }
 
         os.read(reinterpret_cast<char*>(&inputDesc.maxWorkloadSize), sizeof(inputDesc.maxWorkloadSize));
+        if (header.inputDescVersion >= 6)
+        {
+            os.read(reinterpret_cast<char*>(&inputDesc.maxWorkingSetBytes), sizeof(inputDesc.maxWorkingSetBytes));
+        }
 
         if (texture->HasSAT() && header.inputDescVersion < 3)
         {
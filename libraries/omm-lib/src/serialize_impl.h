@@ -52,7 +52,7 @@ namespace Cpu
     };
 
     enum Serialize {
-        VERSION = 5
+        VERSION = 6
     };
 
     static inline constexpr int HeaderSizeV1 = sizeof(XXH64_hash_t) + 5 * sizeof(int);
@@ -60,8 +60,9 @@ namespace Cpu
     static inline constexpr int HeaderSizeV3 = HeaderSizeV2;
     static inline constexpr int HeaderSizeV4 = HeaderSizeV3;
     static inline constexpr int HeaderSizeV5 = HeaderSizeV4;
+    static inline constexpr int HeaderSizeV6 = HeaderSizeV5;
 
-    static inline constexpr int HeaderSize[] = { HeaderSizeV1, HeaderSizeV2, HeaderSizeV3, HeaderSizeV4, HeaderSizeV5 };
+    static inline constexpr int HeaderSize[] = { HeaderSizeV1, HeaderSizeV2, HeaderSizeV3, HeaderSizeV4, HeaderSizeV5, HeaderSizeV6 };
     static_assert(sizeof(HeaderSize) / sizeof(int) == VERSION);
 
     static ommResult GetHeaderSize(int version, int& outSize)
@@ -137,7 +138,7 @@ namespace Cpu
     public:
         static inline constexpr HandleType kHandleType = HandleType::DeserializeResult;
 
-        DeserializedResultImpl(const StdAllocator<uint8_t>& stdAllocator, const Logger& log);
+        DeserializedResultImpl(const StdAllocator<uint8_t>& stdAllocator, const Logger& log, const parallel::Scheduler& scheduler);
         ~DeserializedResultImpl();
 
         inline const StdAllocator<uint8_t>& GetStdAllocator() const
@@ -161,6 +162,8 @@ namespace Cpu
 
         StdAllocator<uint8_t> m_stdAllocator;
         const Logger& m_log;
+        // Builds the acceleration data of deserialized textures.
+        const parallel::Scheduler& m_scheduler;
         ommCpuDeserializedDesc m_inputDesc;
         vector<uint8_t> m_deserializedData;
     };
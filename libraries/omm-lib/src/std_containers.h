@@ -18,6 +18,7 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 #include <streambuf>
 #include <ostream>
 #include <istream>
+#include <utility>
 
 #include "omm.h"
 
@@ -52,4 +53,40 @@ namespace omm
 
     template<class TVal>
     using list = std::list<TVal, StdAllocator<TVal>>;
+
+    // Unordered map with inline storage for at most kCapacity entries, found by linear search. For a handful of entries this
+    // beats hash_map, which allocates a node per insert. Offers the subset of the hash_map interface the bake passes use.
+    template<class TKey, class TVal, size_t kCapacity>
+    class small_map
+    {
+    public:
+        using value_type = std::pair<TKey, TVal>;
+        using iterator = value_type*;
+
+        static constexpr size_t capacity() { return kCapacity; }
+
+        size_t size() const { return m_size; }
+        iterator begin() { return m_entries; }
+        iterator end() { return m_entries + m_size; }
+
+        iterator find(const TKey& key)
+        {
+            for (size_t i = 0; i < m_size; ++i)
+            {
+                if (m_entries[i].first == key)
+                    return m_entries + i;
+            }
+            return end();
+        }
+
+        // Unlike hash_map the key is not checked for presence, find returns the first entry inserted. size() must be below capacity().
+        void insert(const value_type& entry)
+        {
+            m_entries[m_size++] = entry;
+        }
+
+    private:
+        value_type m_entries[kCapacity];
+        size_t m_size = 0;
+    };
 }
\ No newline at end of file
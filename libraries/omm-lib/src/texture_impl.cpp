@@ -17,6 +17,9 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 #include "util/bit_tricks.h"
 #include "util/texture.h"
 
+#include <xxhash.h>
+
+#include <atomic>
 #include <cstring>
 
 namespace omm
@@ -29,10 +32,14 @@ namespace omm
         m_textureFlags(ommCpuTextureFlags_None),
         m_tilingMode(TilingMode::MAX_NUM),
         m_alphaCutoff(-1.f),
+        m_blockCacheOwner(0),
         m_data(nullptr),
         m_dataSize(0),
         m_dataSAT(nullptr),
-        m_dataSATSize(0)
+        m_dataSATSize(0),
+        m_minMax(stdAllocator),
+        m_contentHash(0),
+        m_triangleCache(stdAllocator)
     {
     }
 
@@ -41,10 +48,50 @@ namespace omm
         Deallocate();
     }
 
+    static size_t GetSizePerPixel(ommCpuTextureFormat format)
+    {
+        if (format == ommCpuTextureFormat_UNORM8)
+            return sizeof(uint8_t);
+        else if (format == ommCpuTextureFormat_FP32)
+            return sizeof(float);
+        OMM_ASSERT(false);
+        return 0;
+    }
+
+    // Block compressed and bitmask textures are read in their input layout, they are never swizzled.
+    static bool HasNativeLayout(ommCpuTextureFormat format)
+    {
+        return format == ommCpuTextureFormat_BC4_UNORM || format == ommCpuTextureFormat_BC3_UNORM || format == ommCpuTextureFormat_R1_UNORM;
+    }
+
+    size_t TextureImpl::GetRowSize(ommCpuTextureFormat format, int32_t width)
+    {
+        if (format == ommCpuTextureFormat_BC4_UNORM)
+            return size_t((width + kBlockDim - 1) / kBlockDim) * 8;
+        else if (format == ommCpuTextureFormat_BC3_UNORM)
+            return size_t((width + kBlockDim - 1) / kBlockDim) * 16;
+        else if (format == ommCpuTextureFormat_R1_UNORM)
+            return size_t(width + 7) / 8;
+        return GetSizePerPixel(format) * width;
+    }
+
+    int32_t TextureImpl::GetRowCount(ommCpuTextureFormat format, int32_t height)
+    {
+        if (format == ommCpuTextureFormat_BC4_UNORM || format == ommCpuTextureFormat_BC3_UNORM)
+            return (height + kBlockDim - 1) / kBlockDim;
+        return height;
+    }
+
+    uint64_t TextureImpl::NextBlockCacheOwner()
+    {
+        static std::atomic<uint64_t> owner = 0;
+        return ++owner;
+    }
+
     ommResult TextureImpl::Validate(const ommCpuTextureDesc& desc) const {
         if (desc.mipCount == 0)
             return m_log.InvalidArg("[Invalid Arg] - mipCount must be non-zero");
-        if (desc.format == ommCpuTextureFormat_MAX_NUM)
+        if (desc.format >= ommCpuTextureFormat_MAX_NUM)
             return m_log.InvalidArg("[Invalid Arg] - format is not set");
 
         for (uint32_t i = 0; i < desc.mipCount; ++i)
@@ -61,32 +108,112 @@ namespace omm
                 return m_log.InvalidArg("[Invalid Arg] - mips.height must be less than kMaxDim.y (65536)");
         }
 
+        if (((uint32_t)desc.flags & (uint32_t)ommCpuTextureFlags_BorrowTextureData) != 0)
+        {
+            if (((uint32_t)desc.flags & (uint32_t)ommCpuTextureFlags_DisableZOrder) == 0 && !HasNativeLayout(desc.format))
+                return m_log.InvalidArg("[Invalid Arg] - BorrowTextureData requires DisableZOrder");
+
+            const size_t alignment = desc.format == ommCpuTextureFormat_FP32 ? sizeof(float) : sizeof(uint8_t);
+            for (uint32_t i = 0; i < desc.mipCount; ++i)
+            {
+                if (desc.mips[i].rowPitch != 0 && desc.mips[i].rowPitch < GetRowSize(desc.format, desc.mips[i].width))
+                    return m_log.InvalidArg("[Invalid Arg] - mips.rowPitch must be at least width times the texel size");
+                if (desc.mips[i].rowPitch % alignment != 0 || (uintptr_t)desc.mips[i].textureData % alignment != 0)
+                    return m_log.InvalidArg("[Invalid Arg] - Borrowed texture data and mips.rowPitch must be aligned to the texel size");
+            }
+        }
+
         return ommResult_SUCCESS;
     }
 
-    static size_t GetSizePerPixel(ommCpuTextureFormat format)
+    // Morton order is built a block of kMortonBlockSize x kMortonBlockSize texels at a time. The block origins are aligned
+    // to the block size, so the Morton index of a texel is the index of the block origin plus its index within the block.
+    // Every block is then a contiguous run of the destination, filled through a small table instead of interleaving the
+    // bits of every texel.
+    static constexpr int kMortonBlockSize = 16;
+
+    template<size_t kSizePerPixel>
+    static void SwizzleMortonBlockRows(const uint8_t* src, size_t srcRowPitch, uint8_t* dst, int2 size, uint32_t blockRowBegin, uint32_t blockRowEnd)
     {
-        if (format == ommCpuTextureFormat_UNORM8)
-            return sizeof(uint8_t);
-        else if (format == ommCpuTextureFormat_FP32)
-            return sizeof(float);
-        OMM_ASSERT(false);
-        return 0;
+        constexpr uint32_t kBlockTexels = kMortonBlockSize * kMortonBlockSize;
+        uint8_t localX[kBlockTexels];
+        uint8_t localY[kBlockTexels];
+        for (uint32_t m = 0; m < kBlockTexels; ++m)
+        {
+            uint32_t x, y;
+            bit_deinterleave_sw(m, x, y);
+            localX[m] = (uint8_t)x;
+            localY[m] = (uint8_t)y;
+        }
+
+        const int blockCountX = (size.x + kMortonBlockSize - 1) / kMortonBlockSize;
+        for (uint32_t blockY = blockRowBegin; blockY < blockRowEnd; ++blockY)
+        {
+            for (int blockX = 0; blockX < blockCountX; ++blockX)
+            {
+                const int2 origin = int2(blockX, blockY) * kMortonBlockSize;
+                uint8_t* blockDst = dst + size_t(xy_to_morton(origin.x, origin.y)) * kSizePerPixel;
+
+                if (origin.x + kMortonBlockSize <= size.x && origin.y + kMortonBlockSize <= size.y)
+                {
+                    for (uint32_t m = 0; m < kBlockTexels; ++m)
+                        memcpy(blockDst + m * kSizePerPixel, src + size_t(origin.y + localY[m]) * srcRowPitch + size_t(origin.x + localX[m]) * kSizePerPixel, kSizePerPixel);
+                }
+                else
+                {
+                    // Edge block, the texels outside the mip are padding.
+                    for (uint32_t m = 0; m < kBlockTexels; ++m)
+                    {
+                        const int x = origin.x + localX[m];
+                        const int y = origin.y + localY[m];
+                        if (x < size.x && y < size.y)
+                            memcpy(blockDst + m * kSizePerPixel, src + size_t(y) * srcRowPitch + size_t(x) * kSizePerPixel, kSizePerPixel);
+                    }
+                }
+            }
+        }
     }
 
-    ommResult TextureImpl::Create(const ommCpuTextureDesc& desc)
+    template<ommCpuTextureFormat eFormat, TilingMode eTilingMode>
+    void TextureImpl::BuildSATRows(int32_t mip, uint32_t rowBegin, uint32_t rowEnd)
+    {
+        uint32_t* dataSAT = (uint32_t*)(m_dataSAT + m_mips[mip].dataOffsetSAT);
+        const int width = m_mips[mip].size.x;
+
+        for (uint32_t j = rowBegin; j < rowEnd; ++j)
+        {
+            uint32_t* row = dataSAT + size_t(j) * width;
+            uint32_t sum = 0;
+            for (int i = 0; i < width; ++i)
+            {
+                sum += Load<eFormat, eTilingMode>(int2(i, j), mip) > m_alphaCutoff;
+                row[i] = sum;
+            }
+        }
+    }
+
+    ommResult TextureImpl::Create(const ommCpuTextureDesc& desc, const parallel::Scheduler& scheduler)
     {
         RETURN_STATUS_IF_FAILED(Validate(desc));
 
         Deallocate();
 
         m_mips.resize(desc.mipCount);
-        m_tilingMode = !!((uint32_t)desc.flags & (uint32_t)ommCpuTextureFlags_DisableZOrder) ? TilingMode::Linear : TilingMode::MortonZ;
+        const bool disableZOrder = !!((uint32_t)desc.flags & (uint32_t)ommCpuTextureFlags_DisableZOrder);
+        m_tilingMode = disableZOrder || HasNativeLayout(desc.format) ? TilingMode::Linear : TilingMode::MortonZ;
+        if (m_tilingMode == TilingMode::MortonZ)
+        {
+            // Morton order pads to a power of two square, a 4096x256 texture would take 16x its size. Tiles keep most of the
+            // locality and only pad to whole tiles.
+            const size_t maxDim = nextPow2(std::max(desc.mips[0].width, desc.mips[0].height));
+            const size_t tiledElements = size_t(math::Align<uint32_t>(desc.mips[0].width, kTileSize)) * math::Align<uint32_t>(desc.mips[0].height, kTileSize);
+            if (4 * maxDim * maxDim > 5 * tiledElements)
+                m_tilingMode = TilingMode::Tiled;
+        }
         m_textureFormat = desc.format;
         m_alphaCutoff = desc.alphaCutoff;
         m_textureFlags = desc.flags;
-
-        const size_t sizePerPixel = GetSizePerPixel(m_textureFormat);
+        m_blockCacheOwner = NextBlockCacheOwner();
 
         const bool enableSAT = std::numeric_limits<uint32_t>::max() > m_mips[0].numElements && m_alphaCutoff >= 0;
 
@@ -106,7 +233,6 @@ namespace omm
 
             if (m_tilingMode == TilingMode::Linear)
             {
-              //  m_mips[mipIt].rowPitch = sizePerPixel * size_t(m_mips[mipIt].size.x);
                 m_mips[mipIt].numElements = size_t(m_mips[mipIt].size.x) * m_mips[mipIt].size.y;
             }
             else if (m_tilingMode == TilingMode::MortonZ)
@@ -115,14 +241,31 @@ namespace omm
              //   m_mips[mipIt].rowPitch = sizePerPixel * maxDim;
                 m_mips[mipIt].numElements = maxDim * maxDim;
             }
+            else if (m_tilingMode == TilingMode::Tiled)
+            {
+                m_mips[mipIt].numElements = size_t(math::Align(m_mips[mipIt].size.x, kTileSize)) * math::Align(m_mips[mipIt].size.y, kTileSize);
+            }
             else
             {
                 OMM_ASSERT(false);
                 return ommResult_FAILURE;
             }
 
-            m_dataSize += sizePerPixel * m_mips[mipIt].numElements;
-            m_dataSize = math::Align(m_dataSize, kAlignment);
+            const size_t rowSize = GetRowSize(m_textureFormat, m_mips[mipIt].size.x);
+            if (IsBorrowed())
+            {
+                m_mips[mipIt].data = (const uint8_t*)desc.mips[mipIt].textureData;
+                m_mips[mipIt].rowPitch = desc.mips[mipIt].rowPitch == 0 ? rowSize : desc.mips[mipIt].rowPitch;
+            }
+            else
+            {
+                m_mips[mipIt].rowPitch = rowSize;
+                if (m_tilingMode == TilingMode::Linear)
+                    m_dataSize += rowSize * GetRowCount(m_textureFormat, m_mips[mipIt].size.y);
+                else
+                    m_dataSize += GetSizePerPixel(m_textureFormat) * m_mips[mipIt].numElements;
+                m_dataSize = math::Align(m_dataSize, kAlignment);
+            }
 
             if (enableSAT)
             {
@@ -131,56 +274,84 @@ namespace omm
             }
         }
 
-        m_data = m_stdAllocator.allocate(m_dataSize, kAlignment);
+        // Borrowed textures only allocate the acceleration data.
+        m_data = IsBorrowed() ? nullptr : m_stdAllocator.allocate(m_dataSize, kAlignment);
         m_dataSAT = enableSAT ? m_stdAllocator.allocate(m_dataSATSize, kAlignment) : nullptr;
 
         for (uint32_t mipIt = 0; mipIt < desc.mipCount; ++mipIt)
         {
-            if (m_tilingMode == TilingMode::Linear)
+            const int2 size = m_mips[mipIt].size;
+            const bool enableThreads = IsThreadingEnabled() && m_mips[mipIt].numElements >= kMinParallelTexels;
+
+            if (IsBorrowed())
             {
-                const size_t kDefaultRowPitch = sizePerPixel * desc.mips[mipIt].width;
+                OMM_ASSERT(m_tilingMode == TilingMode::Linear);
+            }
+            else if (m_tilingMode == TilingMode::Linear)
+            {
+                m_mips[mipIt].data = m_data + m_mips[mipIt].dataOffset;
+
+                const size_t kDefaultRowPitch = m_mips[mipIt].rowPitch;
                 const size_t srcRowPitch = desc.mips[mipIt].rowPitch == 0 ? kDefaultRowPitch : desc.mips[mipIt].rowPitch;
 
-                if (kDefaultRowPitch == srcRowPitch)
-                {
-                    void* dst = m_data + m_mips[mipIt].dataOffset;
-                    const void* src = (desc.mips[mipIt].textureData);
-                    std::memcpy(dst, src, sizePerPixel * m_mips[mipIt].numElements);
-                }
-                else
-                {
-                    uint8_t* dstBegin = m_data + m_mips[mipIt].dataOffset;
-                    const uint8_t* srcBegin = (const uint8_t*)desc.mips[mipIt].textureData;
+                uint8_t* dstBegin = m_data + m_mips[mipIt].dataOffset;
+                const uint8_t* srcBegin = (const uint8_t*)desc.mips[mipIt].textureData;
 
-                    const size_t dstRowPitch = m_mips[mipIt].size.x * sizePerPixel;
-                    for (uint32_t rowIt = 0; rowIt < desc.mips[mipIt].height; rowIt++)
+                scheduler.ParallelForBlocks(m_stdAllocator, enableThreads, GetRowCount(m_textureFormat, size.y), 64, [&](uint32_t rowBegin, uint32_t rowEnd) {
+                    if (kDefaultRowPitch == srcRowPitch)
                     {
-                        uint8_t* dst = dstBegin + rowIt * dstRowPitch;
-                        const uint8_t* src = srcBegin + rowIt * srcRowPitch;
-                        std::memcpy(dst, src, dstRowPitch);
+                        std::memcpy(dstBegin + rowBegin * kDefaultRowPitch, srcBegin + rowBegin * srcRowPitch, (rowEnd - rowBegin) * kDefaultRowPitch);
                     }
-                }
+                    else
+                    {
+                        for (uint32_t rowIt = rowBegin; rowIt < rowEnd; rowIt++)
+                            std::memcpy(dstBegin + rowIt * kDefaultRowPitch, srcBegin + rowIt * srcRowPitch, kDefaultRowPitch);
+                    }
+                });
             }
             else if (m_tilingMode == TilingMode::MortonZ)
             {
+                m_mips[mipIt].data = m_data + m_mips[mipIt].dataOffset;
+
                 uint8_t* dst = (uint8_t*)(m_data + m_mips[mipIt].dataOffset);
                 const uint8_t* src = (uint8_t*)(desc.mips[mipIt].textureData);
 
+                const size_t sizePerPixel = GetSizePerPixel(m_textureFormat);
                 const size_t rowPitch = desc.mips[mipIt].rowPitch == 0 ? desc.mips[mipIt].width : desc.mips[mipIt].rowPitch;
+                const size_t srcRowPitch = rowPitch * sizePerPixel;
+
+                const uint32_t blockRowCount = (size.y + kMortonBlockSize - 1) / kMortonBlockSize;
+                scheduler.ParallelForBlocks(m_stdAllocator, enableThreads, blockRowCount, 4, [&](uint32_t blockRowBegin, uint32_t blockRowEnd) {
+                    if (sizePerPixel == sizeof(float))
+                        SwizzleMortonBlockRows<sizeof(float)>(src, srcRowPitch, dst, size, blockRowBegin, blockRowEnd);
+                    else
+                        SwizzleMortonBlockRows<sizeof(uint8_t)>(src, srcRowPitch, dst, size, blockRowBegin, blockRowEnd);
+                });
+            }
+            else if (m_tilingMode == TilingMode::Tiled)
+            {
+                m_mips[mipIt].data = m_data + m_mips[mipIt].dataOffset;
 
-                for (int j = 0; j < m_mips[mipIt].size.y; ++j)
-                {
-                    for (int i = 0; i < m_mips[mipIt].size.x; ++i)
-                    {
-                        const uint64_t idx = From2Dto1D<TilingMode::MortonZ>(int2(i, j), m_mips[mipIt].size);
-                        OMM_ASSERT(idx < m_mips[mipIt].numElements);
+                uint8_t* dst = (uint8_t*)(m_data + m_mips[mipIt].dataOffset);
+                const uint8_t* src = (uint8_t*)(desc.mips[mipIt].textureData);
 
-                        uint8_t* cpyDst         = dst + idx * sizePerPixel;
-                        const uint8_t* cpySrc   = src + (i + j * rowPitch) * sizePerPixel;
+                // Same rowPitch convention as the Morton layout it replaces.
+                const size_t sizePerPixel = GetSizePerPixel(m_textureFormat);
+                const size_t rowPitch = desc.mips[mipIt].rowPitch == 0 ? desc.mips[mipIt].width : desc.mips[mipIt].rowPitch;
+                const size_t srcRowPitch = rowPitch * sizePerPixel;
 
-                        memcpy(cpyDst, cpySrc, sizePerPixel);
+                // The texels of a row inside a tile are contiguous.
+                scheduler.ParallelForBlocks(m_stdAllocator, enableThreads, size.y, 64, [&](uint32_t rowBegin, uint32_t rowEnd) {
+                    for (uint32_t j = rowBegin; j < rowEnd; ++j)
+                    {
+                        const uint8_t* srcRow = src + j * srcRowPitch;
+                        for (int i = 0; i < size.x; i += kTileSize)
+                        {
+                            const size_t idx = From2Dto1D<TilingMode::Tiled>(int2(i, j), size);
+                            std::memcpy(dst + idx * sizePerPixel, srcRow + i * sizePerPixel, std::min(kTileSize, size.x - i) * sizePerPixel);
+                        }
                     }
-                }
+                });
             }
             else
             {
@@ -190,37 +361,260 @@ namespace omm
 
             if (enableSAT)
             {
-                uint32_t* dataSAT = (uint32_t * )(m_dataSAT + m_mips[mipIt].dataOffsetSAT);
+                // Prefix sums of the rows, then of the columns. Rows and column ranges are independent.
+                scheduler.ParallelForBlocks(m_stdAllocator, enableThreads, size.y, 64, [&](uint32_t rowBegin, uint32_t rowEnd) {
+                    if (m_textureFormat == ommCpuTextureFormat_FP32 && m_tilingMode == TilingMode::Linear)
+                        BuildSATRows<ommCpuTextureFormat_FP32, TilingMode::Linear>(mipIt, rowBegin, rowEnd);
+                    else if (m_textureFormat == ommCpuTextureFormat_FP32 && m_tilingMode == TilingMode::MortonZ)
+                        BuildSATRows<ommCpuTextureFormat_FP32, TilingMode::MortonZ>(mipIt, rowBegin, rowEnd);
+                    else if (m_textureFormat == ommCpuTextureFormat_UNORM8 && m_tilingMode == TilingMode::Linear)
+                        BuildSATRows<ommCpuTextureFormat_UNORM8, TilingMode::Linear>(mipIt, rowBegin, rowEnd);
+                    else if (m_textureFormat == ommCpuTextureFormat_UNORM8 && m_tilingMode == TilingMode::MortonZ)
+                        BuildSATRows<ommCpuTextureFormat_UNORM8, TilingMode::MortonZ>(mipIt, rowBegin, rowEnd);
+                    else if (m_textureFormat == ommCpuTextureFormat_FP32 && m_tilingMode == TilingMode::Tiled)
+                        BuildSATRows<ommCpuTextureFormat_FP32, TilingMode::Tiled>(mipIt, rowBegin, rowEnd);
+                    else if (m_textureFormat == ommCpuTextureFormat_UNORM8 && m_tilingMode == TilingMode::Tiled)
+                        BuildSATRows<ommCpuTextureFormat_UNORM8, TilingMode::Tiled>(mipIt, rowBegin, rowEnd);
+                    else if (m_textureFormat == ommCpuTextureFormat_BC4_UNORM)
+                        BuildSATRows<ommCpuTextureFormat_BC4_UNORM, TilingMode::Linear>(mipIt, rowBegin, rowEnd);
+                    else if (m_textureFormat == ommCpuTextureFormat_BC3_UNORM)
+                        BuildSATRows<ommCpuTextureFormat_BC3_UNORM, TilingMode::Linear>(mipIt, rowBegin, rowEnd);
+                    else if (m_textureFormat == ommCpuTextureFormat_R1_UNORM)
+                        BuildSATRows<ommCpuTextureFormat_R1_UNORM, TilingMode::Linear>(mipIt, rowBegin, rowEnd);
+                });
+
+                uint32_t* dataSAT = (uint32_t*)(m_dataSAT + m_mips[mipIt].dataOffsetSAT);
+                scheduler.ParallelForBlocks(m_stdAllocator, enableThreads, size.x, 256, [&](uint32_t columnBegin, uint32_t columnEnd) {
+                    for (int j = 1; j < size.y; ++j)
+                    {
+                        uint32_t* row = dataSAT + size_t(j) * size.x;
+                        const uint32_t* prevRow = row - size.x;
+                        for (uint32_t i = columnBegin; i < columnEnd; ++i)
+                            row[i] += prevRow[i];
+                    }
+                });
+            }
+        }
 
-                for (int j = 0; j < m_mips[mipIt].size.y; ++j)
-                {
-                    for (int i = 0; i < m_mips[mipIt].size.x; ++i)
+        if (((uint32_t)m_textureFlags & (uint32_t)ommCpuTextureFlags_EnableMinMaxPyramid) != 0)
+            BuildMinMaxPyramid(scheduler);
+
+        return ommResult_SUCCESS;
+    }
+
+    void TextureImpl::BuildMinMaxPyramid(const parallel::Scheduler& scheduler)
+    {
+        size_t minMaxSize = 0;
+        for (Mips& mip : m_mips)
+        {
+            // Level l has a node per 2^(l+1) x 2^(l+1) texel block, down to a single node.
+            mip.minMaxLevelCount = 0;
+            int2 levelSize = mip.size;
+            do
+            {
+                OMM_ASSERT(mip.minMaxLevelCount < kMaxMinMaxLevels);
+                levelSize = (levelSize + 1) / 2;
+                mip.minMaxLevelOffset[mip.minMaxLevelCount++] = minMaxSize;
+                minMaxSize += size_t(levelSize.x) * levelSize.y;
+            } while (levelSize.x > 1 || levelSize.y > 1);
+        }
+
+        m_minMax.resize(minMaxSize);
+
+        for (uint32_t mipIt = 0; mipIt < m_mips.size(); ++mipIt)
+        {
+            const Mips& mip = m_mips[mipIt];
+
+            int2 srcSize = mip.size;
+            for (uint32_t levelIt = 0; levelIt < mip.minMaxLevelCount; ++levelIt)
+            {
+                const int2 dstSize = (srcSize + 1) / 2;
+                const float2* src = m_minMax.data() + (levelIt == 0 ? 0 : mip.minMaxLevelOffset[levelIt - 1]);
+                float2* dst = m_minMax.data() + mip.minMaxLevelOffset[levelIt];
+
+                const bool enableThreads = IsThreadingEnabled() && size_t(dstSize.x) * dstSize.y * 4 >= kMinParallelTexels;
+                scheduler.ParallelForBlocks(m_stdAllocator, enableThreads, dstSize.y, 32, [&](uint32_t rowBegin, uint32_t rowEnd) {
+                    for (int j = (int)rowBegin; j < (int)rowEnd; ++j)
                     {
-                        dataSAT[i + j * m_mips[mipIt].size.x] = Load(int2(i, j), mipIt) > m_alphaCutoff;
+                        for (int i = 0; i < dstSize.x; ++i)
+                        {
+                            // Blocks on the right and bottom edges of odd sized levels are clamped to the last column and row.
+                            const int2 c0 = int2(2 * i, 2 * j);
+                            const int2 c1 = glm::min(c0 + 1, srcSize - 1);
+
+                            float2 minMax;
+                            if (levelIt == 0)
+                            {
+                                const float a0 = Load(int2(c0.x, c0.y), mipIt);
+                                const float a1 = Load(int2(c1.x, c0.y), mipIt);
+                                const float a2 = Load(int2(c0.x, c1.y), mipIt);
+                                const float a3 = Load(int2(c1.x, c1.y), mipIt);
+                                minMax = float2(std::min(std::min(a0, a1), std::min(a2, a3)), std::max(std::max(a0, a1), std::max(a2, a3)));
+                            }
+                            else
+                            {
+                                const float2 n0 = src[c0.x + c0.y * srcSize.x];
+                                const float2 n1 = src[c1.x + c0.y * srcSize.x];
+                                const float2 n2 = src[c0.x + c1.y * srcSize.x];
+                                const float2 n3 = src[c1.x + c1.y * srcSize.x];
+                                minMax = float2(std::min(std::min(n0.x, n1.x), std::min(n2.x, n3.x)), std::max(std::max(n0.y, n1.y), std::max(n2.y, n3.y)));
+                            }
+                            dst[i + j * dstSize.x] = minMax;
+                        }
                     }
-                }
+                });
+                srcSize = dstSize;
+            }
+        }
+    }
+
+    int32_t TextureImpl::CompareRange(int2 s, int2 e, int32_t mip, float alphaCutoff) const
+    {
+        const float2 minMax = GetMinMax(s, e, mip);
+        if (alphaCutoff < minMax.x)
+            return 1;
+        if (minMax.y <= alphaCutoff)
+            return -1;
+
+        // The covering nodes straddle the cutoff, visit their children that overlap the rectangle until both sides are found
+        // or the texels are exhausted. Nodes fully inside the rectangle answer for all of their texels.
+        const Mips& m = m_mips[mip];
+        bool hasAbove = false;
+        bool hasBelow = false;
+
+        auto Visit = [&](auto& self, uint32_t levelIt, int2 node) -> void {
+            const uint32_t shift = levelIt + 1;
+            const int2 ns = node << shift;
+            const int2 ne = glm::min(((node + 1) << shift) - 1, m.sizeMinusOne);
+            if (ne.x < s.x || ne.y < s.y || ns.x > e.x || ns.y > e.y)
+                return;
+
+            if (s.x <= ns.x && s.y <= ns.y && ne.x <= e.x && ne.y <= e.y)
+            {
+                const int width = ((m.size.x - 1) >> shift) + 1;
+                const float2 nodeMinMax = m_minMax[m.minMaxLevelOffset[levelIt] + node.x + node.y * width];
+                hasAbove |= alphaCutoff < nodeMinMax.y;
+                hasBelow |= nodeMinMax.x <= alphaCutoff;
+                return;
+            }
 
-                // sum in X
-                for (int j = 0; j < m_mips[mipIt].size.y; ++j)
+            if (levelIt == 0)
+            {
+                const int2 ts = glm::max(ns, s);
+                const int2 te = glm::min(ne, e);
+                for (int j = ts.y; j <= te.y; ++j)
                 {
-                    for (int i = 1; i < m_mips[mipIt].size.x; ++i)
+                    for (int i = ts.x; i <= te.x; ++i)
                     {
-                        dataSAT[i + j * m_mips[mipIt].size.x] += dataSAT[i - 1 + j * m_mips[mipIt].size.x];
+                        const float alpha = Load(int2(i, j), mip);
+                        hasAbove |= alphaCutoff < alpha;
+                        hasBelow |= alpha <= alphaCutoff;
                     }
                 }
+                return;
+            }
 
-                // sum in Y
-                for (int j = 1; j < m_mips[mipIt].size.y; ++j)
+            const int2 childLevelSize = ((m.size - 1) >> (int)levelIt) + 1;
+            for (int j = 0; j < 2 && !(hasAbove && hasBelow); ++j)
+            {
+                for (int i = 0; i < 2 && !(hasAbove && hasBelow); ++i)
                 {
-                    for (int i = 0; i < m_mips[mipIt].size.x; ++i)
+                    const int2 child = 2 * node + int2(i, j);
+                    if (child.x < childLevelSize.x && child.y < childLevelSize.y)
+                        self(self, levelIt - 1, child);
+                }
+            }
+        };
+
+        // Same covering nodes as GetMinMax.
+        uint32_t shift = 1;
+        while ((e.x >> shift) - (s.x >> shift) > 1 || (e.y >> shift) - (s.y >> shift) > 1)
+            ++shift;
+
+        const int2 ns = s >> shift;
+        const int2 ne = e >> shift;
+        for (int j = ns.y; j <= ne.y && !(hasAbove && hasBelow); ++j)
+        {
+            for (int i = ns.x; i <= ne.x && !(hasAbove && hasBelow); ++i)
+                Visit(Visit, shift - 1, int2(i, j));
+        }
+
+        if (hasAbove && hasBelow)
+            return 0;
+        return hasAbove ? 1 : -1;
+    }
+
+    uint64_t TextureImpl::GetContentHash() const
+    {
+        std::call_once(m_contentHashOnce, [this]() {
+            // Inputs are staged in 64-bit words, the type XXH64 reads its input as.
+            const uint64_t format = (uint64_t)m_textureFormat;
+            uint64_t digest = XXH64((const void*)&format, sizeof(format), 42/*seed*/);
+
+            vector<uint64_t> row(m_stdAllocator);
+            for (uint32_t mipIt = 0; mipIt < m_mips.size(); ++mipIt)
+            {
+                const int2 size = m_mips[mipIt].size;
+                const uint64_t sizeWord = ((uint64_t)size.x << 32) | (uint64_t)size.y;
+                digest = XXH64((const void*)&sizeWord, sizeof(sizeWord), digest);
+
+                // Hashed a row at a time in linear order, this also skips the padding of non-square Morton mips.
+                const uint8_t* data = m_mips[mipIt].data;
+                const size_t rowSize = GetRowSize(m_textureFormat, size.x);
+                row.resize((rowSize + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+                uint8_t* rowData = (uint8_t*)row.data();
+                for (int j = 0; j < GetRowCount(m_textureFormat, size.y); ++j)
+                {
+                    if (m_tilingMode == TilingMode::Linear)
+                    {
+                        memcpy(rowData, data + j * m_mips[mipIt].rowPitch, rowSize);
+                    }
+                    else
                     {
-                        dataSAT[i + j * m_mips[mipIt].size.x] += dataSAT[i + (j - 1) * m_mips[mipIt].size.x];
+                        const size_t sizePerPixel = GetSizePerPixel(m_textureFormat);
+                        for (int i = 0; i < size.x; ++i)
+                        {
+                            const uint64_t idx = m_tilingMode == TilingMode::MortonZ ? From2Dto1D<TilingMode::MortonZ>(int2(i, j), size) : From2Dto1D<TilingMode::Tiled>(int2(i, j), size);
+                            memcpy(rowData + i * sizePerPixel, data + idx * sizePerPixel, sizePerPixel);
+                        }
                     }
+                    digest = XXH64((const void*)rowData, rowSize, digest);
                 }
             }
-        }
 
-        return ommResult_SUCCESS;
+            m_contentHash = digest;
+        });
+        return m_contentHash;
+    }
+
+    bool TextureImpl::LoadTriangleCache(const uint64_t* key, size_t keySize, uint64_t* data, size_t dataSize) const
+    {
+        const uint64_t hash = XXH64((const void*)key, keySize * sizeof(uint64_t), 42/*seed*/);
+
+        std::shared_lock lock(m_triangleCacheMutex);
+        auto it = m_triangleCache.find(hash);
+        if (it == m_triangleCache.end())
+            return false;
+
+        const vector<uint64_t>& entry = it->second;
+        if (entry.size() != keySize + dataSize || !std::equal(key, key + keySize, entry.begin()))
+            return false;
+
+        std::copy(entry.begin() + keySize, entry.end(), data);
+        return true;
+    }
+
+    void TextureImpl::StoreTriangleCache(const uint64_t* key, size_t keySize, const uint64_t* data, size_t dataSize) const
+    {
+        const uint64_t hash = XXH64((const void*)key, keySize * sizeof(uint64_t), 42/*seed*/);
+
+        vector<uint64_t> entry(m_stdAllocator);
+        entry.reserve(keySize + dataSize);
+        entry.insert(entry.end(), key, key + keySize);
+        entry.insert(entry.end(), data, data + dataSize);
+
+        std::unique_lock lock(m_triangleCacheMutex);
+        m_triangleCache.insert_or_assign(hash, std::move(entry));
     }
 
     void TextureImpl::Deallocate()
@@ -236,6 +630,8 @@ namespace omm
             m_dataSAT = nullptr;
         }
         m_mips.clear();
+        m_minMax.clear();
+        m_triangleCache.clear();
     }
 
     float TextureImpl::Load(const int2& texCoord, int32_t mip) const 
@@ -246,6 +642,8 @@ namespace omm
                 return Load<ommCpuTextureFormat_FP32, TilingMode::Linear>(texCoord, mip);
             else if (m_tilingMode == TilingMode::MortonZ)
                 return Load<ommCpuTextureFormat_FP32, TilingMode::MortonZ>(texCoord, mip);
+            else if (m_tilingMode == TilingMode::Tiled)
+                return Load<ommCpuTextureFormat_FP32, TilingMode::Tiled>(texCoord, mip);
         }
         else if (m_textureFormat == ommCpuTextureFormat_UNORM8)
         {
@@ -253,22 +651,36 @@ namespace omm
                 return Load<ommCpuTextureFormat_UNORM8, TilingMode::Linear>(texCoord, mip);
             else if (m_tilingMode == TilingMode::MortonZ)
                 return Load<ommCpuTextureFormat_UNORM8, TilingMode::MortonZ>(texCoord, mip);
+            else if (m_tilingMode == TilingMode::Tiled)
+                return Load<ommCpuTextureFormat_UNORM8, TilingMode::Tiled>(texCoord, mip);
         }
+        else if (m_textureFormat == ommCpuTextureFormat_BC4_UNORM)
+            return Load<ommCpuTextureFormat_BC4_UNORM, TilingMode::Linear>(texCoord, mip);
+        else if (m_textureFormat == ommCpuTextureFormat_BC3_UNORM)
+            return Load<ommCpuTextureFormat_BC3_UNORM, TilingMode::Linear>(texCoord, mip);
+        else if (m_textureFormat == ommCpuTextureFormat_R1_UNORM)
+            return Load<ommCpuTextureFormat_R1_UNORM, TilingMode::Linear>(texCoord, mip);
         OMM_ASSERT(false);
         return 0.f;
     }
 
-    float TextureImpl::Bilinear(ommTextureAddressMode mode, const float2& p, int32_t mip) const 
+    float TextureImpl::Bilinear(ommTextureAddressMode mode, const float2& p, int32_t mip, float borderAlpha) const 
     {
         float2 pixel = p * (float2)(m_mips[mip].size)-0.5f;
         float2 pixelFloor = glm::floor(pixel);
         int2 coords[omm::TexelOffset::MAX_NUM];
         omm::GatherTexCoord4(mode, m_mips[mip].sizeIsPow2, int2(pixelFloor), m_mips[mip].size, m_mips[mip].sizeLog2, coords);
 
-        float a = (float)Load(coords[omm::TexelOffset::I0x0], mip);
-        float b = (float)Load(coords[omm::TexelOffset::I0x1], mip);
-        float c = (float)Load(coords[omm::TexelOffset::I1x0], mip);
-        float d = (float)Load(coords[omm::TexelOffset::I1x1], mip);
+        auto LoadOrBorder = [&](const int2& coord) {
+            if (coord.x == kTexCoordBorder || coord.y == kTexCoordBorder)
+                return borderAlpha;
+            return (float)Load(coord, mip);
+        };
+
+        float a = LoadOrBorder(coords[omm::TexelOffset::I0x0]);
+        float b = LoadOrBorder(coords[omm::TexelOffset::I0x1]);
+        float c = LoadOrBorder(coords[omm::TexelOffset::I1x0]);
+        float d = LoadOrBorder(coords[omm::TexelOffset::I1x1]);
 
         const float2 weight = glm::fract(pixel);
         float ac = glm::lerp<float>(a, c, weight.x);
@@ -292,32 +704,45 @@ namespace omm
             ommCpuTextureMipDesc& mip = const_cast<ommCpuTextureMipDesc&>(desc.mips[mipIt]);
             mip.width = m_mips[mipIt].size.x;
             mip.height = m_mips[mipIt].size.y;
-            mip.rowPitch = m_mips[mipIt].size.x;
+            mip.rowPitch = HasNativeLayout(m_textureFormat) ? (uint32_t)GetRowSize(m_textureFormat, mip.width) : mip.width;
             if (mip.textureData != nullptr)
             {
-                const size_t sizePerPixel = GetSizePerPixel(m_textureFormat);
-
-                if (m_tilingMode == TilingMode::MortonZ)
+                if (m_tilingMode == TilingMode::MortonZ || m_tilingMode == TilingMode::Tiled)
                 {
-                    const uint8_t* src = (uint8_t*)(m_data + m_mips[mipIt].dataOffset);
+                    const size_t sizePerPixel = GetSizePerPixel(m_textureFormat);
+                    const uint8_t* src = m_mips[mipIt].data;
                     uint8_t* dst = (uint8_t*)(desc.mips[mipIt].textureData);
 
-                    for (int i = 0; i < m_mips[mipIt].numElements; ++i)
+                    // Visits the texels in linear order, the padding of the swizzled layouts must not be copied out.
+                    for (int j = 0; j < m_mips[mipIt].size.y; ++j)
                     {
-                        const int2 pos = From1Dto2D<TilingMode::MortonZ>(i, m_mips[mipIt].size);
+                        for (int i = 0; i < m_mips[mipIt].size.x; ++i)
+                        {
+                            const int2 size = m_mips[mipIt].size;
+                            const uint64_t idx = m_tilingMode == TilingMode::MortonZ ? From2Dto1D<TilingMode::MortonZ>(int2(i, j), size) : From2Dto1D<TilingMode::Tiled>(int2(i, j), size);
 
-                        const uint8_t* cpySrc = src + i * sizePerPixel;
-                        uint8_t* cpyDst = dst + (pos.x + pos.y * desc.mips[mipIt].rowPitch) * sizePerPixel;
+                            const uint8_t* cpySrc = src + idx * sizePerPixel;
+                            uint8_t* cpyDst = dst + (i + j * desc.mips[mipIt].rowPitch) * sizePerPixel;
 
-                        memcpy(cpyDst, cpySrc, sizePerPixel);
+                            memcpy(cpyDst, cpySrc, sizePerPixel);
+                        }
                     }
                 }
                 else // if (m_tilingMode == TilingMode::Linear)
                 {
-                    const uint8_t* src = (uint8_t*)(m_data + m_mips[mipIt].dataOffset);
+                    const uint8_t* src = m_mips[mipIt].data;
                     uint8_t* dst = (uint8_t*)(desc.mips[mipIt].textureData);
-                    size_t numTexels = mip.width * mip.height;
-                    memcpy(dst, src, numTexels * sizePerPixel);
+                    const size_t rowSize = GetRowSize(m_textureFormat, mip.width);
+                    const int32_t rowCount = GetRowCount(m_textureFormat, mip.height);
+                    if (m_mips[mipIt].rowPitch == rowSize)
+                    {
+                        memcpy(dst, src, rowCount * rowSize);
+                    }
+                    else
+                    {
+                        for (int32_t j = 0; j < rowCount; ++j)
+                            memcpy(dst + j * rowSize, src + j * m_mips[mipIt].rowPitch, rowSize);
+                    }
                 }
             }
         }
@@ -342,6 +767,12 @@ namespace omm
         return xy_to_morton(idx.x, idx.y);
     }
 
+    template<>
+    uint32_t TextureImpl::From2Dto1D<TilingMode::Tiled>(const int2& idx, const int2& size)
+    {
+        return GetTiledIndex(idx, size);
+    }
+
     template<> uint2 TextureImpl::From1Dto2D<TilingMode::Linear>(const uint32_t idx, const int2& size)
     {
         uint2 pos;
@@ -357,4 +788,9 @@ namespace omm
         return res;
     }
 
+    template<> uint2 TextureImpl::From1Dto2D<TilingMode::Tiled>(const uint32_t idx, const int2& size)
+    {
+        return GetTiledTexCoord(idx, size);
+    }
+
 }
@@ -20,12 +20,22 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 #include "util/assert.h"
 #include "util/bit_tricks.h"
 #include "util/texture.h"
+#include "util/block_compression.h"
+#include "util/simd.h"
+#include "util/parallel.h"
+
+#include <cstring>
+
+#include <mutex>
+#include <shared_mutex>
 
 namespace omm
 {
     enum class TilingMode {
         Linear,
         MortonZ,
+        // Row major tiles of row major texels, padded to whole tiles instead of a power of two square.
+        Tiled,
         MAX_NUM,
     };
 
@@ -37,17 +47,24 @@ namespace omm
         TextureImpl(const StdAllocator<uint8_t>& stdAllocator, const Logger& log);
         ~TextureImpl();
 
-        ommResult Create(const ommCpuTextureDesc& desc);
+        // With ommCpuTextureFlags_EnableInternalThreads large mips are copied, swizzled and summed on the threads of scheduler.
+        ommResult Create(const ommCpuTextureDesc& desc, const parallel::Scheduler& scheduler);
 
         template<ommCpuTextureFormat eFormat, TilingMode eTilingMode>
         float Load(const int2& texCoord, int32_t mip) const;
 
         float Load(const int2& texCoord, int32_t mip) const;
 
+        // Compares the count <= 64 texels [texCoord, texCoord + (count, 0)) of a row inside the mip with alphaCutoff.
+        // Bit i of above is set when alphaCutoff < texel i, bit i of below when texel i < alphaCutoff.
+        template<ommCpuTextureFormat eFormat, TilingMode eTilingMode>
+        void CompareSpan(const int2& texCoord, uint32_t count, int32_t mip, float alphaCutoff, uint64_t& above, uint64_t& below) const;
+
         template<ommCpuTextureFormat eFormat, TilingMode eTilingMode, ommTextureAddressMode eMode, bool bTexIsPow2>
         float Bilinear(const float2& p, int32_t mip) const;
 
-        float Bilinear(ommTextureAddressMode mode, const float2& p, int32_t mip) const;
+        // Texels outside the texture in ommTextureAddressMode_Border read as borderAlpha.
+        float Bilinear(ommTextureAddressMode mode, const float2& p, int32_t mip, float borderAlpha) const;
 
         ommResult GetTextureDesc(ommCpuTextureDesc& desc) const;
 
@@ -124,16 +141,100 @@ namespace omm
             return sum;
         }
 
+        bool HasMinMaxPyramid() const
+        {
+            return !m_minMax.empty();
+        }
+
+        // Conservative alpha range (min, max) of the texels [s, e] of the mip, read from at most 2x2 nodes of the min/max
+        // pyramid. The range may include texels around the rectangle.
+        float2 GetMinMax(int2 s, int2 e, int32_t mip) const
+        {
+            OMM_ASSERT(HasMinMaxPyramid());
+            OMM_ASSERT(InTexture(s, mip));
+            OMM_ASSERT(InTexture(e, mip));
+            const Mips& m = m_mips[mip];
+
+            // Nodes of pyramid level l span 2^(l+1) texels, pick the first level where the rectangle touches two nodes or less
+            // per axis. The top level is a single node, so the search ends there at the latest.
+            uint32_t shift = 1;
+            while ((e.x >> shift) - (s.x >> shift) > 1 || (e.y >> shift) - (s.y >> shift) > 1)
+                ++shift;
+            OMM_ASSERT(shift <= m.minMaxLevelCount);
+
+            const float2* level = m_minMax.data() + m.minMaxLevelOffset[shift - 1];
+            const int width = ((m.size.x - 1) >> shift) + 1;
+            const int2 ns = s >> shift;
+            const int2 ne = e >> shift;
+
+            const float2 n0 = level[ns.x + ns.y * width];
+            const float2 n1 = level[ne.x + ns.y * width];
+            const float2 n2 = level[ns.x + ne.y * width];
+            const float2 n3 = level[ne.x + ne.y * width];
+            return float2(std::min(std::min(n0.x, n1.x), std::min(n2.x, n3.x)), std::max(std::max(n0.y, n1.y), std::max(n2.y, n3.y)));
+        }
+
+        // Exact comparison of the texels [s, e] of the mip with alphaCutoff, using the min/max pyramid. Returns 1 when all
+        // texels are above alphaCutoff, -1 when all are less or equal and 0 when the rectangle has texels on both sides.
+        // Gives the same answer as the SAT of a texture created with alphaCutoff, at the cost of descending the pyramid
+        // along the edges of the rectangle when the covering nodes straddle the cutoff.
+        int32_t CompareRange(int2 s, int2 e, int32_t mip, float alphaCutoff) const;
+
+        // Hash of the texel values, size and format of all mips, independent of the tiling mode. Computed on first use.
+        uint64_t GetContentHash() const;
+
+        bool IsBorrowed() const {
+            return ((uint32_t)m_textureFlags & (uint32_t)ommCpuTextureFlags_BorrowTextureData) != 0;
+        }
+
+        bool IsThreadingEnabled() const {
+            return ((uint32_t)m_textureFlags & (uint32_t)ommCpuTextureFlags_EnableInternalThreads) != 0;
+        }
+
+        bool HasTriangleCache() const {
+            return ((uint32_t)m_textureFlags & (uint32_t)ommCpuTextureFlags_EnableTriangleCache) != 0;
+        }
+
+        // Triangle cache (see ommCpuTextureFlags_EnableTriangleCache), a thread safe store of data words keyed by key words.
+        // Copies the data stored under key to data and returns true when present.
+        bool LoadTriangleCache(const uint64_t* key, size_t keySize, uint64_t* data, size_t dataSize) const;
+        void StoreTriangleCache(const uint64_t* key, size_t keySize, const uint64_t* data, size_t dataSize) const;
+
         template<class TMemoryStreamBuf>
         void Serialize(TMemoryStreamBuf& buffer) const;
 
         template<class TMemoryStreamBuf>
-        void Deserialize(TMemoryStreamBuf& buffer, int inputDescVersion);
+        void Deserialize(TMemoryStreamBuf& buffer, int inputDescVersion, const parallel::Scheduler& scheduler);
 
     private:
 
         ommResult Validate(const ommCpuTextureDesc& desc) const;
+        void BuildMinMaxPyramid(const parallel::Scheduler& scheduler);
+        template<ommCpuTextureFormat eFormat, TilingMode eTilingMode>
+        void BuildSATRows(int32_t mip, uint32_t rowBegin, uint32_t rowEnd);
         void Deallocate();
+        // Bytes per row of texels, or per row of blocks for block compressed formats, and the number of those rows.
+        static size_t GetRowSize(ommCpuTextureFormat format, int32_t width);
+        static int32_t GetRowCount(ommCpuTextureFormat format, int32_t height);
+        // Tags the decoded blocks of the texture in the per-thread block cache.
+        static uint64_t NextBlockCacheOwner();
+        // Address of a texel in the texel data of the mip, which may be borrowed from the caller.
+        template<ommCpuTextureFormat eFormat, TilingMode eTilingMode>
+        const uint8_t* GetTexel(const int2& texCoord, int32_t mip) const
+        {
+            constexpr size_t kSizePerPixel = eFormat == ommCpuTextureFormat_FP32 ? sizeof(float) : sizeof(uint8_t);
+            if constexpr (eTilingMode == TilingMode::Linear)
+            {
+                return m_mips[mip].data + size_t(texCoord.y) * m_mips[mip].rowPitch + size_t(texCoord.x) * kSizePerPixel;
+            }
+            else
+            {
+                const uint64_t idx = From2Dto1D<eTilingMode>(texCoord, m_mips[mip].size);
+                OMM_ASSERT(idx < m_mips[mip].numElements);
+                return m_mips[mip].data + idx * kSizePerPixel;
+            }
+        }
+
         template<TilingMode eTilingMode>
         static uint32_t From2Dto1D(const int2& idx, const int2& size) {
             OMM_ASSERT(false && "Not implemented");
@@ -147,6 +248,12 @@ namespace omm
     private:
         static inline uint2  kMaxDim = int2(65536);
         static constexpr size_t kAlignment = 64;
+        static constexpr uint32_t kMaxMinMaxLevels = 17;
+        // Tiles of TilingMode::Tiled are 8x8 texels, a UNORM8 tile is a cache line.
+        static constexpr int kTileSizeLog2 = kTexelTileSizeLog2;
+        static constexpr int kTileSize = kTexelTileSize;
+        // Mips with fewer texels are built on the calling thread even with ommCpuTextureFlags_EnableInternalThreads.
+        static constexpr size_t kMinParallelTexels = 1 << 16;
 
         StdAllocator<uint8_t> m_stdAllocator;
         const Logger& m_log;
@@ -160,8 +267,14 @@ namespace omm
             float2 rcpSize;
             int2 sizeMinusOne;
             uintptr_t dataOffset;
+            // Texel data of the mip, inside m_data or in the caller's memory when borrowed. rowPitch is in bytes, linear
+            // tiling only.
+            const uint8_t* data;
+            size_t rowPitch;
             size_t numElements;
             uintptr_t dataOffsetSAT;
+            uint32_t minMaxLevelCount;
+            size_t minMaxLevelOffset[kMaxMinMaxLevels];
         };
 
         vector<Mips> m_mips;
@@ -169,10 +282,18 @@ namespace omm
         ommCpuTextureFormat m_textureFormat;
         ommCpuTextureFlags m_textureFlags;
         float m_alphaCutoff;
+        uint64_t m_blockCacheOwner;
         uint8_t* m_data;
         size_t m_dataSize;
         uint8_t* m_dataSAT;
         size_t m_dataSATSize;
+        // Min/max pyramids of the mips, level 0 holds the alpha range of 2x2 texel blocks.
+        vector<float2> m_minMax;
+        mutable std::once_flag m_contentHashOnce;
+        mutable uint64_t m_contentHash;
+        // Entries hold the key words followed by the data words, lookups compare the key words to rule out hash collisions.
+        mutable std::shared_mutex m_triangleCacheMutex;
+        mutable hash_map<uint64_t, vector<uint64_t>> m_triangleCache;
     };
 
     template<ommCpuTextureFormat eFormat, TilingMode eTilingMode>
@@ -187,13 +308,25 @@ namespace omm
         OMM_ASSERT(texCoord.y < m_mips[mip].size.y);
         OMM_ASSERT(glm::all(glm::notEqual(texCoord, kTexCoordBorder2)));
         OMM_ASSERT(glm::all(glm::notEqual(texCoord, kTexCoordInvalid2)));
-        const uint64_t idx = From2Dto1D<eTilingMode>(texCoord, m_mips[mip].size);
-        OMM_ASSERT(idx < m_mips[mip].numElements);
 
         if constexpr (eFormat == ommCpuTextureFormat_FP32)
-            return ((float*)(m_data + m_mips[mip].dataOffset))[idx];
+            return *(const float*)GetTexel<eFormat, eTilingMode>(texCoord, mip);
         else if constexpr (eFormat == ommCpuTextureFormat_UNORM8)
-            return (float)((uint8_t*)(m_data + m_mips[mip].dataOffset))[idx] * (1.f / 255.f);
+            return (float)*GetTexel<eFormat, eTilingMode>(texCoord, mip) * (1.f / 255.f);
+        else if constexpr (eFormat == ommCpuTextureFormat_BC4_UNORM || eFormat == ommCpuTextureFormat_BC3_UNORM)
+        {
+            // The alpha block comes first in BC3 blocks and has the layout of a BC4 block.
+            static_assert(eTilingMode == TilingMode::Linear);
+            constexpr size_t kBlockSize = eFormat == ommCpuTextureFormat_BC4_UNORM ? 8 : 16;
+            const uint8_t* block = m_mips[mip].data + size_t(texCoord.y / kBlockDim) * m_mips[mip].rowPitch + size_t(texCoord.x / kBlockDim) * kBlockSize;
+            return DecodeBC4BlockCached(m_blockCacheOwner, block)[(texCoord.y % kBlockDim) * kBlockDim + texCoord.x % kBlockDim];
+        }
+        else if constexpr (eFormat == ommCpuTextureFormat_R1_UNORM)
+        {
+            static_assert(eTilingMode == TilingMode::Linear);
+            const uint8_t* row = m_mips[mip].data + size_t(texCoord.y) * m_mips[mip].rowPitch;
+            return (float)((row[texCoord.x >> 3] >> (texCoord.x & 7)) & 1);
+        }
         else
         {
             assert(false);
@@ -202,6 +335,75 @@ namespace omm
     }
 
 
+    template<ommCpuTextureFormat eFormat, TilingMode eTilingMode>
+    void TextureImpl::CompareSpan(const int2& texCoord, uint32_t count, int32_t mip, float alphaCutoff, uint64_t& above, uint64_t& below) const
+    {
+        OMM_ASSERT(eTilingMode == m_tilingMode);
+        OMM_ASSERT(eFormat == m_textureFormat);
+        OMM_ASSERT(count <= 64);
+        OMM_ASSERT(texCoord.x >= 0 && texCoord.x + (int)count <= m_mips[mip].size.x);
+        OMM_ASSERT(texCoord.y >= 0 && texCoord.y < m_mips[mip].size.y);
+
+        above = 0;
+        below = 0;
+        uint32_t i = 0;
+
+        if constexpr (eTilingMode == TilingMode::Linear && (eFormat == ommCpuTextureFormat_FP32 || eFormat == ommCpuTextureFormat_UNORM8))
+        {
+            // The row is contiguous, compare 4 texels per instruction. The UNORM8 conversion matches the one in Load.
+            const uint8_t* row = GetTexel<eFormat, eTilingMode>(texCoord, mip);
+#if OMM_SIMD_X86
+            const __m128 cutoff = _mm_set1_ps(alphaCutoff);
+            for (; i + 4 <= count; i += 4)
+            {
+                __m128 alpha;
+                if constexpr (eFormat == ommCpuTextureFormat_FP32)
+                {
+                    alpha = _mm_loadu_ps((const float*)row + i);
+                }
+                else
+                {
+                    int32_t packed;
+                    memcpy(&packed, row + i, sizeof(packed));
+                    const __m128i zero = _mm_setzero_si128();
+                    const __m128i texels = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+                    alpha = _mm_mul_ps(_mm_cvtepi32_ps(texels), _mm_set1_ps(1.f / 255.f));
+                }
+                above |= (uint64_t)_mm_movemask_ps(_mm_cmplt_ps(cutoff, alpha)) << i;
+                below |= (uint64_t)_mm_movemask_ps(_mm_cmplt_ps(alpha, cutoff)) << i;
+            }
+#elif OMM_SIMD_NEON
+            static const uint32_t kLaneBits[4] = { 1, 2, 4, 8 };
+            const uint32x4_t laneBits = vld1q_u32(kLaneBits);
+            const float32x4_t cutoff = vdupq_n_f32(alphaCutoff);
+            for (; i + 4 <= count; i += 4)
+            {
+                float32x4_t alpha;
+                if constexpr (eFormat == ommCpuTextureFormat_FP32)
+                {
+                    alpha = vld1q_f32((const float*)row + i);
+                }
+                else
+                {
+                    uint32_t packed;
+                    memcpy(&packed, row + i, sizeof(packed));
+                    const uint32x4_t texels = vmovl_u16(vget_low_u16(vmovl_u8(vcreate_u8(packed))));
+                    alpha = vmulq_f32(vcvtq_f32_u32(texels), vdupq_n_f32(1.f / 255.f));
+                }
+                above |= (uint64_t)vaddvq_u32(vandq_u32(vcltq_f32(cutoff, alpha), laneBits)) << i;
+                below |= (uint64_t)vaddvq_u32(vandq_u32(vcltq_f32(alpha, cutoff), laneBits)) << i;
+            }
+#endif
+        }
+
+        for (; i < count; ++i)
+        {
+            const float alpha = Load<eFormat, eTilingMode>(texCoord + int2(i, 0), mip);
+            above |= (uint64_t)(alphaCutoff < alpha) << i;
+            below |= (uint64_t)(alpha < alphaCutoff) << i;
+        }
+    }
+
     template<ommCpuTextureFormat eFormat, TilingMode eTilingMode, ommTextureAddressMode eMode, bool bTexIsPow2>
     float TextureImpl::Bilinear(const float2& p, int32_t mip) const
     {
@@ -224,9 +426,11 @@ namespace omm
 
    	template<> uint32_t TextureImpl::From2Dto1D<TilingMode::Linear>(const int2& idx, const int2& size);
    	template<> uint32_t TextureImpl::From2Dto1D<TilingMode::MortonZ>(const int2& idx, const int2& size);
+   	template<> uint32_t TextureImpl::From2Dto1D<TilingMode::Tiled>(const int2& idx, const int2& size);
 
     template<> uint2 TextureImpl::From1Dto2D<TilingMode::Linear>(const uint32_t idx, const int2& size);
     template<> uint2 TextureImpl::From1Dto2D<TilingMode::MortonZ>(const uint32_t idx, const int2& size);
+    template<> uint2 TextureImpl::From1Dto2D<TilingMode::Tiled>(const uint32_t idx, const int2& size);
 
 
     template<class TMemoryStreamBuf>
@@ -234,6 +438,11 @@ namespace omm
     {
         std::ostream os(&buffer);
 
+        // Borrowed texels are written out packed, the deserialized texture owns its copy of them.
+        const bool isBorrowed = IsBorrowed();
+        const ommCpuTextureFlags textureFlags = (ommCpuTextureFlags)((uint32_t)m_textureFlags & ~(uint32_t)ommCpuTextureFlags_BorrowTextureData);
+        size_t dataSize = isBorrowed ? 0 : m_dataSize;
+
         int numMips = (int)m_mips.size();
         os.write(reinterpret_cast<const char*>(&numMips), sizeof(numMips));
 
@@ -241,23 +450,49 @@ namespace omm
         {
             for (const auto& mip : m_mips)
             {
+                uintptr_t dataOffset = mip.dataOffset;
+                if (isBorrowed)
+                {
+                    dataOffset = dataSize;
+                    dataSize = math::Align(dataSize + GetRowSize(m_textureFormat, mip.size.x) * GetRowCount(m_textureFormat, mip.size.y), kAlignment);
+                }
+
                 os.write(reinterpret_cast<const char*>(&mip.size.x), sizeof(mip.size.x));
                 os.write(reinterpret_cast<const char*>(&mip.size.y), sizeof(mip.size.y));
                 os.write(reinterpret_cast<const char*>(&mip.rcpSize.x), sizeof(mip.rcpSize.x));
                 os.write(reinterpret_cast<const char*>(&mip.rcpSize.y), sizeof(mip.rcpSize.y));
-                os.write(reinterpret_cast<const char*>(&mip.dataOffset), sizeof(mip.dataOffset));
+                os.write(reinterpret_cast<const char*>(&dataOffset), sizeof(dataOffset));
                 os.write(reinterpret_cast<const char*>(&mip.numElements), sizeof(mip.numElements));
                 os.write(reinterpret_cast<const char*>(&mip.dataOffsetSAT), sizeof(mip.dataOffsetSAT));
             }
         }
 
         os.write(reinterpret_cast<const char*>(&m_tilingMode), sizeof(m_tilingMode));
-        os.write(reinterpret_cast<const char*>(&m_textureFlags), sizeof(m_textureFlags));
+        os.write(reinterpret_cast<const char*>(&textureFlags), sizeof(textureFlags));
         os.write(reinterpret_cast<const char*>(&m_alphaCutoff), sizeof(m_alphaCutoff));
         os.write(reinterpret_cast<const char*>(&m_textureFormat), sizeof(m_textureFormat));
 
-        os.write(reinterpret_cast<const char*>(&m_dataSize), sizeof(m_dataSize));
-        os.write(reinterpret_cast<const char*>(m_data), m_dataSize);
+        os.write(reinterpret_cast<const char*>(&dataSize), sizeof(dataSize));
+        if (isBorrowed)
+        {
+            const char padding[kAlignment] = {};
+            size_t written = 0;
+            for (const auto& mip : m_mips)
+            {
+                const size_t rowSize = GetRowSize(m_textureFormat, mip.size.x);
+                const int32_t rowCount = GetRowCount(m_textureFormat, mip.size.y);
+                for (int j = 0; j < rowCount; ++j)
+                    os.write(reinterpret_cast<const char*>(mip.data + j * mip.rowPitch), rowSize);
+                written += rowSize * rowCount;
+                const size_t aligned = math::Align(written, kAlignment);
+                os.write(padding, aligned - written);
+                written = aligned;
+            }
+        }
+        else
+        {
+            os.write(reinterpret_cast<const char*>(m_data), m_dataSize);
+        }
 
         os.write(reinterpret_cast<const char*>(&m_dataSATSize), sizeof(m_dataSATSize));
         if (m_dataSATSize != 0)
@@ -267,7 +502,7 @@ namespace omm
     }
 
     template<class TMemoryStreamBuf>
-    void TextureImpl::Deserialize(TMemoryStreamBuf& buffer, int inputDescVersion)
+    void TextureImpl::Deserialize(TMemoryStreamBuf& buffer, int inputDescVersion, const parallel::Scheduler& scheduler)
     {
         OMM_ASSERT(m_data == nullptr);
         OMM_ASSERT(m_dataSize == 0);
@@ -297,6 +532,7 @@ namespace omm
                 mip.sizeLog2.y = ctz(mip.size.y);
                 mip.sizef = (float2)mip.size;
                 mip.sizeIsPow2 = isPow2(mip.size.x) && isPow2(mip.size.y);
+                mip.sizeMinusOne = mip.size - 1;
             }
         }
 
@@ -326,6 +562,12 @@ namespace omm
         os.read(reinterpret_cast<char*>(&m_dataSize), sizeof(m_dataSize));
         m_data = m_stdAllocator.allocate(m_dataSize, kAlignment);
         os.read(reinterpret_cast<char*>(m_data), m_dataSize);
+        m_blockCacheOwner = NextBlockCacheOwner();
+        for (auto& mip : m_mips)
+        {
+            mip.data = m_data + mip.dataOffset;
+            mip.rowPitch = GetRowSize(m_textureFormat, mip.size.x);
+        }
 
         os.read(reinterpret_cast<char*>(&m_dataSATSize), sizeof(m_dataSATSize));
         if (m_dataSATSize != 0)
@@ -333,5 +575,9 @@ namespace omm
             m_dataSAT = m_stdAllocator.allocate(m_dataSATSize, kAlignment);
             os.read(reinterpret_cast<char*>(m_dataSAT), m_dataSATSize);
         }
+
+        // The pyramid is not part of the serialized texture, it's rebuilt from the texels.
+        if (((uint32_t)m_textureFlags & (uint32_t)ommCpuTextureFlags_EnableMinMaxPyramid) != 0)
+            BuildMinMaxPyramid(scheduler);
     }
 }
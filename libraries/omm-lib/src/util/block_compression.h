@@ -0,0 +1,75 @@
+/*
+Copyright (c) 2026, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace omm
+{
+    static constexpr int kBlockDim = 4;
+    static constexpr int kBlockTexels = kBlockDim * kBlockDim;
+
+    // Decodes the 4x4 values of a BC4 UNORM block, BC3 stores its alpha channel in the same 8 byte layout. Texels are in row
+    // major order.
+    inline void DecodeBC4Block(const uint8_t* block, float alpha[kBlockTexels])
+    {
+        const float a0 = block[0] * (1.f / 255.f);
+        const float a1 = block[1] * (1.f / 255.f);
+
+        float palette[8];
+        palette[0] = a0;
+        palette[1] = a1;
+        if (block[0] > block[1])
+        {
+            for (int i = 1; i < 7; ++i)
+                palette[i + 1] = ((7 - i) * a0 + i * a1) * (1.f / 7.f);
+        }
+        else
+        {
+            for (int i = 1; i < 5; ++i)
+                palette[i + 1] = ((5 - i) * a0 + i * a1) * (1.f / 5.f);
+            palette[6] = 0.f;
+            palette[7] = 1.f;
+        }
+
+        uint64_t indices = 0;
+        for (int i = 0; i < 6; ++i)
+            indices |= uint64_t(block[2 + i]) << (8 * i);
+
+        for (int i = 0; i < kBlockTexels; ++i)
+            alpha[i] = palette[(indices >> (3 * i)) & 7];
+    }
+
+    // Decoded blocks of the calling thread. Neighbouring texel fetches mostly land in the same block, so each block is decoded
+    // once per visit instead of once per texel. Entries are tagged with the owner, a block address alone may be reused by
+    // another texture once its owner is destroyed.
+    inline const float* DecodeBC4BlockCached(uint64_t owner, const uint8_t* block)
+    {
+        struct Entry
+        {
+            uint64_t owner = 0;
+            const uint8_t* block = nullptr;
+            float alpha[kBlockTexels];
+        };
+        static constexpr uint32_t kEntryCountLog2 = 6;
+        thread_local Entry entries[1u << kEntryCountLog2];
+
+        const uint64_t key = uint64_t((uintptr_t)block >> 3) * 0x9E3779B97F4A7C15ull;
+        Entry& entry = entries[key >> (64 - kEntryCountLog2)];
+        if (entry.block != block || entry.owner != owner)
+        {
+            DecodeBC4Block(block, entry.alpha);
+            entry.owner = owner;
+            entry.block = block;
+        }
+        return entry.alpha;
+    }
+}
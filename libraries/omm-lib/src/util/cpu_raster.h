@@ -12,6 +12,11 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 
 #include "math.h"
 #include "geometry.h"
+#include "simd.h"
+
+#include <bit>
+#include <cfloat>
+#include <type_traits>
 
 namespace omm
 {
@@ -135,6 +140,340 @@ namespace omm
         }
     };
 
+    namespace raster
+    {
+        // Instruction set used by the over-conservative rasterizer to evaluate the edge functions of several pixels at once.
+        enum class SimdLevel {
+            Scalar,     //< One pixel at a time.
+            SSE,        //< 4 pixels, x86-64 baseline.
+            NEON,       //< 4 pixels, AArch64 baseline.
+            AVX2,       //< 8 pixels.
+            AVX512,     //< 16 pixels.
+        };
+
+        inline SimdLevel DetectSimdLevel()
+        {
+#if OMM_SIMD_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+            int info[4];
+            __cpuid(info, 0);
+            const int maxLeaf = info[0];
+            __cpuid(info, 1);
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            const bool avx = (info[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx || maxLeaf < 7)
+                return SimdLevel::SSE;
+
+            // The OS must save the YMM (and for AVX-512 the ZMM and opmask) state on context switches.
+            const unsigned long long xcr0 = _xgetbv(0);
+            if ((xcr0 & 0x6) != 0x6)
+                return SimdLevel::SSE;
+
+            __cpuidex(info, 7, 0);
+            const bool avx2 = (info[1] & (1 << 5)) != 0;
+            const bool avx512f = (info[1] & (1 << 16)) != 0;
+            if (avx512f && (xcr0 & 0xE6) == 0xE6)
+                return SimdLevel::AVX512;
+            if (avx2)
+                return SimdLevel::AVX2;
+            return SimdLevel::SSE;
+#else
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f"))
+                return SimdLevel::AVX512;
+            if (__builtin_cpu_supports("avx2"))
+                return SimdLevel::AVX2;
+            return SimdLevel::SSE;
+#endif
+#elif OMM_SIMD_NEON
+            return SimdLevel::NEON;
+#else
+            return SimdLevel::Scalar;
+#endif
+        }
+
+        // Widest instruction set supported by both the build and the running CPU. Detected once.
+        inline SimdLevel GetSimdLevel()
+        {
+            static const SimdLevel level = DetectSimdLevel();
+            return level;
+        }
+
+        // Kernels may return bool, false stops the rasterization of the triangle. Kernels returning void never stop it.
+        template<typename F, typename... TArgs>
+        inline bool InvokeKernel(F& f, TArgs&&... args)
+        {
+            if constexpr (std::is_same_v<std::invoke_result_t<F&, TArgs...>, bool>)
+            {
+                return f(std::forward<TArgs>(args)...);
+            }
+            else
+            {
+                f(std::forward<TArgs>(args)...);
+                return true;
+            }
+        }
+
+        // Edge functions of a CCW triangle in the form consumed by the row kernels, with the over-conservative
+        // extension for a 1x1 pixel split in to its x and y terms.
+        struct ConservativeEdges {
+            float nx[3];
+            float ny[3];
+            float c[3];
+            float bx[3];
+            float by[3];
+
+            ConservativeEdges(const StatelessRasterizer& r)
+            {
+                const StatelessRasterizer::EdgeFn* edges[3] = { &r._e0, &r._e1, &r._e2 };
+                for (uint32_t i = 0; i < 3; ++i)
+                {
+                    nx[i] = edges[i]->N.x;
+                    ny[i] = edges[i]->N.y;
+                    c[i] = edges[i]->C;
+                    bx[i] = edges[i]->N.x > 0 ? 0.f : edges[i]->N.x;
+                    by[i] = edges[i]->N.y > 0 ? 0.f : edges[i]->N.y;
+                }
+            }
+
+            // Over-conservative test of the w x h tile at (x, y). Returns true only when the tile is outside one of the
+            // edges by more than the rounding error of the edge evaluation, so no pixel of the tile can pass the
+            // per-pixel test either.
+            inline bool TileOutside(float x, float y, float w, float h) const
+            {
+                static constexpr float kTolerance = 16.f * FLT_EPSILON;
+                for (uint32_t i = 0; i < 3; ++i)
+                {
+                    const float e = ((nx[i] * x + ny[i] * y) + c[i]) + bx[i] * w + by[i] * h;
+                    const float bound = (std::abs(nx[i]) * (std::abs(x) + w) + std::abs(ny[i]) * (std::abs(y) + h) + std::abs(c[i])) * kTolerance;
+                    if (e > bound)
+                        return true;
+                }
+                return false;
+            }
+        };
+
+        // The row kernels return a bitmask of the pixels [x, x + kWidth) on row y that pass the over-conservative test.
+        // Every lane performs the same operations in the same order as StatelessRasterizer::SquareInTriangleSkipAABBTest,
+        // so all instruction sets produce bit-identical coverage.
+
+        struct RowKernelScalar {
+            static constexpr int kWidth = 4;
+
+            static inline uint32_t Eval(const ConservativeEdges& e, float y, int x)
+            {
+                uint32_t mask = 0;
+                for (int lane = 0; lane < kWidth; ++lane)
+                {
+                    const float xf = float(x + lane);
+                    bool inside = true;
+                    for (uint32_t i = 0; i < 3; ++i)
+                        inside &= (((e.nx[i] * xf + e.ny[i] * y) + e.c[i]) + e.bx[i]) + e.by[i] < 0.f;
+                    mask |= uint32_t(inside) << lane;
+                }
+                return mask;
+            }
+        };
+
+#if OMM_SIMD_X86
+        struct RowKernelSSE {
+            static constexpr int kWidth = 4;
+
+            static inline uint32_t Eval(const ConservativeEdges& e, float y, int x)
+            {
+                const __m128 xs = _mm_add_ps(_mm_set1_ps((float)x), _mm_setr_ps(0.f, 1.f, 2.f, 3.f));
+                const __m128 zero = _mm_setzero_ps();
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (uint32_t i = 0; i < 3; ++i)
+                {
+                    __m128 v = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e.nx[i]), xs), _mm_set1_ps(e.ny[i] * y));
+                    v = _mm_add_ps(v, _mm_set1_ps(e.c[i]));
+                    v = _mm_add_ps(v, _mm_set1_ps(e.bx[i]));
+                    v = _mm_add_ps(v, _mm_set1_ps(e.by[i]));
+                    inside = _mm_and_ps(inside, _mm_cmplt_ps(v, zero));
+                }
+                return (uint32_t)_mm_movemask_ps(inside);
+            }
+        };
+
+        OMM_SIMD_TARGET("avx2")
+        inline uint32_t EvalRowAVX2(const ConservativeEdges& e, float y, int x)
+        {
+            const __m256 xs = _mm256_add_ps(_mm256_set1_ps((float)x), _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f));
+            const __m256 zero = _mm256_setzero_ps();
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (uint32_t i = 0; i < 3; ++i)
+            {
+                __m256 v = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(e.nx[i]), xs), _mm256_set1_ps(e.ny[i] * y));
+                v = _mm256_add_ps(v, _mm256_set1_ps(e.c[i]));
+                v = _mm256_add_ps(v, _mm256_set1_ps(e.bx[i]));
+                v = _mm256_add_ps(v, _mm256_set1_ps(e.by[i]));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(v, zero, _CMP_LT_OQ));
+            }
+            return (uint32_t)_mm256_movemask_ps(inside);
+        }
+
+        struct RowKernelAVX2 {
+            static constexpr int kWidth = 8;
+
+            static inline uint32_t Eval(const ConservativeEdges& e, float y, int x)
+            {
+                return EvalRowAVX2(e, y, x);
+            }
+        };
+
+        OMM_SIMD_TARGET("avx512f")
+        inline uint32_t EvalRowAVX512(const ConservativeEdges& e, float y, int x)
+        {
+            const __m512 xs = _mm512_add_ps(_mm512_set1_ps((float)x), _mm512_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f, 8.f, 9.f, 10.f, 11.f, 12.f, 13.f, 14.f, 15.f));
+            const __m512 zero = _mm512_setzero_ps();
+            __mmask16 inside = 0xFFFF;
+            for (uint32_t i = 0; i < 3; ++i)
+            {
+                __m512 v = _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(e.nx[i]), xs), _mm512_set1_ps(e.ny[i] * y));
+                v = _mm512_add_ps(v, _mm512_set1_ps(e.c[i]));
+                v = _mm512_add_ps(v, _mm512_set1_ps(e.bx[i]));
+                v = _mm512_add_ps(v, _mm512_set1_ps(e.by[i]));
+                inside &= _mm512_cmp_ps_mask(v, zero, _CMP_LT_OQ);
+            }
+            return (uint32_t)inside;
+        }
+
+        struct RowKernelAVX512 {
+            static constexpr int kWidth = 16;
+
+            static inline uint32_t Eval(const ConservativeEdges& e, float y, int x)
+            {
+                return EvalRowAVX512(e, y, x);
+            }
+        };
+#endif
+
+#if OMM_SIMD_NEON
+        struct RowKernelNEON {
+            static constexpr int kWidth = 4;
+
+            static inline uint32_t Eval(const ConservativeEdges& e, float y, int x)
+            {
+                static const float kLanes[4] = { 0.f, 1.f, 2.f, 3.f };
+                static const uint32_t kLaneBits[4] = { 1, 2, 4, 8 };
+                const float32x4_t xs = vaddq_f32(vdupq_n_f32((float)x), vld1q_f32(kLanes));
+                const float32x4_t zero = vdupq_n_f32(0.f);
+                uint32x4_t inside = vdupq_n_u32(0xFFFFFFFF);
+                for (uint32_t i = 0; i < 3; ++i)
+                {
+                    float32x4_t v = vaddq_f32(vmulq_f32(vdupq_n_f32(e.nx[i]), xs), vdupq_n_f32(e.ny[i] * y));
+                    v = vaddq_f32(v, vdupq_n_f32(e.c[i]));
+                    v = vaddq_f32(v, vdupq_n_f32(e.bx[i]));
+                    v = vaddq_f32(v, vdupq_n_f32(e.by[i]));
+                    inside = vandq_u32(inside, vcltq_f32(v, zero));
+                }
+                return vaddvq_u32(vandq_u32(inside, vld1q_u32(kLaneBits)));
+            }
+        };
+#endif
+
+        // Over-conservative traversal of the pixels [min, max) of the CCW triangle behind e, kWidth pixels per step.
+        // Rows are processed in bands of kBandHeight, each band is first trimmed from both sides by coarse rejection of
+        // kWidth x kBandHeight tiles. The covered segment of every row is passed to emitSpan(x, y, count), in the same
+        // order and with the same early-out per row as the scalar traversal. Traversal stops when emitSpan returns false.
+        template<class TRowKernel, typename TEmitSpan>
+        inline void RasterizeConservativeRows(const ConservativeEdges& e, const int2& min, const int2& max, TEmitSpan&& emitSpan)
+        {
+            static constexpr int kWidth = TRowKernel::kWidth;
+            static constexpr int kBandHeight = 4;
+
+            const int chunkCount = (max.x - min.x + kWidth - 1) / kWidth;
+            const bool enableCoarse = chunkCount > 1 || max.y - min.y > kBandHeight;
+
+            for (int bandY = min.y; bandY < max.y; bandY += kBandHeight)
+            {
+                const int bandHeight = std::min(kBandHeight, max.y - bandY);
+
+                int chunkBegin = 0;
+                int chunkEnd = chunkCount;
+                if (enableCoarse)
+                {
+                    while (chunkBegin < chunkEnd && e.TileOutside(float(min.x + chunkBegin * kWidth), float(bandY), float(kWidth), float(bandHeight)))
+                        ++chunkBegin;
+                    while (chunkEnd > chunkBegin && e.TileOutside(float(min.x + (chunkEnd - 1) * kWidth), float(bandY), float(kWidth), float(bandHeight)))
+                        --chunkEnd;
+                }
+
+                for (int y = bandY; y < bandY + bandHeight; ++y)
+                {
+                    const float yf = float(y);
+                    int spanBegin = 0;
+                    int spanCount = 0;
+
+                    for (int chunkIt = chunkBegin; chunkIt < chunkEnd; ++chunkIt)
+                    {
+                        const int x0 = min.x + chunkIt * kWidth;
+                        const int count = std::min(kWidth, max.x - x0);
+                        const uint32_t mask = TRowKernel::Eval(e, yf, x0) & ((1u << count) - 1u);
+
+                        uint32_t first = 0;
+                        if (spanCount == 0)
+                        {
+                            if (mask == 0)
+                                continue;
+                            first = (uint32_t)std::countr_zero(mask);
+                            spanBegin = x0 + (int)first;
+                        }
+                        else if ((mask & 1u) == 0)
+                            break;
+
+                        const uint32_t run = (uint32_t)std::countr_one(mask >> first);
+                        spanCount += (int)run;
+
+                        if (first + run < (uint32_t)count)
+                            break;
+                    }
+
+                    if (spanCount != 0 && !emitSpan(spanBegin, y, spanCount))
+                        return;
+                }
+            }
+        }
+
+        // Runs RasterizeConservativeRows with the row kernel of simdLevel. Narrow rows don't fill the wider kernels and
+        // use the 4 wide one instead. Returns false when this build has no kernel for simdLevel.
+        template<typename TEmitSpan>
+        inline bool DispatchConservativeRows(SimdLevel simdLevel, const ConservativeEdges& e, const int2& min, const int2& max, TEmitSpan&& emitSpan)
+        {
+            const int width = max.x - min.x;
+            if (simdLevel == SimdLevel::AVX512 && width <= 8)
+                simdLevel = width <= 4 ? SimdLevel::SSE : SimdLevel::AVX2;
+            else if (simdLevel == SimdLevel::AVX2 && width <= 4)
+                simdLevel = SimdLevel::SSE;
+
+            switch (simdLevel)
+            {
+            case SimdLevel::Scalar:
+                RasterizeConservativeRows<RowKernelScalar>(e, min, max, emitSpan);
+                return true;
+#if OMM_SIMD_X86
+            case SimdLevel::SSE:
+                RasterizeConservativeRows<RowKernelSSE>(e, min, max, emitSpan);
+                return true;
+            case SimdLevel::AVX2:
+                RasterizeConservativeRows<RowKernelAVX2>(e, min, max, emitSpan);
+                return true;
+            case SimdLevel::AVX512:
+                RasterizeConservativeRows<RowKernelAVX512>(e, min, max, emitSpan);
+                return true;
+#endif
+#if OMM_SIMD_NEON
+            case SimdLevel::NEON:
+                RasterizeConservativeRows<RowKernelNEON>(e, min, max, emitSpan);
+                return true;
+#endif
+            default:
+                return false;
+            }
+        }
+    } // namespace raster
+
     // This rasterizer relies on less computation than the stateless rasterizer
     // Edge rasterizer: https://www.cs.drexel.edu/~david/Classes/Papers/comp175-06-pineda.pdf
     // Conservative rasterization extension : https://fileadmin.cs.lth.se/graphics/research/papers/2005/cr/_conservative.pdf
@@ -271,15 +610,16 @@ namespace omm
         FullyCovered,
     };
 
+    // simdLevel - the instruction set of the serial over-conservative path, the other modes always run scalar.
     // t - the triangle to rasterize
     // r - the pixel resolution to rasterize at.
     // f - the function callback, _should_ be inlined when using lambdas.
     template <RasterMode eRasterMode, bool EnableParallel, bool EnableBarycentrics, typename F>
-    inline void RasterizeTriImpl(const Triangle& _t, int2 r, const float2& offset, F f, void* context = nullptr) {
+    inline void RasterizeTriImpl(raster::SimdLevel simdLevel, const Triangle& _t, int2 r, const float2& offset, F f, void* context = nullptr) {
 
-        // Obvious optimizations this rasterizer does _not_ do:
-        // No coarse raster step - might be useful for large triangles,
-        // Tight triangle traversal, right now it searches row wise and terminates on first exit.
+        // The scalar path searches row wise and terminates on first exit, without a coarse raster step.
+        // The serial over-conservative path evaluates several pixels per instruction and trims each band of rows
+        // with a coarse tile test, see raster::RasterizeConservativeRows.
         
         // constexpr bool EnableBarycentrics = false;
 
@@ -303,14 +643,49 @@ namespace omm
 
         const StatelessRasterizer _tix(t);
 
+        if constexpr (eRasterMode == RasterMode::OverConservative && !EnableParallel)
+        {
+            auto emitSpan = [&](int x0, int y, int count) {
+                for (int x = x0; x < x0 + count; ++x)
+                {
+                    if constexpr (EnableBarycentrics)
+                    {
+                        const float2 s_c = (float2(x, y) + 0.5f);
+                        float3 bc = _tix.GetBarycentrics(s_c);
+                        if (!isCCW)
+                            bc = { bc.z, bc.y, bc.x };
+
+                        if (!raster::InvokeKernel(f, int2({ x, y }), &bc, context))
+                            return false;
+                    }
+                    else
+                    {
+                        if (!raster::InvokeKernel(f, int2({ x, y }), context))
+                            return false;
+                    }
+                }
+                return true;
+            };
+
+            // The scalar level keeps the per pixel traversal below.
+            if (simdLevel != raster::SimdLevel::Scalar && raster::DispatchConservativeRows(simdLevel, raster::ConservativeEdges(_tix), min, max, emitSpan))
+                return;
+        }
+
         const float2 pixelSize(1, 1);
 
-        #pragma omp parallel for if (EnableParallel)
+        // Set when a serial kernel asks to stop. Parallel rasterization ignores it.
+        bool stopped = false;
+
         for (int y = min.y; y < max.y; ++y) {
+            if (stopped)
+                break;
+
             bool wasInside = false;
 
             for (int x = min.x; x < max.x; ++x) {
                 int2 it = int2({ x, y });
+                bool proceed = true;
                 if constexpr (eRasterMode == RasterMode::OverConservative) {
                     const float2 s = float2(x, y);
 
@@ -323,13 +698,18 @@ namespace omm
                             if (!isCCW)
                                 bc = { bc.z, bc.y, bc.x };
 
-                            f(int2({ x, y }), &bc, context);
+                            proceed = raster::InvokeKernel(f, int2({ x, y }), &bc, context);
                         }
                         else
                         {
-                           f(int2({ x, y }), context);
+                           proceed = raster::InvokeKernel(f, int2({ x, y }), context);
                         }
                         wasInside = true;
+
+                        if (!EnableParallel && !proceed) {
+                            stopped = true;
+                            break;
+                        }
                     }
                     else if (wasInside)
                         break;
@@ -346,13 +726,18 @@ namespace omm
                             if (!isCCW)
                                 bc = { bc.z, bc.y, bc.x };
 
-                            f(int2({ x, y }), &bc, context);
+                            proceed = raster::InvokeKernel(f, int2({ x, y }), &bc, context);
                         }
                         else
                         {
-                            f(int2({ x, y }), context);
+                            proceed = raster::InvokeKernel(f, int2({ x, y }), context);
                         }
                         wasInside = true;
+
+                        if (!EnableParallel && !proceed) {
+                            stopped = true;
+                            break;
+                        }
                     }
                     else if (wasInside)
                         break;
@@ -367,13 +752,18 @@ namespace omm
                             float3 bc = _tix.GetBarycentrics(s);
                             if (!isCCW)
                                 bc = { bc.z, bc.y, bc.x };
-                            f(int2({ x, y }), &bc, context);
+                            proceed = raster::InvokeKernel(f, int2({ x, y }), &bc, context);
                         }
                         else
                         {
-                           f(int2({ x, y }), context);
+                           proceed = raster::InvokeKernel(f, int2({ x, y }), context);
                         }
                         wasInside = true;
+
+                        if (!EnableParallel && !proceed) {
+                            stopped = true;
+                            break;
+                        }
                     }
                     else if (wasInside)
                         break;
@@ -382,6 +772,37 @@ namespace omm
         }
     }
 
+    template <RasterMode eRasterMode, bool EnableParallel, bool EnableBarycentrics, typename F>
+    inline void RasterizeTriImpl(const Triangle& t, int2 r, const float2& offset, F f, void* context = nullptr) {
+        RasterizeTriImpl<eRasterMode, EnableParallel, EnableBarycentrics>(raster::GetSimdLevel(), t, r, offset, f, context);
+    }
+
+    // Over-conservative rasterization that passes each covered row segment to f(start, count, context) instead of
+    // calling f per pixel. The segments cover the same pixels as RasterizeConservativeSerialWithOffset, f returns false
+    // to stop the rasterization early.
+    template <typename F>
+    inline void RasterizeConservativeSpansImpl(raster::SimdLevel simdLevel, const Triangle& _t, int2 r, const float2& offset, F f, void* context = nullptr) {
+
+        OMM_ASSERT(!_t.GetIsDegenerate());
+
+        const float2 rf = float2(r);
+        // Rasterizer expects CCW triangles.
+        const Triangle t = _t.GetIsCCW() ? Triangle(_t.p0 * rf + offset, _t.p1 * rf + offset, _t.p2 * rf + offset)
+                                         : Triangle(_t.p2 * rf + offset, _t.p1 * rf + offset, _t.p0 * rf + offset);
+        OMM_ASSERT(t.GetIsCCW());
+
+        const int2 min = int2{ glm::floor(t.aabb_s) };
+        const int2 max = int2{ glm::ceil(t.aabb_e) };
+
+        const raster::ConservativeEdges edges{ StatelessRasterizer(t) };
+        auto emitSpan = [&f, context](int x, int y, int count) {
+            return f(int2({ x, y }), count, context);
+        };
+
+        if (!raster::DispatchConservativeRows(simdLevel, edges, min, max, emitSpan))
+            raster::DispatchConservativeRows(raster::SimdLevel::Scalar, edges, min, max, emitSpan);
+    }
+
     template <bool EnableParallel, bool EnableBarycentrics, typename F>
     inline void RasterizeLineImpl(const Line& _l, int2 r, const float2& offset, F f, void* context = nullptr)
     {
@@ -541,7 +962,8 @@ namespace omm
 
         while (x >= xMin && x <= xMax && y >= yMin && y <= yMax) 
         {
-            f(int2(x, y), context);
+            if (!raster::InvokeKernel(f, int2(x, y), context))
+                return;
 
             if (tMaxX < tMaxY) {
                 x += stepX;
@@ -566,6 +988,12 @@ namespace omm
     template <typename F>
     inline void RasterizeConservativeSerialWithOffsetCoverage(const Triangle& t, int2 r, float2 offset, F f, void* context = nullptr) { RasterizeTriImpl<RasterMode::OverConservative, false, false>(t, r, offset, f, context); };
 
+    template <typename F>
+    inline void RasterizeConservativeSpansSerial(const Triangle& t, int2 r, F f, void* context = nullptr) { RasterizeConservativeSpansImpl(raster::GetSimdLevel(), t, r, float2{ 0,0 }, f, context); };
+
+    template <typename F>
+    inline void RasterizeConservativeSpansSerialWithOffset(const Triangle& t, int2 r, float2 offset, F f, void* context = nullptr) { RasterizeConservativeSpansImpl(raster::GetSimdLevel(), t, r, offset, f, context); };
+
     template <typename F>
     inline void RasterizeConservativeParallel(const Triangle& t, int2 r, F f, void* context = nullptr) { RasterizeTriImpl<RasterMode::OverConservative, true, false>(t, r, float2{ 0,0 }, f, context); };
 
@@ -0,0 +1,96 @@
+/*
+Copyright (c) 2026, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include "parallel.h"
+#include "std_containers.h"
+
+#include <stdint.h>
+#include <algorithm>
+
+namespace omm
+{
+namespace dedup
+{
+    // Exact deduplication of items by digest. TItems provides
+    //   uint64_t GetDigest(uint32_t i) const, equal items must have equal digests,
+    //   bool IsEqual(uint32_t a, uint32_t b) const,
+    //   void Merge(uint32_t survivor, uint32_t i), merges item i in to the earlier equal item survivor.
+    // Of a set of equal items the one with the lowest index survives.
+
+    // Deduplicates items[indices[0..count)], indices in increasing order.
+    // A digest shared by items that aren't equal is probed forward to the next free key. The probe sequence only depends on
+    // the digest, so a later item with the same states walks past the same entries and finds the earlier one.
+    template<class TDigestMap, class TItems>
+    void DeduplicateExact(TDigestMap& digestToIndex, const uint32_t* indices, uint32_t count, TItems& items)
+    {
+        for (uint32_t indexIt = 0; indexIt < count; ++indexIt)
+        {
+            const uint32_t i = indices[indexIt];
+
+            uint64_t digest = items.GetDigest(i);
+            for (;;)
+            {
+                auto it = digestToIndex.find(digest);
+                if (it == digestToIndex.end())
+                {
+                    digestToIndex.insert(std::make_pair(digest, i));
+                    break;
+                }
+
+                if (items.IsEqual(it->second, i))
+                {
+                    items.Merge(it->second, i);
+                    break;
+                }
+
+                ++digest;
+            }
+        }
+    }
+
+    // Deduplicates items[indices[0..count)], indices in increasing order, split in to kShardCount shards by the top bits of
+    // the digest. Equal items share a digest and so a shard, the shards are deduplicated independently and in parallel.
+    // Merge is only called for items of the same shard at a time.
+    template<class TItems>
+    void DeduplicateExactSharded(const StdAllocator<uint8_t>& allocator, const parallel::Scheduler& scheduler, bool enableThreads, const uint32_t* indices, uint32_t count, TItems& items)
+    {
+        static constexpr uint32_t kShardCountLog2 = 6;
+        static constexpr uint32_t kShardCount = 1u << kShardCountLog2;
+        auto GetShard = [&items](uint32_t i) { return uint32_t(items.GetDigest(i) >> (64 - kShardCountLog2)); };
+
+        // Bucket the items by shard, keeping them in increasing order within a shard so the item that survives a merge is
+        // the same one a serial pass would keep.
+        uint32_t shardOffsets[kShardCount + 1] = { 0, };
+        for (uint32_t indexIt = 0; indexIt < count; ++indexIt)
+            shardOffsets[GetShard(indices[indexIt]) + 1]++;
+        for (uint32_t shardIt = 0; shardIt < kShardCount; ++shardIt)
+            shardOffsets[shardIt + 1] += shardOffsets[shardIt];
+
+        vector<uint32_t> shardIndices(count, allocator);
+        {
+            uint32_t shardCursors[kShardCount];
+            std::copy(shardOffsets, shardOffsets + kShardCount, shardCursors);
+            for (uint32_t indexIt = 0; indexIt < count; ++indexIt)
+                shardIndices[shardCursors[GetShard(indices[indexIt])]++] = indices[indexIt];
+        }
+
+        scheduler.ParallelFor(allocator, enableThreads, kShardCount, [&](uint32_t shardIt) {
+            const uint32_t begin = shardOffsets[shardIt];
+            const uint32_t shardCount = shardOffsets[shardIt + 1] - begin;
+
+            hash_map<uint64_t, uint32_t> digestToIndex(allocator.GetInterface());
+            digestToIndex.reserve(shardCount);
+            DeduplicateExact(digestToIndex, shardIndices.data() + begin, shardCount, items);
+        });
+    }
+} // namespace dedup
+} // namespace omm
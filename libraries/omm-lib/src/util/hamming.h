@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2026, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include "simd.h"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace omm
+{
+namespace hamming
+{
+    // Distances between arrays of 2-bit opacity states packed 32 to a 64-bit word. States are compared in their 3-state
+    // representation, UnknownTransparent (0b10) and UnknownOpaque (0b11) are equal. Unused trailing states must be zero.
+
+    static constexpr uint64_t kLowBitMask = 0x5555555555555555ull;
+
+    inline uint32_t CountDiff3StateScalar(const uint64_t* a, const uint64_t* b, size_t numWords)
+    {
+        uint32_t numDiff = 0;
+        for (size_t wordIt = 0; wordIt < numWords; ++wordIt)
+        {
+            const uint64_t a3 = a[wordIt] | ((a[wordIt] >> 1) & kLowBitMask);
+            const uint64_t b3 = b[wordIt] | ((b[wordIt] >> 1) & kLowBitMask);
+
+            // Any differing bit in a 2-bit state counts the state as different.
+            const uint64_t diff = a3 ^ b3;
+            numDiff += (uint32_t)std::popcount((diff | (diff >> 1)) & kLowBitMask);
+        }
+        return numDiff;
+    }
+
+#if OMM_SIMD_X86
+    // Four words at a time, the bytes are counted with a nibble lookup table and summed per lane with SAD.
+    OMM_SIMD_TARGET("avx2,popcnt")
+    inline uint32_t CountDiff3StateAVX2(const uint64_t* a, const uint64_t* b, size_t numWords)
+    {
+        const __m256i lowBits = _mm256_set1_epi64x((long long)kLowBitMask);
+        const __m256i lowNibbles = _mm256_set1_epi8(0x0F);
+        const __m256i nibbleCounts = _mm256_setr_epi8(
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+
+        __m256i sum = _mm256_setzero_si256();
+        size_t wordIt = 0;
+        for (; wordIt + 4 <= numWords; wordIt += 4)
+        {
+            const __m256i va = _mm256_loadu_si256((const __m256i*)(a + wordIt));
+            const __m256i vb = _mm256_loadu_si256((const __m256i*)(b + wordIt));
+            const __m256i a3 = _mm256_or_si256(va, _mm256_and_si256(_mm256_srli_epi64(va, 1), lowBits));
+            const __m256i b3 = _mm256_or_si256(vb, _mm256_and_si256(_mm256_srli_epi64(vb, 1), lowBits));
+            const __m256i diff = _mm256_xor_si256(a3, b3);
+            const __m256i mask = _mm256_and_si256(_mm256_or_si256(diff, _mm256_srli_epi64(diff, 1)), lowBits);
+
+            const __m256i lo = _mm256_and_si256(mask, lowNibbles);
+            const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(mask, 4), lowNibbles);
+            const __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(nibbleCounts, lo), _mm256_shuffle_epi8(nibbleCounts, hi));
+            sum = _mm256_add_epi64(sum, _mm256_sad_epu8(counts, _mm256_setzero_si256()));
+        }
+
+        const __m128i sum2 = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        uint64_t numDiff = (uint64_t)_mm_cvtsi128_si64(sum2) + (uint64_t)_mm_extract_epi64(sum2, 1);
+
+        for (; wordIt < numWords; ++wordIt)
+        {
+            const uint64_t a3 = a[wordIt] | ((a[wordIt] >> 1) & kLowBitMask);
+            const uint64_t b3 = b[wordIt] | ((b[wordIt] >> 1) & kLowBitMask);
+            const uint64_t diff = a3 ^ b3;
+            numDiff += (uint64_t)_mm_popcnt_u64((diff | (diff >> 1)) & kLowBitMask);
+        }
+        return (uint32_t)numDiff;
+    }
+#endif
+
+#if OMM_SIMD_NEON
+    inline uint32_t CountDiff3StateNEON(const uint64_t* a, const uint64_t* b, size_t numWords)
+    {
+        const uint64x2_t lowBits = vdupq_n_u64(kLowBitMask);
+
+        uint32_t numDiff = 0;
+        size_t wordIt = 0;
+        for (; wordIt + 2 <= numWords; wordIt += 2)
+        {
+            const uint64x2_t va = vld1q_u64(a + wordIt);
+            const uint64x2_t vb = vld1q_u64(b + wordIt);
+            const uint64x2_t a3 = vorrq_u64(va, vandq_u64(vshrq_n_u64(va, 1), lowBits));
+            const uint64x2_t b3 = vorrq_u64(vb, vandq_u64(vshrq_n_u64(vb, 1), lowBits));
+            const uint64x2_t diff = veorq_u64(a3, b3);
+            const uint64x2_t mask = vandq_u64(vorrq_u64(diff, vshrq_n_u64(diff, 1)), lowBits);
+            numDiff += vaddlvq_u8(vcntq_u8(vreinterpretq_u8_u64(mask)));
+        }
+
+        return numDiff + CountDiff3StateScalar(a + wordIt, b + wordIt, numWords - wordIt);
+    }
+#endif
+} // namespace hamming
+} // namespace omm
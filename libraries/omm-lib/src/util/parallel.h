@@ -0,0 +1,453 @@
+/*
+Copyright (c) 2026, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include "std_containers.h"
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace omm
+{
+namespace parallel
+{
+    // Threads kept alive between parallel regions. They are spawned on first use and joined when the pool is destroyed.
+    // Regions may be submitted concurrently and from inside other regions: the submitting thread always works on its own
+    // region, so it never waits on a region that no thread is working on.
+    class WorkerPool
+    {
+    public:
+        WorkerPool(const StdAllocator<uint8_t>& allocator, uint32_t threadCount) : m_threadCount(threadCount), m_threads(allocator) { }
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        ~WorkerPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_exit = true;
+            }
+            m_wake.notify_all();
+            for (std::thread& thread : m_threads)
+                thread.join();
+        }
+
+        uint32_t GetThreadCount() const
+        {
+            return m_threadCount;
+        }
+
+        // Runs drain() on the calling thread and on up to helperCount pool threads. drain must return once there is
+        // nothing left to claim. Returns when every thread that entered drain has left it.
+        template<class TFn>
+        void Run(uint32_t helperCount, TFn& drain)
+        {
+            Region region;
+            region.drain = &Invoke<TFn>;
+            region.arg = &drain;
+            region.helpersWanted = std::min(helperCount, m_threadCount);
+
+            const bool submitted = region.helpersWanted != 0;
+            if (submitted)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    if (m_threads.empty())
+                    {
+                        m_threads.reserve(m_threadCount);
+                        for (uint32_t threadIt = 0; threadIt < m_threadCount; ++threadIt)
+                            m_threads.emplace_back(&WorkerPool::WorkerLoop, this);
+                    }
+                    Push(&region);
+                }
+                m_wake.notify_all();
+            }
+
+            drain();
+
+            if (submitted)
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                // The work is claimed, helpers that haven't picked the region up yet would find nothing left.
+                Remove(&region);
+                m_done.wait(lock, [&region]() { return region.activeHelpers == 0; });
+            }
+        }
+
+    private:
+        struct Region
+        {
+            void (*drain)(void* arg) = nullptr;
+            void* arg = nullptr;
+            uint32_t helpersWanted = 0;
+            uint32_t activeHelpers = 0;
+            Region* next = nullptr;
+        };
+
+        template<class TFn>
+        static void Invoke(void* arg)
+        {
+            (*(TFn*)arg)();
+        }
+
+        void Push(Region* region)
+        {
+            Region** tail = &m_regions;
+            while (*tail != nullptr)
+                tail = &(*tail)->next;
+            *tail = region;
+        }
+
+        void Remove(Region* region)
+        {
+            for (Region** it = &m_regions; *it != nullptr; it = &(*it)->next)
+            {
+                if (*it == region)
+                {
+                    *it = region->next;
+                    region->next = nullptr;
+                    return;
+                }
+            }
+        }
+
+        void WorkerLoop()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            for (;;)
+            {
+                m_wake.wait(lock, [this]() { return m_exit || m_regions != nullptr; });
+                if (m_exit)
+                    return;
+
+                Region* region = m_regions;
+                region->activeHelpers++;
+                if (--region->helpersWanted == 0)
+                    Remove(region);
+
+                lock.unlock();
+                region->drain(region->arg);
+                lock.lock();
+
+                // The submitting thread may release the region as soon as the count drops to zero.
+                if (--region->activeHelpers == 0)
+                    m_done.notify_all();
+            }
+        }
+
+        const uint32_t m_threadCount;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+        vector<std::thread> m_threads;
+        Region* m_regions = nullptr;
+        bool m_exit = false;
+    };
+
+    // Parallel regions run by an AsyncTask that was submitted to the host task system. The async task holds a host worker,
+    // so the tasks it submits might only start once it has returned if the host has no other worker free and waitTask
+    // doesn't run queued tasks. The async task therefore drains each region together with whichever helpers did
+    // start, closes it to those that didn't, and leaves waiting on the submitted tasks to Wait, called from another thread.
+    class DeferredHostRegions
+    {
+    public:
+        explicit DeferredHostRegions(const StdAllocator<uint8_t>& allocator) : m_allocator(allocator) { }
+
+        DeferredHostRegions(const DeferredHostRegions&) = delete;
+        DeferredHostRegions& operator=(const DeferredHostRegions&) = delete;
+
+        ~DeferredHostRegions()
+        {
+            Wait();
+        }
+
+        // Set on a thread while it runs an AsyncTask that was submitted to the host task system.
+        static DeferredHostRegions*& GetCurrent()
+        {
+            thread_local DeferredHostRegions* current = nullptr;
+            return current;
+        }
+
+        // Runs drain() on the calling thread and submits helperCount host tasks that run it as well. drain must return once
+        // there is nothing left to claim. Returns when every helper that entered drain has left it.
+        template<class TFn>
+        void Run(const ommTaskInterface& taskInterface, uint32_t helperCount, TFn& drain)
+        {
+            // Closed regions whose helpers have all returned can be waited on without blocking.
+            ReleaseFinished();
+
+            Region* region = Allocate<Region>(m_allocator, m_allocator, taskInterface);
+            region->drain = &Invoke<TFn>;
+            region->arg = &drain;
+            region->next = m_regions;
+            m_regions = region;
+
+            region->tasks.reserve(helperCount);
+            for (uint32_t taskIt = 0; taskIt < helperCount; ++taskIt)
+                region->tasks.push_back(taskInterface.submitTask(taskInterface.userArg, &Region::Help, region));
+
+            drain();
+
+            uint32_t state = region->state.fetch_or(Region::kClosed, std::memory_order_acq_rel);
+            while ((state & ~Region::kClosed) != 0)
+            {
+                std::this_thread::yield();
+                state = region->state.load(std::memory_order_acquire);
+            }
+        }
+
+        // Waits on the tasks of every region run so far. Must not be called from the host worker that ran the regions.
+        void Wait()
+        {
+            while (m_regions != nullptr)
+            {
+                Region* region = m_regions;
+                m_regions = region->next;
+                Release(region);
+            }
+        }
+
+    private:
+        struct Region
+        {
+            static constexpr uint32_t kClosed = 1u << 31;
+
+            Region(const StdAllocator<uint8_t>& allocator, const ommTaskInterface& taskInterface) : taskInterface(taskInterface), tasks(allocator) { }
+
+            static void Help(uint32_t /*taskIndex*/, void* taskArg)
+            {
+                Region* region = (Region*)taskArg;
+                uint32_t state = region->state.load(std::memory_order_acquire);
+                while ((state & kClosed) == 0)
+                {
+                    if (region->state.compare_exchange_weak(state, state + 1, std::memory_order_acq_rel))
+                    {
+                        region->drain(region->arg);
+                        region->state.fetch_sub(1, std::memory_order_release);
+                        break;
+                    }
+                }
+                // The region may be released as soon as the last helper is counted.
+                region->finishedCount.fetch_add(1, std::memory_order_release);
+            }
+
+            const ommTaskInterface taskInterface;
+            void (*drain)(void* arg) = nullptr;
+            void* arg = nullptr;
+            // kClosed once the submitting thread is done with the region, plus the number of helpers inside drain.
+            std::atomic<uint32_t> state = 0;
+            std::atomic<uint32_t> finishedCount = 0;
+            vector<void*> tasks;
+            Region* next = nullptr;
+        };
+
+        template<class TFn>
+        static void Invoke(void* arg)
+        {
+            (*(TFn*)arg)();
+        }
+
+        void ReleaseFinished()
+        {
+            for (Region** it = &m_regions; *it != nullptr;)
+            {
+                Region* region = *it;
+                // Regions this one is nested in are still open.
+                const bool closed = (region->state.load(std::memory_order_acquire) & Region::kClosed) != 0;
+                if (closed && region->finishedCount.load(std::memory_order_acquire) == region->tasks.size())
+                {
+                    *it = region->next;
+                    Release(region);
+                }
+                else
+                {
+                    it = &region->next;
+                }
+            }
+        }
+
+        void Release(Region* region)
+        {
+            for (void* task : region->tasks)
+                region->taskInterface.waitTask(region->taskInterface.userArg, task);
+            Deallocate(m_allocator, region);
+        }
+
+        StdAllocator<uint8_t> m_allocator;
+        Region* m_regions = nullptr;
+    };
+
+    // Executes parallel regions either on a pool of internal threads, or through the host task system when an
+    // ommTaskInterface was provided at baker creation. Copies share the pool, which is allocated from allocator.
+    class Scheduler
+    {
+    public:
+        explicit Scheduler(const StdAllocator<uint8_t>& allocator, const ommTaskInterface& taskInterface = ommTaskInterfaceDefault()) : m_taskInterface(taskInterface)
+        {
+            if (m_taskInterface.parallelFor == nullptr && m_taskInterface.submitTask == nullptr)
+                m_workerPool = std::allocate_shared<WorkerPool>(StdAllocator<WorkerPool>(allocator), allocator, GetWorkerCount() - 1);
+        }
+
+        const ommTaskInterface& GetTaskInterface() const
+        {
+            return m_taskInterface;
+        }
+
+        // Number of threads participating in a ParallelFor, the calling thread included.
+        uint32_t GetWorkerCount() const
+        {
+            if (m_taskInterface.workerCount != 0)
+                return m_taskInterface.workerCount;
+            return std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        // Runs fn(taskIt) for every taskIt in [0, taskCount).
+        // Tasks are claimed one at a time from a shared counter, so a worker that is done with a cheap task immediately
+        // picks up the next pending one instead of idling on a static partition. Order the tasks by decreasing cost for
+        // the best balance. Runs serially on the calling thread when threading is disabled or there is a single task.
+        template<class TFn>
+        void ParallelFor(const StdAllocator<uint8_t>& allocator, bool enableThreads, uint32_t taskCount, TFn&& fn) const
+        {
+            const uint32_t workerCount = enableThreads ? std::min(GetWorkerCount(), taskCount) : 1u;
+
+            if (workerCount <= 1)
+            {
+                for (uint32_t taskIt = 0; taskIt < taskCount; ++taskIt)
+                    fn(taskIt);
+                return;
+            }
+
+            if (m_taskInterface.parallelFor != nullptr)
+            {
+                // The host task system does the scheduling.
+                m_taskInterface.parallelFor(m_taskInterface.userArg, taskCount, &Invoke<std::remove_reference_t<TFn>>, (void*)&fn);
+                return;
+            }
+
+            std::atomic<uint32_t> nextTask = 0;
+            auto worker = [&nextTask, taskCount, &fn](uint32_t /*workerIt*/) {
+                for (uint32_t taskIt = nextTask.fetch_add(1, std::memory_order_relaxed); taskIt < taskCount; taskIt = nextTask.fetch_add(1, std::memory_order_relaxed))
+                    fn(taskIt);
+            };
+
+            if (m_taskInterface.submitTask != nullptr)
+            {
+                if (DeferredHostRegions* deferred = DeferredHostRegions::GetCurrent())
+                {
+                    auto drain = [&worker]() { worker(0); };
+                    deferred->Run(m_taskInterface, workerCount - 1, drain);
+                    return;
+                }
+
+                // One task per worker, each draining the shared counter.
+                vector<void*> tasks(allocator);
+                tasks.reserve(workerCount - 1);
+                for (uint32_t workerIt = 0; workerIt < workerCount - 1; ++workerIt)
+                    tasks.push_back(m_taskInterface.submitTask(m_taskInterface.userArg, &Invoke<decltype(worker)>, (void*)&worker));
+
+                worker(0);
+
+                for (void* task : tasks)
+                    m_taskInterface.waitTask(m_taskInterface.userArg, task);
+                return;
+            }
+
+            auto drain = [&worker]() { worker(0); };
+            m_workerPool->Run(workerCount - 1, drain);
+        }
+
+        // Runs fn(begin, end) over [0, count) split in to blocks of blockSize elements.
+        template<class TFn>
+        void ParallelForBlocks(const StdAllocator<uint8_t>& allocator, bool enableThreads, uint32_t count, uint32_t blockSize, TFn&& fn) const
+        {
+            const uint32_t blockCount = (count + blockSize - 1) / blockSize;
+            ParallelFor(allocator, enableThreads, blockCount, [count, blockSize, &fn](uint32_t blockIt) {
+                const uint32_t begin = blockIt * blockSize;
+                fn(begin, std::min(begin + blockSize, count));
+            });
+        }
+
+    private:
+        template<class TFn>
+        static void Invoke(uint32_t taskIndex, void* taskArg)
+        {
+            (*(TFn*)taskArg)(taskIndex);
+        }
+
+        ommTaskInterface m_taskInterface;
+        std::shared_ptr<WorkerPool> m_workerPool;
+    };
+
+    // A single function running in the background, as a host task when the task interface provides submitTask and on a
+    // dedicated thread otherwise. Wait must be called (or the object destroyed) before anything fn references goes away.
+    class AsyncTask
+    {
+    public:
+        // The parallel regions of a host task keep their bookkeeping in allocator until Wait.
+        explicit AsyncTask(const StdAllocator<uint8_t>& allocator) : m_taskInterface(ommTaskInterfaceDefault()), m_deferredRegions(allocator) { }
+
+        ~AsyncTask()
+        {
+            Wait();
+        }
+
+        // Runs fn(arg).
+        void Start(const Scheduler& scheduler, void (*fn)(void* arg), void* arg)
+        {
+            Wait();
+            m_fn = fn;
+            m_arg = arg;
+            m_taskInterface = scheduler.GetTaskInterface();
+            if (m_taskInterface.submitTask != nullptr)
+                m_hostTask = m_taskInterface.submitTask(m_taskInterface.userArg, &Invoke, this);
+            else
+                m_thread = std::thread(m_fn, m_arg);
+        }
+
+        void Wait()
+        {
+            if (m_hostTask != nullptr)
+            {
+                m_taskInterface.waitTask(m_taskInterface.userArg, m_hostTask);
+                m_hostTask = nullptr;
+                // The host worker is free again, the helpers that were still queued can run.
+                m_deferredRegions.Wait();
+            }
+            if (m_thread.joinable())
+                m_thread.join();
+        }
+
+    private:
+        static void Invoke(uint32_t /*taskIndex*/, void* taskArg)
+        {
+            AsyncTask* task = (AsyncTask*)taskArg;
+            DeferredHostRegions::GetCurrent() = &task->m_deferredRegions;
+            task->m_fn(task->m_arg);
+            DeferredHostRegions::GetCurrent() = nullptr;
+        }
+
+        ommTaskInterface m_taskInterface;
+        void (*m_fn)(void* arg) = nullptr;
+        void* m_arg = nullptr;
+        DeferredHostRegions m_deferredRegions;
+        void* m_hostTask = nullptr;
+        std::thread m_thread;
+    };
+} // namespace parallel
+} // namespace omm
@@ -0,0 +1,38 @@
+/*
+Copyright (c) 2026, NVIDIA CORPORATION. All rights reserved.
+
+NVIDIA CORPORATION and its licensors retain all intellectual property
+and proprietary rights in and to this software, related documentation
+and any modifications thereto. Any use, reproduction, disclosure or
+distribution of this software and related documentation without an express
+license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+// Platform SIMD headers. The x86-64 and AArch64 baselines (SSE2 and NEON) are always available, wider x86 instruction
+// sets must be selected at runtime and used from functions marked with OMM_SIMD_TARGET.
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define OMM_SIMD_X86 (1)
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#else
+#define OMM_SIMD_X86 (0)
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define OMM_SIMD_NEON (1)
+#include <arm_neon.h>
+#else
+#define OMM_SIMD_NEON (0)
+#endif
+
+// Lets code for a wider x86 instruction set be compiled without raising the baseline architecture of the whole library.
+#if defined(__GNUC__) || defined(__clang__)
+#define OMM_SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define OMM_SIMD_TARGET(isa)
+#endif
@@ -147,6 +147,26 @@ namespace omm
         out11 = { offset11.x,   offset11.y };
     }
 
+    // Texel index in a texture stored as row-major 8x8 tiles, each tile stored row-major. size.x need not be a multiple of
+    // the tile size, the last tile of a row is padded.
+    static constexpr int kTexelTileSizeLog2 = 3;
+    static constexpr int kTexelTileSize = 1 << kTexelTileSizeLog2;
+
+    static inline uint32_t GetTiledIndex(const int2& idx, const int2& size) {
+        const uint32_t tilesPerRow = uint32_t(size.x + kTexelTileSize - 1) >> kTexelTileSizeLog2;
+        const uint32_t tile = (uint32_t(idx.x) >> kTexelTileSizeLog2) + (uint32_t(idx.y) >> kTexelTileSizeLog2) * tilesPerRow;
+        return (tile << (2 * kTexelTileSizeLog2)) | ((uint32_t(idx.y) & (kTexelTileSize - 1)) << kTexelTileSizeLog2) | (uint32_t(idx.x) & (kTexelTileSize - 1));
+    }
+
+    static inline uint2 GetTiledTexCoord(const uint32_t idx, const int2& size) {
+        const uint32_t tilesPerRow = uint32_t(size.x + kTexelTileSize - 1) >> kTexelTileSizeLog2;
+        const uint32_t tile = idx >> (2 * kTexelTileSizeLog2);
+        uint2 res;
+        res.x = ((tile % tilesPerRow) << kTexelTileSizeLog2) | (idx & (kTexelTileSize - 1));
+        res.y = ((tile / tilesPerRow) << kTexelTileSizeLog2) | ((idx >> kTexelTileSizeLog2) & (kTexelTileSize - 1));
+        return res;
+    }
+
     static inline uint32_t GetTexCoordFormatSize(ommTexCoordFormat format) {
         switch (format) {
         case ommTexCoordFormat_UV16_UNORM:
@@ -20,12 +20,21 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 
 #include <math.h>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
 
 #include <string>
 #include <fstream>
 #include <vector>
+#include <map>
+#include <filesystem>
 #include <istream>
 #include <iterator>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 namespace {
 
@@ -45,6 +54,7 @@ namespace {
 		omm::TextureAddressMode addressingMode = omm::TextureAddressMode::Clamp;
 		omm::UnknownStatePromotion unknownStatePromotion = omm::UnknownStatePromotion::Nearest;
 		bool mergeSimilar = false;
+		bool mergeSimilarExact = false; // Nearest neighbour search instead of LSH.
 		uint32_t mipCount = 1;
 		bool enableSpecialIndices = true;
 		bool oneFile = true;
@@ -53,12 +63,14 @@ namespace {
 		omm::OpacityState alphaCutoffLE = omm::OpacityState::Transparent;
 		omm::OpacityState alphaCutoffGT = omm::OpacityState::Opaque;
 		uint64_t maxWorkloadSize = 0xFFFFFFFFFFFFFFFF;
+		uint64_t maxWorkingSetBytes = 0xFFFFFFFFFFFFFFFF;
 		omm::Result bakeResult = omm::Result::SUCCESS;
 		bool forceCorruptedBlob = false;
 		bool forceSerializedOutput = false;
 		bool serializeCompress = false;
 		omm::SpecialIndex unresolvedTriState = omm::SpecialIndex::FullyUnknownOpaque;
 		float dynamicSubdivisionScale = 0.f;
+		bool bakeAsync = false;
 	};
 
 	static float StandardCircle(int i, int j, int w, int h, int mip)
@@ -75,6 +87,94 @@ namespace {
 		return 1.f;
 	}
 
+	// Host task system for the tests of the submitTask / waitTask path. threadCount workers run the submitted tasks in order,
+	// waitTask only blocks and never runs a queued task itself. A held task system starts no task before Release.
+	class HostTaskSystem
+	{
+	public:
+		HostTaskSystem(uint32_t threadCount, bool held = false) : _held(held) {
+			for (uint32_t threadIt = 0; threadIt < threadCount; ++threadIt)
+				_threads.emplace_back([this]() { Run(); });
+		}
+
+		~HostTaskSystem() {
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_exit = true;
+			}
+			_wake.notify_all();
+			for (std::thread& thread : _threads)
+				thread.join();
+		}
+
+		omm::TaskInterface GetTaskInterface(uint32_t workerCount) {
+			return { .submitTask = &HostTaskSystem::SubmitTask, .waitTask = &HostTaskSystem::WaitTask, .workerCount = workerCount, .userArg = this };
+		}
+
+		void Release() {
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_held = false;
+			}
+			_wake.notify_all();
+		}
+
+		uint32_t GetSubmittedCount() const {
+			return _submittedCount;
+		}
+
+	private:
+		struct Task
+		{
+			omm::TaskCallback task;
+			void* taskArg;
+			std::atomic<bool> done = false;
+		};
+
+		void Run() {
+			std::unique_lock<std::mutex> lock(_mutex);
+			for (;;)
+			{
+				_wake.wait(lock, [this]() { return _exit || (!_held && !_queue.empty()); });
+				if (_held || _queue.empty())
+					return;
+				Task* task = _queue.front();
+				_queue.pop_front();
+				lock.unlock();
+				task->task(0, task->taskArg);
+				task->done = true;
+				lock.lock();
+			}
+		}
+
+		static void* SubmitTask(void* userArg, omm::TaskCallback task, void* taskArg) {
+			HostTaskSystem* self = (HostTaskSystem*)userArg;
+			Task* handle = new Task{ task, taskArg };
+			{
+				std::lock_guard<std::mutex> lock(self->_mutex);
+				self->_queue.push_back(handle);
+				self->_submittedCount++;
+			}
+			self->_wake.notify_one();
+			return handle;
+		}
+
+		static void WaitTask(void* userArg, void* handle) {
+			Task* task = (Task*)handle;
+			while (!task->done)
+				std::this_thread::yield();
+			delete task;
+		}
+
+		std::mutex _mutex;
+		std::condition_variable _wake;
+		std::deque<Task*> _queue;
+		std::atomic<uint32_t> _submittedCount = 0;
+		bool _held;
+		bool _exit = false;
+		std::vector<std::thread> _threads;
+	};
+
 	class OMMBakeTestCPU : public ::testing::TestWithParam<TestSuiteConfig> {
 	protected:
 		void SetUp() override {
@@ -196,9 +296,12 @@ namespace {
 			desc.unknownStatePromotion = opt.unknownStatePromotion;
 			desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)omm::Cpu::BakeFlags::EnableInternalThreads);
 			desc.maxWorkloadSize = opt.maxWorkloadSize;
+			desc.maxWorkingSetBytes = opt.maxWorkingSetBytes;
 			desc.unresolvedTriState = opt.unresolvedTriState;
 			if (opt.mergeSimilar)
 				desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)desc.bakeFlags | (uint32_t)omm::Cpu::BakeFlags::EnableNearDuplicateDetection);
+			if (opt.mergeSimilarExact)
+				desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)desc.bakeFlags | (uint32_t)omm::Cpu::BakeFlags::EnableNearDuplicateDetection | (uint32_t)omm::Cpu::BakeFlags::EnableNearDuplicateDetectionExact);
 			if (Force32BitIndices())
 				desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)desc.bakeFlags | (uint32_t)omm::Cpu::BakeFlags::Force32BitIndices);
 			if (!opt.enableSpecialIndices)
@@ -346,6 +449,37 @@ namespace {
 					EXPECT_EQ(omm::Cpu::DestroyDeserializedResult(dRes), omm::Result::SUCCESS);
 				}
 			}
+			else if (opt.bakeAsync)
+			{
+				EXPECT_EQ(omm::Cpu::BakeAsync(_baker, desc, &res), omm::Result::SUCCESS);
+				EXPECT_NE(res, nullptr);
+
+				omm::Result pollResult = omm::Result::NOT_READY;
+				omm::Cpu::BakeProgress progress;
+				omm::Cpu::BakeStage lastStage = omm::Cpu::BakeStage::Setup;
+				while (pollResult == omm::Result::NOT_READY)
+				{
+					EXPECT_EQ(omm::Cpu::GetBakeResultDesc(res, &resDesc), omm::Result::NOT_READY);
+					std::this_thread::yield();
+					pollResult = omm::Cpu::PollBake(res, &progress);
+					EXPECT_GE((uint32_t)progress.stage, (uint32_t)lastStage);
+					EXPECT_GE(progress.stageProgress, 0.f);
+					EXPECT_LE(progress.stageProgress, 1.f);
+					lastStage = progress.stage;
+				}
+
+				EXPECT_EQ(pollResult, opt.bakeResult);
+				if (opt.bakeResult != omm::Result::SUCCESS)
+				{
+					EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+					return BakeOutput();
+				}
+
+				EXPECT_EQ(progress.stage, omm::Cpu::BakeStage::Done);
+				EXPECT_EQ(progress.stageProgress, 1.f);
+
+				EXPECT_EQ(omm::Cpu::GetBakeResultDesc(res, &resDesc), omm::Result::SUCCESS);
+			}
 			else
 			{
 				EXPECT_EQ(omm::Cpu::Bake(_baker, desc, &res), opt.bakeResult);
@@ -523,6 +657,104 @@ namespace {
 			return stats;
 		}
 
+		// Bake input over UV32_FLOAT texture coordinates and UINT_32 indices with the settings the tests below share. Tests adjust
+		// the returned desc to the settings they exercise.
+		omm::Cpu::BakeInputDesc GetBakeInputDesc(omm::Cpu::Texture tex, uint32_t subdivisionLevel, uint32_t indexCount, const uint32_t* triangleIndices, const float* texCoords) const
+		{
+			omm::Cpu::BakeInputDesc desc;
+			desc.texture = tex;
+			desc.alphaMode = omm::AlphaMode::Test;
+			desc.alphaCutoff = 0.5f;
+			desc.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+			desc.runtimeSamplerDesc.filter = omm::TextureFilterMode::Linear;
+			desc.indexFormat = omm::IndexFormat::UINT_32;
+			desc.indexBuffer = triangleIndices;
+			desc.texCoords = texCoords;
+			desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+			desc.indexCount = indexCount;
+			desc.maxSubdivisionLevel = subdivisionLevel;
+			if (Force32BitIndices())
+				desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)desc.bakeFlags | (uint32_t)omm::Cpu::BakeFlags::Force32BitIndices);
+			return desc;
+		}
+
+		// Bakes desc and returns the array data, desc array and index buffer of the result back to back, for comparing the
+		// outputs of two bakes byte for byte.
+		// Optionally returns the stats of the bake result, including its work counters.
+		std::vector<uint8_t> BakeAndSerialize(const omm::Cpu::BakeInputDesc& desc, omm::Debug::Stats* stats = nullptr)
+		{
+			omm::Cpu::BakeResult res = nullptr;
+			EXPECT_EQ(omm::Cpu::Bake(_baker, desc, &res), omm::Result::SUCCESS);
+			const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+			EXPECT_EQ(omm::Cpu::GetBakeResultDesc(res, &resDesc), omm::Result::SUCCESS);
+			if (resDesc == nullptr)
+				return {};
+
+			if (stats != nullptr)
+				EXPECT_EQ(omm::Debug::GetStats2(_baker, res, stats), omm::Result::SUCCESS);
+
+			const uint32_t indexSize = resDesc->indexFormat == omm::IndexFormat::UINT_8 ? 1 : resDesc->indexFormat == omm::IndexFormat::UINT_16 ? 2 : 4;
+			std::vector<uint8_t> output((const uint8_t*)resDesc->arrayData, (const uint8_t*)resDesc->arrayData + resDesc->arrayDataSize);
+			output.insert(output.end(), (const uint8_t*)resDesc->descArray, (const uint8_t*)(resDesc->descArray + resDesc->descArrayCount));
+			output.insert(output.end(), (const uint8_t*)resDesc->indexBuffer, (const uint8_t*)resDesc->indexBuffer + resDesc->indexCount * indexSize);
+
+			EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+			return output;
+		}
+
+		omm::Debug::Stats BakeAndGetStats(const omm::Cpu::BakeInputDesc& desc)
+		{
+			omm::Cpu::BakeResult res = nullptr;
+			EXPECT_EQ(omm::Cpu::Bake(_baker, desc, &res), omm::Result::SUCCESS);
+			const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+			EXPECT_EQ(omm::Cpu::GetBakeResultDesc(res, &resDesc), omm::Result::SUCCESS);
+			omm::Debug::Stats stats;
+			if (resDesc != nullptr)
+				EXPECT_EQ(omm::Debug::GetStats(_baker, resDesc, &stats), omm::Result::SUCCESS);
+			EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+			return stats;
+		}
+
+		// Bakes desc and returns the OMM of every primitive: the special index, or the format, subdivision level and states of the
+		// OMM it references. Compares bakes that may order the OMMs differently.
+		std::vector<std::vector<uint8_t>> BakeAndGetPrimitiveOmms(const omm::Cpu::BakeInputDesc& desc)
+		{
+			omm::Cpu::BakeResult res = nullptr;
+			EXPECT_EQ(omm::Cpu::Bake(_baker, desc, &res), omm::Result::SUCCESS);
+			const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+			EXPECT_EQ(omm::Cpu::GetBakeResultDesc(res, &resDesc), omm::Result::SUCCESS);
+			if (resDesc == nullptr)
+				return {};
+
+			std::vector<std::vector<uint8_t>> primitiveOmms(resDesc->indexCount);
+			for (uint32_t primitiveIt = 0; primitiveIt < resDesc->indexCount; ++primitiveIt)
+			{
+				int32_t index = 0;
+				if (resDesc->indexFormat == omm::IndexFormat::UINT_8)
+					index = ((const int8_t*)resDesc->indexBuffer)[primitiveIt];
+				else if (resDesc->indexFormat == omm::IndexFormat::UINT_16)
+					index = ((const int16_t*)resDesc->indexBuffer)[primitiveIt];
+				else
+					index = ((const int32_t*)resDesc->indexBuffer)[primitiveIt];
+
+				std::vector<uint8_t>& omm = primitiveOmms[primitiveIt];
+				if (index < 0)
+				{
+					omm.assign((const uint8_t*)&index, (const uint8_t*)(&index + 1));
+					continue;
+				}
+
+				const omm::Cpu::OpacityMicromapDesc& ommDesc = resDesc->descArray[index];
+				const uint32_t bitsPerState = ommDesc.format == (uint16_t)omm::Format::OC1_2_State ? 1 : 2;
+				const uint32_t size = std::max(omm::bird::GetNumMicroTriangles(ommDesc.subdivisionLevel) * bitsPerState / 8, 1u);
+				omm = { (uint8_t)ommDesc.format, (uint8_t)ommDesc.subdivisionLevel };
+				omm.insert(omm.end(), (const uint8_t*)resDesc->arrayData + ommDesc.offset, (const uint8_t*)resDesc->arrayData + ommDesc.offset + size);
+			}
+
+			EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+			return primitiveOmms;
+		}
+
 		omm::Debug::Stats GetOmmBakeStats(
 			float alphaCutoff,
 			uint32_t subdivisionLevel,
@@ -637,6 +869,51 @@ namespace {
 			return GetOmmBakeStats(alphaCutoff, subdivisionLevel, texSize, 6, triangleIndices, omm::TexCoordFormat::UV32_FLOAT, texCoords, texHandle, opt);
 		}
 
+		// A 32x32 grid of triangles, each covering its own cell of the texture. Over Hexagons the cells repeat a few states.
+		static void GetHexagonsReuseMesh(std::vector<uint32_t>& indices, std::vector<float2>& texCoords)
+		{
+			const uint32_t N = 32;
+			const uint32_t M = 32;
+			for (uint32_t j = 0; j < M; ++j)
+			{
+				for (uint32_t i = 0; i < N; ++i)
+				{
+					const uint32_t indexOffset = 3 * (i + j * N);
+					indices.push_back(indexOffset + 0);
+					indices.push_back(indexOffset + 1);
+					indices.push_back(indexOffset + 2);
+
+					const float2 offset = float2(float(i) / float(N), float(j) / float(M));
+					texCoords.push_back(offset + float2(0.f, 0.f) / float2(N, M));
+					texCoords.push_back(offset + float2(0.f, 1.f) / float2(N, M));
+					texCoords.push_back(offset + float2(1.f, 1.f) / float2(N, M));
+				}
+			}
+		}
+
+		// Hexagon grid over a 1024x1024 texture.
+		static float Hexagons(int i, int j, int w, int h, int mip)
+		{
+			const float scale = 30.f;
+			const float gridThickness = 0.2f;
+
+			float2 pos = scale * float2(i, j) / float2(1024, 1024);
+			pos.x *= 0.57735f * 2.0f;
+			pos.y += 0.5f * ((uint32_t)floor(pos.x) % 2);
+			pos = glm::abs(glm::fract(pos) - float2(0.5f));
+			float d = std::abs(glm::max(pos.x * 1.5f + pos.y, pos.y * 2.0f) - 1.0f);
+
+			return glm::smoothstep(0.0f, gridThickness, d);
+		}
+
+		omm::Debug::Stats GetHexagonsReuseStats(uint32_t subdivisionLevel, const Options opt = {})
+		{
+			std::vector<uint32_t> indices;
+			std::vector<float2> texCoords;
+			GetHexagonsReuseMesh(indices, texCoords);
+			return GetOmmBakeStatsFP32(0.5f, subdivisionLevel, { 1024, 1024 }, (uint32_t)indices.size(), indices.data(), omm::TexCoordFormat::UV32_FLOAT, (float*)texCoords.data(), &Hexagons, opt);
+		}
+
 		omm::Debug::Stats LeafletMipN(uint32_t mipStart, uint32_t NumMip, float alphaCutoff = 0.5f)
 		{
 			uint32_t subdivisionLevel = 6;
@@ -970,6 +1247,871 @@ namespace {
 			});
 	}
 
+	TEST_P(OMMBakeTestCPU, CircleHostTaskInterface) {
+
+		struct TaskSystem
+		{
+			uint32_t numParallelFor = 0;
+
+			static void ParallelFor(void* userArg, uint32_t taskCount, omm::TaskCallback task, void* taskArg) {
+				((TaskSystem*)userArg)->numParallelFor++;
+				for (uint32_t taskIt = 0; taskIt < taskCount; ++taskIt)
+					task(taskIt, taskArg);
+			}
+		};
+
+		TaskSystem taskSystem;
+
+		// Replace the default baker with one that routes the parallel regions through the host.
+		EXPECT_EQ(omm::DestroyBaker(_baker), omm::Result::SUCCESS);
+		omm::BakerCreationDesc bakerDesc = { .type = omm::BakerType::CPU };
+		bakerDesc.taskInterface = { .parallelFor = &TaskSystem::ParallelFor, .workerCount = 4, .userArg = &taskSystem };
+		EXPECT_EQ(omm::CreateBaker(bakerDesc, &_baker), omm::Result::SUCCESS);
+
+		uint32_t subdivisionLevel = 4;
+
+		omm::Debug::Stats stats = GetOmmBakeStatsFP32(0.5f, subdivisionLevel, { 1024, 1024 }, &StandardCircle);
+
+		EXPECT_GT(taskSystem.numParallelFor, 0u);
+
+		ExpectEqual(stats, {
+			.totalOpaque = 204,
+			.totalTransparent = 219,
+			.totalUnknownTransparent = 39,
+			.totalUnknownOpaque = 50,
+			});
+	}
+
+	TEST_P(OMMBakeTestCPU, CircleAsync) {
+
+		uint32_t subdivisionLevel = 4;
+
+		omm::Debug::Stats stats = GetOmmBakeStatsFP32(0.5f, subdivisionLevel, { 1024, 1024 }, &StandardCircle, { .bakeAsync = true });
+
+		ExpectEqual(stats, {
+			.totalOpaque = 204,
+			.totalTransparent = 219,
+			.totalUnknownTransparent = 39,
+			.totalUnknownOpaque = 50,
+			});
+	}
+
+	TEST_P(OMMBakeTestCPU, CircleAsyncCancel) {
+
+		// Holds the submitted bake back until the test has cancelled it.
+		HostTaskSystem taskSystem(1, true);
+
+		EXPECT_EQ(omm::DestroyBaker(_baker), omm::Result::SUCCESS);
+		omm::BakerCreationDesc bakerDesc = { .type = omm::BakerType::CPU };
+		bakerDesc.taskInterface = taskSystem.GetTaskInterface(1);
+		EXPECT_EQ(omm::CreateBaker(bakerDesc, &_baker), omm::Result::SUCCESS);
+
+		const uint32_t subdivisionLevel = 4;
+		vmtest::TextureFP32 texture(1024, 1024, 1, EnableZOrder(), EnableAlphaCutoff() ? 0.5f : -1.f, &StandardCircle);
+		omm::Cpu::Texture tex = CreateTexture(texture.GetDesc());
+
+		uint32_t triangleIndices[6] = { 0, 1, 2, 3, 1, 2 };
+		float texCoords[8] = { 0.f, 0.f,	0.f, 1.f,	1.f, 0.f,	 1.f, 1.f };
+
+		omm::Cpu::BakeInputDesc desc = GetBakeInputDesc(tex, subdivisionLevel, 6, triangleIndices, texCoords);
+
+		omm::Cpu::BakeResult res = nullptr;
+		EXPECT_EQ(omm::Cpu::BakeAsync(_baker, desc, &res), omm::Result::SUCCESS);
+
+		omm::Cpu::BakeProgress progress;
+		EXPECT_EQ(omm::Cpu::PollBake(res, &progress), omm::Result::NOT_READY);
+		EXPECT_EQ(progress.stage, omm::Cpu::BakeStage::Setup);
+
+		EXPECT_EQ(omm::Cpu::CancelBake(res), omm::Result::SUCCESS);
+		taskSystem.Release();
+
+		omm::Result pollResult = omm::Result::NOT_READY;
+		while (pollResult == omm::Result::NOT_READY)
+		{
+			std::this_thread::yield();
+			pollResult = omm::Cpu::PollBake(res, nullptr);
+		}
+		EXPECT_EQ(pollResult, omm::Result::CANCELLED);
+
+		const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+		EXPECT_EQ(omm::Cpu::GetBakeResultDesc(res, &resDesc), omm::Result::CANCELLED);
+
+		EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+	}
+
+	TEST_P(OMMBakeTestCPU, CircleAsyncSingleWorker) {
+
+		// A single worker, the async bake occupies it. Any task the bake submitted and waited on itself would never run.
+		HostTaskSystem taskSystem(1);
+
+		EXPECT_EQ(omm::DestroyBaker(_baker), omm::Result::SUCCESS);
+		omm::BakerCreationDesc bakerDesc = { .type = omm::BakerType::CPU };
+		bakerDesc.taskInterface = taskSystem.GetTaskInterface(4);
+		EXPECT_EQ(omm::CreateBaker(bakerDesc, &_baker), omm::Result::SUCCESS);
+
+		uint32_t subdivisionLevel = 4;
+
+		omm::Debug::Stats stats = GetOmmBakeStatsFP32(0.5f, subdivisionLevel, { 1024, 1024 }, &StandardCircle, { .bakeAsync = true });
+
+		// The parallel regions were submitted as well, and drained by the bake itself.
+		EXPECT_GT(taskSystem.GetSubmittedCount(), 1u);
+
+		ExpectEqual(stats, {
+			.totalOpaque = 204,
+			.totalTransparent = 219,
+			.totalUnknownTransparent = 39,
+			.totalUnknownOpaque = 50,
+			});
+	}
+
+	TEST_P(OMMBakeTestCPU, CircleAsyncHostWorkers) {
+
+		// The async bake shares the parallel regions with the other host workers.
+		HostTaskSystem taskSystem(4);
+
+		EXPECT_EQ(omm::DestroyBaker(_baker), omm::Result::SUCCESS);
+		omm::BakerCreationDesc bakerDesc = { .type = omm::BakerType::CPU };
+		bakerDesc.taskInterface = taskSystem.GetTaskInterface(4);
+		EXPECT_EQ(omm::CreateBaker(bakerDesc, &_baker), omm::Result::SUCCESS);
+
+		uint32_t subdivisionLevel = 4;
+
+		omm::Debug::Stats stats = GetOmmBakeStatsFP32(0.5f, subdivisionLevel, { 1024, 1024 }, &StandardCircle, { .bakeAsync = true });
+
+		EXPECT_GT(taskSystem.GetSubmittedCount(), 1u);
+
+		ExpectEqual(stats, {
+			.totalOpaque = 204,
+			.totalTransparent = 219,
+			.totalUnknownTransparent = 39,
+			.totalUnknownOpaque = 50,
+			});
+	}
+
+	TEST_P(OMMBakeTestCPU, CircleAsyncDestroyBaker) {
+
+		// The texture is created up front, building it would wait on the held back tasks.
+		const uint32_t subdivisionLevel = 4;
+		vmtest::TextureFP32 texture(1024, 1024, 1, EnableZOrder(), EnableAlphaCutoff() ? 0.5f : -1.f, &StandardCircle);
+		omm::Cpu::Texture tex = CreateTexture(texture.GetDesc());
+
+		// Holds the submitted bake back until the baker is gone.
+		HostTaskSystem taskSystem(2, true);
+
+		EXPECT_EQ(omm::DestroyBaker(_baker), omm::Result::SUCCESS);
+		omm::BakerCreationDesc bakerDesc = { .type = omm::BakerType::CPU };
+		bakerDesc.taskInterface = taskSystem.GetTaskInterface(4);
+		EXPECT_EQ(omm::CreateBaker(bakerDesc, &_baker), omm::Result::SUCCESS);
+
+		uint32_t triangleIndices[6] = { 0, 1, 2, 3, 1, 2 };
+		float texCoords[8] = { 0.f, 0.f,	0.f, 1.f,	1.f, 0.f,	 1.f, 1.f };
+
+		omm::Cpu::BakeInputDesc desc = GetBakeInputDesc(tex, subdivisionLevel, 6, triangleIndices, texCoords);
+		desc.unknownStatePromotion = omm::UnknownStatePromotion::Nearest;
+		desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)desc.bakeFlags | (uint32_t)omm::Cpu::BakeFlags::EnableInternalThreads);
+
+		omm::Cpu::BakeResult res = nullptr;
+		EXPECT_EQ(omm::Cpu::BakeAsync(_baker, desc, &res), omm::Result::SUCCESS);
+
+		// The running bake must not depend on the baker it was started from.
+		EXPECT_EQ(omm::DestroyBaker(_baker), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::CreateBaker({ .type = omm::BakerType::CPU }, &_baker), omm::Result::SUCCESS);
+		taskSystem.Release();
+
+		omm::Result pollResult = omm::Result::NOT_READY;
+		while (pollResult == omm::Result::NOT_READY)
+		{
+			std::this_thread::yield();
+			pollResult = omm::Cpu::PollBake(res, nullptr);
+		}
+		EXPECT_EQ(pollResult, omm::Result::SUCCESS);
+
+		const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+		EXPECT_EQ(omm::Cpu::GetBakeResultDesc(res, &resDesc), omm::Result::SUCCESS);
+
+		omm::Debug::Stats stats;
+		EXPECT_EQ(omm::Debug::GetStats(_baker, resDesc, &stats), omm::Result::SUCCESS);
+
+		ExpectEqual(stats, {
+			.totalOpaque = 204,
+			.totalTransparent = 219,
+			.totalUnknownTransparent = 39,
+			.totalUnknownOpaque = 50,
+			});
+
+		EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+	}
+
+	TEST_P(OMMBakeTestCPU, CircleBakeCache) {
+
+		struct Cache
+		{
+			std::map<uint64_t, std::vector<uint8_t>> entries;
+			uint32_t numHits = 0;
+
+			static bool Load(void* userArg, uint64_t key, void* data, uint64_t* size) {
+				Cache* self = (Cache*)userArg;
+				auto it = self->entries.find(key);
+				if (it == self->entries.end())
+					return false;
+				if (data != nullptr)
+				{
+					EXPECT_EQ(*size, it->second.size());
+					memcpy(data, it->second.data(), it->second.size());
+					self->numHits++;
+				}
+				*size = it->second.size();
+				return true;
+			}
+
+			static void Store(void* userArg, uint64_t key, const void* data, uint64_t size) {
+				((Cache*)userArg)->entries[key].assign((const uint8_t*)data, (const uint8_t*)data + size);
+			}
+		};
+
+		Cache cache;
+
+		EXPECT_EQ(omm::DestroyBaker(_baker), omm::Result::SUCCESS);
+		omm::BakerCreationDesc bakerDesc = { .type = omm::BakerType::CPU };
+		bakerDesc.cacheInterface = { .load = &Cache::Load, .store = &Cache::Store, .userArg = &cache };
+		EXPECT_EQ(omm::CreateBaker(bakerDesc, &_baker), omm::Result::SUCCESS);
+
+		uint32_t subdivisionLevel = 4;
+
+		const omm::Debug::Stats expected = {
+			.totalOpaque = 204,
+			.totalTransparent = 219,
+			.totalUnknownTransparent = 39,
+			.totalUnknownOpaque = 50,
+		};
+
+		omm::Debug::Stats stats = GetOmmBakeStatsFP32(0.5f, subdivisionLevel, { 1024, 1024 }, &StandardCircle);
+		ExpectEqual(stats, expected);
+		EXPECT_EQ(cache.entries.size(), 1u);
+		EXPECT_EQ(cache.numHits, 0u);
+
+		// Same texture contents in a new texture object, the result comes from the cache.
+		stats = GetOmmBakeStatsFP32(0.5f, subdivisionLevel, { 1024, 1024 }, &StandardCircle);
+		ExpectEqual(stats, expected);
+		EXPECT_EQ(cache.entries.size(), 1u);
+		EXPECT_EQ(cache.numHits, 1u);
+
+		// Any change to the inputs gives a new key.
+		GetOmmBakeStatsFP32(0.5f, subdivisionLevel - 1, { 1024, 1024 }, &StandardCircle);
+		EXPECT_EQ(cache.entries.size(), 2u);
+		EXPECT_EQ(cache.numHits, 1u);
+	}
+
+	TEST_P(OMMBakeTestCPU, CircleBakeCacheDirectory) {
+
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / ("omm_bake_cache_test_" + std::to_string(GetParam()));
+		std::filesystem::remove_all(directory);
+
+		EXPECT_EQ(omm::DestroyBaker(_baker), omm::Result::SUCCESS);
+		omm::BakerCreationDesc bakerDesc = { .type = omm::BakerType::CPU };
+		const std::string directoryStr = directory.string();
+		bakerDesc.cacheInterface = { .directory = directoryStr.c_str() };
+		EXPECT_EQ(omm::CreateBaker(bakerDesc, &_baker), omm::Result::SUCCESS);
+
+		auto CountEntries = [&]() {
+			return std::distance(std::filesystem::directory_iterator(directory), std::filesystem::directory_iterator());
+		};
+
+		uint32_t subdivisionLevel = 4;
+
+		const omm::Debug::Stats expected = {
+			.totalOpaque = 204,
+			.totalTransparent = 219,
+			.totalUnknownTransparent = 39,
+			.totalUnknownOpaque = 50,
+		};
+
+		ExpectEqual(GetOmmBakeStatsFP32(0.5f, subdivisionLevel, { 1024, 1024 }, &StandardCircle), expected);
+		EXPECT_EQ(CountEntries(), 1);
+
+		ExpectEqual(GetOmmBakeStatsFP32(0.5f, subdivisionLevel, { 1024, 1024 }, &StandardCircle), expected);
+		EXPECT_EQ(CountEntries(), 1);
+
+		// A corrupt entry is ignored and replaced.
+		const std::filesystem::path entry = std::filesystem::directory_iterator(directory)->path();
+		std::filesystem::resize_file(entry, std::filesystem::file_size(entry) / 2);
+
+		ExpectEqual(GetOmmBakeStatsFP32(0.5f, subdivisionLevel, { 1024, 1024 }, &StandardCircle), expected);
+		EXPECT_EQ(CountEntries(), 1);
+
+		std::filesystem::remove_all(directory);
+	}
+
+	TEST_P(OMMBakeTestCPU, CircleTriangleCache) {
+
+		vmtest::TextureFP32 texture(1024, 1024, 1, EnableZOrder(), EnableAlphaCutoff() ? 0.5f : -1.f, &StandardCircle);
+		omm::Cpu::Texture tex = CreateTexture(texture.GetDesc());
+
+		omm::Cpu::TextureDesc cachedDesc = texture.GetDesc();
+		cachedDesc.flags = (omm::Cpu::TextureFlags)((uint32_t)cachedDesc.flags | (uint32_t)omm::Cpu::TextureFlags::EnableTriangleCache);
+		omm::Cpu::Texture cachedTex = CreateTexture(cachedDesc);
+
+		uint32_t triangleIndices[9] = { 0, 1, 2, 3, 1, 2, 4, 5, 6 };
+		float texCoords[14] = { 0.f, 0.f,	0.f, 1.f,	1.f, 0.f,	 1.f, 1.f,	0.1f, 0.1f,	0.2f, 0.7f,	0.6f, 0.3f };
+
+		// Records the triangle cache hits and lookups of every bake.
+		std::vector<std::pair<uint32_t, uint32_t>> cacheHits;
+		auto Bake = [&](omm::Cpu::Texture t, uint32_t indexCount) {
+			omm::Debug::Stats stats;
+			const std::vector<uint8_t> output = BakeAndSerialize(GetBakeInputDesc(t, 5, indexCount, triangleIndices, texCoords), &stats);
+			cacheHits.push_back({ stats.triangleCacheHits, stats.triangleCacheLookups });
+			return output;
+		};
+
+		const std::vector<uint8_t> expectedQuad = Bake(tex, 6);
+		const std::vector<uint8_t> expectedMesh = Bake(tex, 9);
+
+		// First bake fills the cache, the second one adds a triangle and reuses the cached ones.
+		EXPECT_EQ(Bake(cachedTex, 6), expectedQuad);
+		EXPECT_EQ(Bake(cachedTex, 9), expectedMesh);
+		EXPECT_EQ(Bake(cachedTex, 9), expectedMesh);
+		EXPECT_EQ(Bake(cachedTex, 6), expectedQuad);
+
+		// The texture without the cache is never looked up.
+		const std::vector<std::pair<uint32_t, uint32_t>> expectedCacheHits = { { 0, 0 }, { 0, 0 }, { 0, 2 }, { 2, 3 }, { 3, 3 }, { 2, 2 } };
+		EXPECT_EQ(cacheHits, expectedCacheHits);
+	}
+
+	TEST_P(OMMBakeTestCPU, CircleDigestReuse) {
+
+		// Validation reports how many work items each exact deduplication pass rehashed through the message interface.
+		std::vector<std::pair<uint32_t, uint32_t>> rehashes;
+		auto MessageCallback = [](omm::MessageSeverity severity, const char* message, void* userArg) {
+			uint32_t rehashCount = 0;
+			uint32_t workItemCount = 0;
+			if (std::strstr(message, "rehashed for exact deduplication") != nullptr && std::sscanf(message, "[Info] - %u of %u", &rehashCount, &workItemCount) == 2)
+				((std::vector<std::pair<uint32_t, uint32_t>>*)userArg)->push_back({ rehashCount, workItemCount });
+		};
+
+		EXPECT_EQ(omm::DestroyBaker(_baker), omm::Result::SUCCESS);
+		omm::BakerCreationDesc bakerDesc = { .type = omm::BakerType::CPU };
+		bakerDesc.messageInterface = { MessageCallback, &rehashes };
+		EXPECT_EQ(omm::CreateBaker(bakerDesc, &_baker), omm::Result::SUCCESS);
+
+		vmtest::TextureFP32 texture(1024, 1024, 1, EnableZOrder(), EnableAlphaCutoff() ? 0.5f : -1.f, &StandardCircle);
+		omm::Cpu::Texture tex = CreateTexture(texture.GetDesc());
+
+		uint32_t triangleIndices[9] = { 0, 1, 2, 3, 1, 2, 4, 5, 6 };
+		float texCoords[14] = { 0.f, 0.f,	0.f, 1.f,	1.f, 0.f,	 1.f, 1.f,	0.1f, 0.1f,	0.2f, 0.7f,	0.6f, 0.3f };
+
+		omm::Cpu::BakeInputDesc desc = GetBakeInputDesc(tex, 5, 9, triangleIndices, texCoords);
+		desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)desc.bakeFlags | (uint32_t)omm::Cpu::BakeFlags::EnableValidation);
+
+		omm::Cpu::BakeResult res = nullptr;
+		EXPECT_EQ(omm::Cpu::Bake(_baker, desc, &res), omm::Result::SUCCESS);
+		const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+		EXPECT_EQ(omm::Cpu::GetBakeResultDesc(res, &resDesc), omm::Result::SUCCESS);
+		ASSERT_NE(resDesc, nullptr);
+		const uint32_t arrayDataSize = resDesc->arrayDataSize;
+		EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+
+		// Without compression the states don't change after the first pass, which hashes every work item.
+		ASSERT_EQ(rehashes.size(), 1);
+		EXPECT_EQ(rehashes[0].first, rehashes[0].second);
+		EXPECT_GT(rehashes[0].first, 1u);
+		rehashes.clear();
+
+		// Just short of the space the states need, Compress downsamples some of the work items. Deduplicating again only
+		// rehashes those, the others keep their digests.
+		desc.maxArrayDataSize = arrayDataSize - 1;
+		BakeAndSerialize(desc);
+
+		ASSERT_EQ(rehashes.size(), 2);
+		EXPECT_EQ(rehashes[0].first, rehashes[0].second);
+		EXPECT_GT(rehashes[1].first, 0u);
+		EXPECT_LT(rehashes[1].first, rehashes[1].second);
+	}
+
+	TEST_P(OMMBakeTestCPU, CircleCoverageKernels) {
+
+		vmtest::TextureFP32 texture(1024, 1024, 1, EnableZOrder(), EnableAlphaCutoff() ? 0.5f : -1.f, &StandardCircle);
+		omm::Cpu::Texture tex = CreateTexture(texture.GetDesc());
+
+		// The quad extends past the texture to cover the clamped border texels as well.
+		uint32_t triangleIndices[6] = { 0, 1, 2, 3, 1, 2 };
+		float texCoords[8] = { -0.1f, -0.2f,	0.f, 1.1f,	1.2f, 0.05f,	 1.1f, 1.f };
+
+		auto Bake = [&](omm::TextureFilterMode filter, uint32_t internalFlags, omm::UnknownStatePromotion promotion) {
+			omm::Cpu::BakeInputDesc desc = GetBakeInputDesc(tex, 6, 6, triangleIndices, texCoords);
+			desc.runtimeSamplerDesc.filter = filter;
+			desc.unknownStatePromotion = promotion;
+			desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)desc.bakeFlags | internalFlags);
+			return BakeAndGetStats(desc);
+		};
+
+		// Internal bake flags selecting the conservative bilinear kernel instead of the default level line intersection.
+		const uint32_t kDisableLevelLineIntersection = 1u << 8;
+		const uint32_t kEnableAABBTesting = 1u << 7;
+
+		struct Case {
+			omm::TextureFilterMode filter;
+			uint32_t internalFlags;
+			omm::Debug::Stats expected;
+		};
+
+		const Case cases[] = {
+			{ omm::TextureFilterMode::Linear, 0, { .totalOpaque = 5105, .totalTransparent = 2793, .totalUnknownTransparent = 145, .totalUnknownOpaque = 149 } },
+			{ omm::TextureFilterMode::Nearest, 0, { .totalOpaque = 5106, .totalTransparent = 2794, .totalUnknownTransparent = 143, .totalUnknownOpaque = 149 } },
+			{ omm::TextureFilterMode::Linear, kDisableLevelLineIntersection, { .totalOpaque = 5094, .totalTransparent = 2781, .totalUnknownTransparent = 157, .totalUnknownOpaque = 160 } },
+			{ omm::TextureFilterMode::Linear, kDisableLevelLineIntersection | kEnableAABBTesting, { .totalOpaque = 5056, .totalTransparent = 2744, .totalUnknownTransparent = 202, .totalUnknownOpaque = 190 } },
+		};
+
+		for (const Case& c : cases)
+		{
+			// The nearest promotion needs the full texel counts.
+			const omm::Debug::Stats nearest = Bake(c.filter, c.internalFlags, omm::UnknownStatePromotion::Nearest);
+			EXPECT_EQ(nearest.totalOpaque, c.expected.totalOpaque);
+			EXPECT_EQ(nearest.totalTransparent, c.expected.totalTransparent);
+			EXPECT_EQ(nearest.totalUnknownTransparent, c.expected.totalUnknownTransparent);
+			EXPECT_EQ(nearest.totalUnknownOpaque, c.expected.totalUnknownOpaque);
+
+			// The forced promotions stop classifying as soon as the coverage is mixed, and must find the same unknowns.
+			const omm::Debug::Stats forceOpaque = Bake(c.filter, c.internalFlags, omm::UnknownStatePromotion::ForceOpaque);
+			EXPECT_EQ(forceOpaque.totalOpaque, nearest.totalOpaque);
+			EXPECT_EQ(forceOpaque.totalTransparent, nearest.totalTransparent);
+			EXPECT_EQ(forceOpaque.totalUnknownOpaque, nearest.totalUnknownOpaque + nearest.totalUnknownTransparent);
+			EXPECT_EQ(forceOpaque.totalUnknownTransparent, 0);
+
+			const omm::Debug::Stats forceTransparent = Bake(c.filter, c.internalFlags, omm::UnknownStatePromotion::ForceTransparent);
+			EXPECT_EQ(forceTransparent.totalOpaque, nearest.totalOpaque);
+			EXPECT_EQ(forceTransparent.totalTransparent, nearest.totalTransparent);
+			EXPECT_EQ(forceTransparent.totalUnknownTransparent, nearest.totalUnknownOpaque + nearest.totalUnknownTransparent);
+			EXPECT_EQ(forceTransparent.totalUnknownOpaque, 0);
+		}
+	}
+
+	TEST_P(OMMBakeTestCPU, CircleMinMaxPyramid) {
+
+		// Odd sized to cover the clamped edge nodes of the pyramid.
+		vmtest::TextureFP32 texture(1000, 600, 1, EnableZOrder(), EnableAlphaCutoff() ? 0.5f : -1.f, &StandardCircle);
+		vmtest::TextureFP32 textureMips(1024, 1024, 3, EnableZOrder(), EnableAlphaCutoff() ? 0.5f : -1.f, &StandardCircle);
+
+		uint32_t triangleIndices[9] = { 0, 1, 2, 3, 1, 2, 4, 5, 6 };
+		float texCoords[14] = { -0.1f, -0.2f,	0.f, 1.1f,	1.2f, 0.05f,	 1.1f, 1.f,	0.1f, 0.1f,	0.2f, 0.7f,	0.6f, 0.3f };
+
+		auto Bake = [&](omm::Cpu::Texture t, omm::TextureFilterMode filter, uint32_t internalFlags, omm::UnknownStatePromotion promotion) {
+			omm::Cpu::BakeInputDesc desc = GetBakeInputDesc(t, 6, 9, triangleIndices, texCoords);
+			desc.runtimeSamplerDesc.filter = filter;
+			desc.unknownStatePromotion = promotion;
+			desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)desc.bakeFlags | internalFlags);
+			return BakeAndSerialize(desc);
+		};
+
+		// The pyramids of the large mips are built on several threads.
+		auto CreatePyramidTexture = [&](omm::Cpu::TextureDesc desc) {
+			desc.flags = (omm::Cpu::TextureFlags)((uint32_t)desc.flags | (uint32_t)omm::Cpu::TextureFlags::EnableMinMaxPyramid | (uint32_t)omm::Cpu::TextureFlags::EnableInternalThreads);
+			return CreateTexture(desc);
+		};
+
+		// Internal bake flags selecting the conservative bilinear kernel instead of the default level line intersection.
+		const uint32_t kDisableLevelLineIntersection = 1u << 8;
+		const uint32_t kEnableAABBTesting = 1u << 7;
+
+		struct Case {
+			omm::TextureFilterMode filter;
+			uint32_t internalFlags;
+			bool mips;
+		};
+
+		const Case cases[] = {
+			{ omm::TextureFilterMode::Linear, 0, false },
+			{ omm::TextureFilterMode::Nearest, 0, false },
+			{ omm::TextureFilterMode::Linear, kDisableLevelLineIntersection, false },
+			{ omm::TextureFilterMode::Linear, kDisableLevelLineIntersection | kEnableAABBTesting, false },
+			{ omm::TextureFilterMode::Linear, 0, true },
+			{ omm::TextureFilterMode::Nearest, 0, true },
+		};
+
+		omm::Cpu::Texture tex = CreateTexture(texture.GetDesc());
+		omm::Cpu::Texture pyramidTex = CreatePyramidTexture(texture.GetDesc());
+		omm::Cpu::Texture texMips = CreateTexture(textureMips.GetDesc());
+		omm::Cpu::Texture pyramidTexMips = CreatePyramidTexture(textureMips.GetDesc());
+
+		// The pyramid only skips the rasterization of micro-triangles it can prove, the output must not change.
+		for (const Case& c : cases)
+		{
+			for (omm::UnknownStatePromotion promotion : { omm::UnknownStatePromotion::Nearest, omm::UnknownStatePromotion::ForceOpaque })
+			{
+				const std::vector<uint8_t> expected = Bake(c.mips ? texMips : tex, c.filter, c.internalFlags, promotion);
+				EXPECT_EQ(Bake(c.mips ? pyramidTexMips : pyramidTex, c.filter, c.internalFlags, promotion), expected);
+			}
+		}
+	}
+
+	TEST_P(OMMBakeTestCPU, CircleMinMaxPyramidSerialized) {
+
+		// The pyramid isn't serialized, the deserialized texture rebuilds it from the texels on the threads of the baker and
+		// must bake the same output.
+		vmtest::TextureFP32 texture(1000, 600, 1, EnableZOrder(), EnableAlphaCutoff() ? 0.5f : -1.f, &StandardCircle);
+		omm::Cpu::TextureDesc texDesc = texture.GetDesc();
+		texDesc.flags = (omm::Cpu::TextureFlags)((uint32_t)texDesc.flags | (uint32_t)omm::Cpu::TextureFlags::EnableMinMaxPyramid | (uint32_t)omm::Cpu::TextureFlags::EnableInternalThreads);
+		omm::Cpu::Texture tex = CreateTexture(texDesc);
+
+		uint32_t triangleIndices[9] = { 0, 1, 2, 3, 1, 2, 4, 5, 6 };
+		float texCoords[14] = { -0.1f, -0.2f,	0.f, 1.1f,	1.2f, 0.05f,	 1.1f, 1.f,	0.1f, 0.1f,	0.2f, 0.7f,	0.6f, 0.3f };
+
+		omm::Cpu::BakeInputDesc desc = GetBakeInputDesc(tex, 6, 9, triangleIndices, texCoords);
+		const std::vector<uint8_t> expected = BakeAndSerialize(desc);
+
+		omm::Cpu::DeserializedDesc dataToSerialize;
+		dataToSerialize.numInputDescs = 1;
+		dataToSerialize.inputDescs = &desc;
+
+		omm::Cpu::SerializedResult serializedRes = nullptr;
+		EXPECT_EQ(omm::Cpu::Serialize(_baker, dataToSerialize, &serializedRes), omm::Result::SUCCESS);
+		const omm::Cpu::BlobDesc* blob = nullptr;
+		EXPECT_EQ(omm::Cpu::GetSerializedResultDesc(serializedRes, &blob), omm::Result::SUCCESS);
+		ASSERT_NE(blob, nullptr);
+
+		omm::Cpu::DeserializedResult dRes = nullptr;
+		EXPECT_EQ(omm::Cpu::Deserialize(_baker, *blob, &dRes), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Cpu::DestroySerializedResult(serializedRes), omm::Result::SUCCESS);
+
+		const omm::Cpu::DeserializedDesc* desDesc = nullptr;
+		EXPECT_EQ(omm::Cpu::GetDeserializedDesc(dRes, &desDesc), omm::Result::SUCCESS);
+		ASSERT_NE(desDesc, nullptr);
+		ASSERT_EQ(desDesc->numInputDescs, 1);
+
+		EXPECT_EQ(BakeAndSerialize(desDesc->inputDescs[0]), expected);
+
+		EXPECT_EQ(omm::Cpu::DestroyDeserializedResult(dRes), omm::Result::SUCCESS);
+	}
+
+	TEST_P(OMMBakeTestCPU, CircleTiledTexture) {
+
+		// Morton order would pad 1000x333 to 1024x1024, so the Z-order texture is stored in 8x8 tiles instead. The partial
+		// tiles on the right and bottom edges must read back the same texels as the linear layout.
+		vmtest::TextureFP32 tiled(1000, 333, 3, true, EnableAlphaCutoff() ? 0.5f : -1.f, &StandardCircle);
+		vmtest::TextureFP32 linear(1000, 333, 3, false, EnableAlphaCutoff() ? 0.5f : -1.f, &StandardCircle);
+		vmtest::TextureUNORM8 tiledUNORM8(1000, 333, 3, true, EnableAlphaCutoff() ? 0.5f : -1.f, [](int i, int j, int w, int h, int mip) -> uint8_t {
+			return (uint8_t)(255.f * StandardCircle(i, j, w, h, mip));
+		});
+		vmtest::TextureUNORM8 linearUNORM8(1000, 333, 3, false, EnableAlphaCutoff() ? 0.5f : -1.f, [](int i, int j, int w, int h, int mip) -> uint8_t {
+			return (uint8_t)(255.f * StandardCircle(i, j, w, h, mip));
+		});
+
+		uint32_t triangleIndices[9] = { 0, 1, 2, 3, 1, 2, 4, 5, 6 };
+		float texCoords[14] = { -0.1f, -0.2f,	0.f, 1.1f,	1.2f, 0.05f,	 1.1f, 1.f,	0.1f, 0.1f,	0.2f, 0.7f,	0.6f, 0.3f };
+
+		auto Bake = [&](omm::Cpu::Texture t, omm::TextureFilterMode filter, omm::TextureAddressMode addressingMode) {
+			omm::Cpu::BakeInputDesc desc = GetBakeInputDesc(t, 6, 9, triangleIndices, texCoords);
+			desc.runtimeSamplerDesc.filter = filter;
+			desc.runtimeSamplerDesc.addressingMode = addressingMode;
+			return BakeAndSerialize(desc);
+		};
+
+		const omm::Cpu::Texture textures[][2] = {
+			{ CreateTexture(tiled.GetDesc()), CreateTexture(linear.GetDesc()) },
+			{ CreateTexture(tiledUNORM8.GetDesc()), CreateTexture(linearUNORM8.GetDesc()) },
+		};
+
+		for (const auto& pair : textures)
+		{
+			for (omm::TextureFilterMode filter : { omm::TextureFilterMode::Linear, omm::TextureFilterMode::Nearest })
+			{
+				for (omm::TextureAddressMode addressingMode : { omm::TextureAddressMode::Clamp, omm::TextureAddressMode::Wrap, omm::TextureAddressMode::Mirror })
+				{
+					EXPECT_EQ(Bake(pair[0], filter, addressingMode), Bake(pair[1], filter, addressingMode))
+						<< "filter " << (uint32_t)filter << " addressingMode " << (uint32_t)addressingMode;
+				}
+			}
+		}
+	}
+
+	TEST_P(OMMBakeTestCPU, CircleAllDispatchCombinations) {
+
+		// Binary alpha reads the same as FP32 and UNORM8, so every format and tiling of a size must bake the same output.
+		auto Circle = [](int i, int j, int w, int h, int mip) -> float {
+			return glm::length(float2(i, j) / float2((float)w, (float)h) - 0.5f) < 0.4f ? 0.f : 1.f;
+		};
+
+		uint32_t triangleIndices[9] = { 0, 1, 2, 3, 1, 2, 4, 5, 6 };
+		float texCoords[14] = { -0.1f, -0.2f,	0.f, 1.1f,	1.2f, 0.05f,	 1.1f, 1.f,	0.1f, 0.1f,	0.2f, 0.7f,	0.6f, 0.3f };
+
+		auto Bake = [&](omm::Cpu::Texture t, omm::TextureFilterMode filter, omm::TextureAddressMode addressingMode) {
+			omm::Cpu::BakeInputDesc desc = GetBakeInputDesc(t, 5, 9, triangleIndices, texCoords);
+			desc.runtimeSamplerDesc.filter = filter;
+			desc.runtimeSamplerDesc.addressingMode = addressingMode;
+			return BakeAndSerialize(desc);
+		};
+
+		const omm::TextureAddressMode addressingModes[] = {
+			omm::TextureAddressMode::Wrap,
+			omm::TextureAddressMode::Mirror,
+			omm::TextureAddressMode::Clamp,
+			omm::TextureAddressMode::Border,
+			omm::TextureAddressMode::MirrorOnce,
+		};
+
+		// Power of two and Morton ordered, Morton ordered, tiled.
+		for (int2 size : { int2(1024, 1024), int2(1000, 1000), int2(1000, 333) })
+		{
+			const float alphaCutoff = EnableAlphaCutoff() ? 0.5f : -1.f;
+			vmtest::TextureFP32 linear(size.x, size.y, 1, false, alphaCutoff, Circle);
+			vmtest::TextureFP32 zOrder(size.x, size.y, 1, true, alphaCutoff, Circle);
+			vmtest::TextureUNORM8 linearUNORM8(size.x, size.y, 1, false, alphaCutoff, [&](int i, int j, int w, int h, int mip) -> uint8_t {
+				return Circle(i, j, w, h, mip) == 0.f ? 0 : 255;
+			});
+			vmtest::TextureUNORM8 zOrderUNORM8(size.x, size.y, 1, true, alphaCutoff, [&](int i, int j, int w, int h, int mip) -> uint8_t {
+				return Circle(i, j, w, h, mip) == 0.f ? 0 : 255;
+			});
+
+			const omm::Cpu::Texture reference = CreateTexture(linear.GetDesc());
+			const omm::Cpu::Texture textures[] = { CreateTexture(zOrder.GetDesc()), CreateTexture(linearUNORM8.GetDesc()), CreateTexture(zOrderUNORM8.GetDesc()) };
+
+			for (omm::TextureFilterMode filter : { omm::TextureFilterMode::Linear, omm::TextureFilterMode::Nearest })
+			{
+				for (omm::TextureAddressMode addressingMode : addressingModes)
+				{
+					const std::vector<uint8_t> expected = Bake(reference, filter, addressingMode);
+					for (uint32_t texIt = 0; texIt < std::size(textures); ++texIt)
+					{
+						EXPECT_EQ(Bake(textures[texIt], filter, addressingMode), expected) << size.x << "x" << size.y << " texture " << texIt
+							<< " filter " << (uint32_t)filter << " addressingMode " << (uint32_t)addressingMode;
+					}
+				}
+			}
+		}
+	}
+
+	TEST_P(OMMBakeTestCPU, CircleSmallWorkload) {
+
+		vmtest::TextureFP32 texture(1024, 1024, 1, EnableZOrder(), EnableAlphaCutoff() ? 0.5f : -1.f, &StandardCircle);
+		omm::Cpu::Texture tex = CreateTexture(texture.GetDesc());
+
+		// 8x4 quads, 64 triangles, the largest workload that takes the small workload path.
+		static constexpr uint32_t kCellsX = 8;
+		static constexpr uint32_t kCellsY = 4;
+		std::vector<float> texCoords;
+		for (uint32_t j = 0; j <= kCellsY; ++j)
+		{
+			for (uint32_t i = 0; i <= kCellsX; ++i)
+			{
+				texCoords.push_back(i / (float)kCellsX);
+				texCoords.push_back(j / (float)kCellsY);
+			}
+		}
+
+		std::vector<uint32_t> indices;
+		for (uint32_t j = 0; j < kCellsY; ++j)
+		{
+			for (uint32_t i = 0; i < kCellsX; ++i)
+			{
+				const uint32_t v = i + j * (kCellsX + 1);
+				indices.insert(indices.end(), { v, v + 1, v + kCellsX + 1 });
+				indices.insert(indices.end(), { v + 1, v + kCellsX + 2, v + kCellsX + 1 });
+			}
+		}
+		ASSERT_EQ(indices.size(), 64 * 3);
+
+		// One more triangle inside the transparent disc. It adds a work item, which moves the bake off the small workload path,
+		// but only a special index to the output.
+		std::vector<float> largeTexCoords = texCoords;
+		largeTexCoords.insert(largeTexCoords.end(), { 0.45f, 0.45f,	0.55f, 0.45f,	0.5f, 0.55f });
+		std::vector<uint32_t> largeIndices = indices;
+		const uint32_t firstVertex = (uint32_t)texCoords.size() / 2;
+		largeIndices.insert(largeIndices.end(), { firstVertex, firstVertex + 1, firstVertex + 2 });
+
+		struct Case {
+			uint32_t bakeFlags;
+			uint32_t maxArrayDataSize;
+		};
+
+		// Internal threads only start when the workload is large enough, and a maxArrayDataSize that can't be reached runs the
+		// passes that are otherwise skipped. Neither may change the output.
+		const Case cases[] = {
+			{ 0, 0xFFFFFFFF },
+			{ (uint32_t)omm::Cpu::BakeFlags::EnableInternalThreads, 0xFFFFFFFF },
+			{ 0, 0xFFFFFFFE },
+			{ (uint32_t)omm::Cpu::BakeFlags::EnableInternalThreads, 0xFFFFFFFE },
+		};
+
+		auto Bake = [&](const std::vector<uint32_t>& triangleIndices, const std::vector<float>& uvs, const Case& c) {
+			omm::Cpu::BakeInputDesc desc = GetBakeInputDesc(tex, 4, (uint32_t)triangleIndices.size(), triangleIndices.data(), uvs.data());
+			desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)desc.bakeFlags | c.bakeFlags);
+			desc.maxArrayDataSize = c.maxArrayDataSize;
+			return BakeAndSerialize(desc);
+		};
+
+		const std::vector<uint8_t> expected = Bake(indices, texCoords, cases[0]);
+		for (const Case& c : cases)
+		{
+			EXPECT_EQ(Bake(indices, texCoords, c), expected) << "bakeFlags " << c.bakeFlags << " maxArrayDataSize " << c.maxArrayDataSize;
+
+			// The large workload output is the small workload output followed by the FullyTransparent index of the extra triangle.
+			const std::vector<uint8_t> large = Bake(largeIndices, largeTexCoords, c);
+			ASSERT_GT(large.size(), expected.size());
+			const size_t indexSize = large.size() - expected.size();
+			EXPECT_TRUE(indexSize == 2 || indexSize == 4) << indexSize;
+			EXPECT_TRUE(std::equal(expected.begin(), expected.end(), large.begin())) << "bakeFlags " << c.bakeFlags << " maxArrayDataSize " << c.maxArrayDataSize;
+			EXPECT_TRUE(std::all_of(large.begin() + expected.size(), large.end(), [](uint8_t b) { return b == 0xFF; }));
+		}
+	}
+
+	TEST_P(OMMBakeTestCPU, GradientAnyCutoff) {
+
+		auto Gradient = [](int i, int j, int w, int h, int mip) -> float {
+			const float2 uv = float2(i, j) / float2((float)w, (float)h);
+			return glm::clamp(1.4f * glm::length(uv - 0.5f) + 0.1f * std::sin(20.f * uv.x), 0.f, 1.f);
+		};
+
+		// One texture with the pyramid, created at a cutoff it is not baked with.
+		vmtest::TextureFP32 texture(1024, 1024, 1, EnableZOrder(), 0.1f, Gradient);
+		omm::Cpu::TextureDesc pyramidDesc = texture.GetDesc();
+		pyramidDesc.flags = (omm::Cpu::TextureFlags)((uint32_t)pyramidDesc.flags | (uint32_t)omm::Cpu::TextureFlags::EnableMinMaxPyramid);
+		omm::Cpu::Texture pyramidTex = CreateTexture(pyramidDesc);
+
+		uint32_t triangleIndices[6] = { 0, 1, 2, 3, 1, 2 };
+		float texCoords[8] = { 0.f, 0.f,	0.f, 1.f,	1.f, 0.f,	 1.f, 1.f };
+
+		auto Bake = [&](omm::Cpu::Texture t, float alphaCutoff) {
+			omm::Cpu::BakeInputDesc desc = GetBakeInputDesc(t, 6, 6, triangleIndices, texCoords);
+			desc.alphaCutoff = alphaCutoff;
+			return BakeAndSerialize(desc);
+		};
+
+		// Each cutoff must match a bake with the SAT built for exactly that cutoff.
+		for (float alphaCutoff : { 0.3f, 0.5f, 0.7f })
+		{
+			vmtest::TextureFP32 reference(1024, 1024, 1, EnableZOrder(), alphaCutoff, Gradient);
+			omm::Cpu::Texture referenceTex = CreateTexture(reference.GetDesc());
+			EXPECT_EQ(Bake(pyramidTex, alphaCutoff), Bake(referenceTex, alphaCutoff)) << "alphaCutoff " << alphaCutoff;
+		}
+	}
+
+	TEST_P(OMMBakeTestCPU, CircleBatch) {
+
+		vmtest::TextureFP32 texture(1024, 1024, 1, EnableZOrder(), EnableAlphaCutoff() ? 0.5f : -1.f, &StandardCircle);
+		omm::Cpu::Texture tex = CreateTexture(texture.GetDesc());
+
+		// Two meshes sharing the texture: the standard quad, and the same quad plus a triangle over the top left corner.
+		float texCoords[12] = { 0.f, 0.f,	0.f, 1.f,	1.f, 0.f,	 1.f, 1.f,	0.f, 0.5f,	0.5f, 0.f };
+		uint32_t triangleIndices0[6] = { 0, 1, 2, 3, 1, 2 };
+		uint32_t triangleIndices1[9] = { 0, 1, 2, 3, 1, 2, 0, 4, 5 };
+
+		omm::Cpu::BakeInputDesc descs[2] = {
+			GetBakeInputDesc(tex, 4, 6, triangleIndices0, texCoords),
+			GetBakeInputDesc(tex, 4, 9, triangleIndices1, texCoords),
+		};
+
+		omm::Debug::Stats expectedStats[2];
+		uint32_t expectedDescArrayCount = 0;
+		for (uint32_t i = 0; i < 2; ++i)
+		{
+			omm::Cpu::BakeResult res = nullptr;
+			const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+			EXPECT_EQ(omm::Cpu::Bake(_baker, descs[i], &res), omm::Result::SUCCESS);
+			EXPECT_EQ(omm::Cpu::GetBakeResultDesc(res, &resDesc), omm::Result::SUCCESS);
+			EXPECT_EQ(omm::Debug::GetStats(_baker, resDesc, &expectedStats[i]), omm::Result::SUCCESS);
+			// The second mesh contains every UV-triangle of the first.
+			expectedDescArrayCount = std::max(expectedDescArrayCount, resDesc->descArrayCount);
+			EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+		}
+
+		omm::Cpu::BakeResult res = nullptr;
+		EXPECT_EQ(omm::Cpu::BakeBatch(_baker, descs, 2, &res), omm::Result::SUCCESS);
+
+		const omm::Cpu::BakeResultDesc* resDescs = nullptr;
+		uint32_t resDescCount = 0;
+		EXPECT_EQ(omm::Cpu::GetBakeBatchResultDesc(res, &resDescs, &resDescCount), omm::Result::SUCCESS);
+		EXPECT_EQ(resDescCount, 2u);
+
+		const omm::Cpu::BakeResultDesc* firstResDesc = nullptr;
+		EXPECT_EQ(omm::Cpu::GetBakeResultDesc(res, &firstResDesc), omm::Result::SUCCESS);
+		EXPECT_EQ(firstResDesc, &resDescs[0]);
+
+		EXPECT_EQ(resDescs[0].arrayData, resDescs[1].arrayData);
+		EXPECT_EQ(resDescs[0].descArray, resDescs[1].descArray);
+		EXPECT_EQ(resDescs[0].descArrayCount, expectedDescArrayCount);
+		EXPECT_EQ(resDescs[0].indexCount, 2u);
+		EXPECT_EQ(resDescs[1].indexCount, 3u);
+
+		for (uint32_t i = 0; i < 2; ++i)
+		{
+			omm::Debug::Stats stats;
+			EXPECT_EQ(omm::Debug::GetStats(_baker, &resDescs[i], &stats), omm::Result::SUCCESS);
+			ExpectEqual(stats, expectedStats[i]);
+			omm::Test::ValidateHistograms(&resDescs[i]);
+		}
+
+		EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+
+		// Deduplication runs across all inputs, so they must agree on the bake flags.
+		descs[1].bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)descs[1].bakeFlags | (uint32_t)omm::Cpu::BakeFlags::DisableSpecialIndices);
+		EXPECT_EQ(omm::Cpu::BakeBatch(_baker, descs, 2, &res), omm::Result::INVALID_ARGUMENT);
+
+		// A small input next to a large one: its indices address the shared OMM array, which holds more OMMs than the small
+		// input has triangles.
+		const uint32_t gridSize = 32;
+		std::vector<float> gridTexCoords;
+		for (uint32_t y = 0; y <= gridSize; ++y)
+		{
+			for (uint32_t x = 0; x <= gridSize; ++x)
+			{
+				gridTexCoords.push_back((float)x / gridSize);
+				gridTexCoords.push_back((float)y / gridSize);
+			}
+		}
+
+		std::vector<uint32_t> gridIndices;
+		for (uint32_t y = 0; y < gridSize; ++y)
+		{
+			for (uint32_t x = 0; x < gridSize; ++x)
+			{
+				const uint32_t i00 = y * (gridSize + 1) + x;
+				const uint32_t i10 = i00 + 1;
+				const uint32_t i01 = i00 + gridSize + 1;
+				const uint32_t i11 = i01 + 1;
+				gridIndices.insert(gridIndices.end(), { i00, i01, i10, i11, i10, i01 });
+			}
+		}
+
+		// Every 17th triangle of the grid, fewer than 128 in total.
+		std::vector<uint32_t> sparseIndices;
+		for (uint32_t triIt = 0; triIt < (uint32_t)gridIndices.size() / 3; triIt += 17)
+			sparseIndices.insert(sparseIndices.end(), gridIndices.begin() + 3 * triIt, gridIndices.begin() + 3 * triIt + 3);
+		EXPECT_LT(sparseIndices.size() / 3, 128u);
+
+		for (omm::Cpu::BakeInputDesc& desc : descs)
+		{
+			desc.texCoords = gridTexCoords.data();
+			desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)descs[0].bakeFlags | (uint32_t)omm::Cpu::BakeFlags::Allow8BitIndices);
+		}
+		descs[0].indexBuffer = sparseIndices.data();
+		descs[0].indexCount = (uint32_t)sparseIndices.size();
+		descs[1].indexBuffer = gridIndices.data();
+		descs[1].indexCount = (uint32_t)gridIndices.size();
+
+		const omm::Debug::Stats expectedSparseStats = BakeAndGetStats(descs[0]);
+
+		EXPECT_EQ(omm::Cpu::BakeBatch(_baker, descs, 2, &res), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Cpu::GetBakeBatchResultDesc(res, &resDescs, &resDescCount), omm::Result::SUCCESS);
+		EXPECT_GT(resDescs[0].descArrayCount, 127u);
+
+		const omm::Cpu::BakeResultDesc& sparseDesc = resDescs[0];
+		EXPECT_EQ(sparseDesc.indexFormat, Force32BitIndices() ? omm::IndexFormat::UINT_32 : omm::IndexFormat::UINT_16);
+
+		int32_t maxIndex = -1;
+		for (uint32_t i = 0; i < sparseDesc.indexCount; ++i)
+		{
+			const int32_t index = sparseDesc.indexFormat == omm::IndexFormat::UINT_16 ? ((const int16_t*)sparseDesc.indexBuffer)[i] : ((const int32_t*)sparseDesc.indexBuffer)[i];
+			maxIndex = std::max(maxIndex, index);
+		}
+		EXPECT_GT(maxIndex, 127);
+
+		omm::Debug::Stats sparseStats;
+		EXPECT_EQ(omm::Debug::GetStats(_baker, &sparseDesc, &sparseStats), omm::Result::SUCCESS);
+		ExpectEqual(sparseStats, expectedSparseStats);
+		omm::Test::ValidateHistograms(&sparseDesc);
+
+		EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+	}
+
 	TEST_P(OMMBakeTestCPU, CircleMergeSimilar) {
 
 		uint32_t subdivisionLevel = 4;
@@ -1576,6 +2718,34 @@ namespace {
 			});
 	}
 
+	TEST_P(OMMBakeTestCPU, HexagonsReuseLvl3_Streaming) {
+
+		uint32_t subdivisionLevel = 3;
+
+		omm::Debug::Stats stats = GetHexagonsReuseStats(subdivisionLevel, { .format = omm::Format::OC1_4_State, .maxWorkingSetBytes = 4096 });
+
+		// Same as HexagonsReuseLvl3.
+		ExpectEqual(stats, {
+			.totalOpaque = 40134,
+			.totalTransparent = 250,
+			.totalUnknownTransparent = 11939,
+			.totalUnknownOpaque = 13213,
+			});
+
+		// Chunk boundaries don't change the OMM of any primitive.
+		std::vector<uint32_t> indices;
+		std::vector<float2> texCoords;
+		GetHexagonsReuseMesh(indices, texCoords);
+
+		vmtest::TextureFP32 texture(1024, 1024, 1, EnableZOrder(), EnableAlphaCutoff() ? 0.5f : -1.f, &Hexagons);
+		omm::Cpu::Texture tex = CreateTexture(texture.GetDesc());
+
+		omm::Cpu::BakeInputDesc desc = GetBakeInputDesc(tex, subdivisionLevel, (uint32_t)indices.size(), indices.data(), (const float*)texCoords.data());
+		const std::vector<std::vector<uint8_t>> expected = BakeAndGetPrimitiveOmms(desc);
+		desc.maxWorkingSetBytes = 4096;
+		EXPECT_EQ(BakeAndGetPrimitiveOmms(desc), expected);
+	}
+
 	TEST_P(OMMBakeTestCPU, HexagonsReuseLvl4) {
 
 		uint32_t subdivisionLevel = 4;
@@ -1710,14 +2880,41 @@ namespace {
 			}, { .format = omm::Format::OC1_4_State, .mergeSimilar = true });
 
 		ExpectEqual(stats, {
-			.totalOpaque = 170724,
-			.totalTransparent = 11380,
-			.totalUnknownTransparent = 37864,
-			.totalUnknownOpaque = 39104,
-			.totalFullyTransparent = 12,
+			.totalOpaque = 172854,
+			.totalTransparent = 11500,
+			.totalUnknownTransparent = 38296,
+			.totalUnknownOpaque = 39494,
 			});
 	}
 
+	TEST_P(OMMBakeTestCPU, HexagonsReuseExact) {
+
+		omm::Debug::Stats stats = GetHexagonsReuseStats(4, { .format = omm::Format::OC1_4_State, .mergeSimilarExact = true });
+
+		ExpectEqual(stats, {
+			.totalOpaque = 184868,
+			.totalTransparent = 15900,
+			.totalUnknownTransparent = 32384,
+			.totalUnknownOpaque = 28992,
+			});
+	}
+
+	TEST_P(OMMBakeTestCPU, NearDuplicateDetectionExactRequiresNearDuplicateDetection) {
+
+		vmtest::TextureFP32 texture(256, 256, 1, EnableZOrder(), EnableAlphaCutoff() ? 0.5f : -1.f, &StandardCircle);
+		omm::Cpu::Texture tex = CreateTexture(texture.GetDesc());
+
+		uint32_t triangleIndices[6] = { 0, 1, 2, 3, 1, 2 };
+		float texCoords[8] = { 0.f, 0.f,	0.f, 1.f,	1.f, 0.f,	 1.f, 1.f };
+
+		omm::Cpu::BakeInputDesc desc = GetBakeInputDesc(tex, 4, 6, triangleIndices, texCoords);
+		desc.bakeFlags = (omm::Cpu::BakeFlags)((uint32_t)desc.bakeFlags | (uint32_t)omm::Cpu::BakeFlags::EnableNearDuplicateDetectionExact);
+
+		omm::Cpu::BakeResult res = nullptr;
+		EXPECT_EQ(omm::Cpu::Bake(_baker, desc, &res), omm::Result::INVALID_ARGUMENT);
+		EXPECT_EQ(res, nullptr);
+	}
+
 	TEST_P(OMMBakeTestCPU, Leaflet_Alpha_0_2) {
 
 		omm::Debug::Stats stats = LeafletMipN(0, 1, 0.2f);
@@ -167,12 +167,13 @@ namespace {
 		Bake(desc, { "[Invalid Argument] - maxSubdivisionLevel (13) is greater than maximum supported (12)" }, omm::Result::INVALID_ARGUMENT);
 	}
 
-	TEST_F(LogTest, InvalidParameter_AlphaCutoff)
+	TEST_F(LogTest, PerfWarning_AlphaCutoffMismatch)
 	{
 		InitBaker(true /*set callback*/);
 		omm::Cpu::BakeInputDesc desc = CreateDefaultBakeInputDesc();
 		desc.alphaCutoff = 0.4f;
-		Bake(desc, { "[Invalid Argument] - Texture object alpha cutoff threshold (0.300000) is different from alpha cutoff threshold in bake input (0.400000)" }, omm::Result::INVALID_ARGUMENT);
+		Bake(desc, { "[Perf Warning] - Texture object alpha cutoff threshold (0.300000) is different from alpha cutoff threshold in bake input (0.400000),"
+					 " its SAT can't be used. Set EnableMinMaxPyramid to bake a texture at several cutoffs." }, omm::Result::SUCCESS);
 	}
 
 	TEST_F(LogTest, InvalidParameter_AlphaCutoffInvalid)
@@ -186,6 +187,15 @@ namespace {
 		Bake(desc, { "[Invalid Argument] - alphaCutoffLessEqual=UnknownOpaque is not compatible with OC1_2_State" }, omm::Result::INVALID_ARGUMENT);
 	}
 
+	TEST_F(LogTest, InvalidParameter_MaxWorkingSetBytes)
+	{
+		InitBaker(true /*set callback*/);
+		omm::Cpu::BakeInputDesc desc = CreateDefaultBakeInputDesc();
+		desc.maxWorkingSetBytes = 1024 * 1024;
+		desc.maxArrayDataSize = 1024;
+		Bake(desc, { "[Invalid Argument] - maxWorkingSetBytes can't be used together with maxArrayDataSize" }, omm::Result::INVALID_ARGUMENT);
+	}
+
 	TEST_F(LogTest, PerfWarning_HugeWorkload)
 	{
 		InitBaker(true /*set callback*/);
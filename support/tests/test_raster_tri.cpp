@@ -15,6 +15,7 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 #include <omp.h>
 #include <algorithm>
 #include <filesystem>
+#include <random>
 
 namespace {
 
@@ -219,6 +220,100 @@ TEST_P(RasterTest, RasterizeConservativeSuperLarge) {
 	Run({ _size.x * 4, _size.y * 4, }, omm::RasterMode::OverConservative, false);
 }
 
+TEST(RasterSimd, MatchesScalar) {
+
+	const omm::raster::SimdLevel maxLevel = omm::raster::GetSimdLevel();
+	std::vector<omm::raster::SimdLevel> levels;
+	for (omm::raster::SimdLevel level : { omm::raster::SimdLevel::SSE, omm::raster::SimdLevel::NEON, omm::raster::SimdLevel::AVX2, omm::raster::SimdLevel::AVX512 })
+	{
+		if (level <= maxLevel)
+			levels.push_back(level);
+	}
+
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> pos(-0.1f, 1.1f);
+	std::uniform_real_distribution<float> scale(0.001f, 1.f);
+
+	auto Rasterize = [](omm::raster::SimdLevel level, const omm::Triangle& t, int2 size) {
+		std::vector<int2> pixels;
+		auto kernel = [&pixels](int2 idx, void*) {
+			pixels.push_back(idx);
+		};
+		omm::RasterizeTriImpl<omm::RasterMode::OverConservative, false, false>(level, t, size, float2(-0.5f, -0.5f), kernel);
+		return pixels;
+	};
+
+	// Expands the row segments of the span rasterizer to pixels.
+	auto RasterizeSpans = [](omm::raster::SimdLevel level, const omm::Triangle& t, int2 size) {
+		std::vector<int2> pixels;
+		auto kernel = [&pixels](int2 start, int count, void*) {
+			for (int x = 0; x < count; ++x)
+				pixels.push_back(start + int2(x, 0));
+			return true;
+		};
+		omm::RasterizeConservativeSpansImpl(level, t, size, float2(-0.5f, -0.5f), kernel);
+		return pixels;
+	};
+
+	for (uint32_t i = 0; i < 2000; ++i)
+	{
+		// Mostly small triangles, as produced by micro-triangle subdivision, with the occasional large one.
+		const float s = scale(rng) * scale(rng);
+		const float2 p0 = { pos(rng), pos(rng) };
+		const omm::Triangle t(p0, p0 + s * float2(pos(rng) - 0.5f, pos(rng) - 0.5f), p0 + s * float2(pos(rng) - 0.5f, pos(rng) - 0.5f));
+		if (t.GetIsDegenerate())
+			continue;
+
+		const int2 size = int2(16 << (i % 7), 16 << ((i / 7) % 7));
+		const std::vector<int2> expected = Rasterize(omm::raster::SimdLevel::Scalar, t, size);
+		for (omm::raster::SimdLevel level : levels)
+		{
+			EXPECT_EQ(Rasterize(level, t, size), expected) << "triangle " << i << " level " << (int)level;
+		}
+
+		levels.push_back(omm::raster::SimdLevel::Scalar);
+		for (omm::raster::SimdLevel level : levels)
+		{
+			EXPECT_EQ(RasterizeSpans(level, t, size), expected) << "triangle " << i << " level " << (int)level;
+		}
+		levels.pop_back();
+	}
+}
+
+TEST(RasterSimd, KernelStop) {
+
+	const omm::raster::SimdLevel maxLevel = omm::raster::GetSimdLevel();
+	std::vector<omm::raster::SimdLevel> levels = { omm::raster::SimdLevel::Scalar };
+	for (omm::raster::SimdLevel level : { omm::raster::SimdLevel::SSE, omm::raster::SimdLevel::NEON, omm::raster::SimdLevel::AVX2, omm::raster::SimdLevel::AVX512 })
+	{
+		if (level <= maxLevel)
+			levels.push_back(level);
+	}
+
+	const omm::Triangle t(float2(0.1f, 0.1f), float2(0.9f, 0.2f), float2(0.4f, 0.9f));
+	const int2 size = int2(64, 64);
+
+	// Returning false from the kernel stops the traversal after the current pixel.
+	for (omm::raster::SimdLevel level : levels)
+	{
+		std::vector<int2> pixels;
+		auto kernel = [&pixels](int2 idx, void*) {
+			pixels.push_back(idx);
+			return pixels.size() < 37;
+		};
+		omm::RasterizeTriImpl<omm::RasterMode::OverConservative, false, false>(level, t, size, float2(-0.5f, -0.5f), kernel);
+		EXPECT_EQ(pixels.size(), 37u) << "level " << (int)level;
+	}
+
+	std::vector<int2> pixels;
+	auto kernel = [&pixels](int2 idx, void*) {
+		pixels.push_back(idx);
+		return pixels.size() < 5;
+	};
+	omm::RasterizeConservativeLineWithOffset(omm::Line(float2(0.1f, 0.1f), float2(0.9f, 0.9f)), size, float2(-0.5f, -0.5f), kernel);
+	EXPECT_EQ(pixels.size(), 5u);
+}
+
 INSTANTIATE_TEST_SUITE_P(
 	RasterContained,
 	RasterTest,
@@ -402,4 +402,25 @@ namespace {
 		SubdivideTrianlge("Rot", omm::Triangle(float2(0.675f, 0.05f), float2(0.125f, 0.985f), float2(0.675f, 0.985f)));
 	}
 
+	TEST(SubdivideTriangle, Hierarchy) {
+		// The micro-triangles under a coarser level triangle are a contiguous range of the bird curve and lie within it,
+		// the hierarchical classification relies on both.
+		const omm::Triangle t(float2(0.675f, 0.05f), float2(0.125f, 0.985f), float2(0.675f, 0.985f));
+		for (uint32_t level = 1; level <= 6; ++level) {
+			for (uint32_t parentLevel = 0; parentLevel < level; ++parentLevel) {
+				const uint32_t numLeaves = 1u << (2u * (level - parentLevel));
+				for (uint32_t parentIt = 0; parentIt < (1u << (2u * parentLevel)); ++parentIt) {
+					const omm::Triangle parent = omm::bird::GetMicroTriangle(t, parentIt, parentLevel);
+					for (uint32_t childIt = parentIt * numLeaves; childIt < (parentIt + 1) * numLeaves; ++childIt) {
+						const omm::Triangle child = omm::bird::GetMicroTriangle(t, childIt, level);
+						EXPECT_GE(child.aabb_s.x, parent.aabb_s.x - 1e-6f);
+						EXPECT_GE(child.aabb_s.y, parent.aabb_s.y - 1e-6f);
+						EXPECT_LE(child.aabb_e.x, parent.aabb_e.x + 1e-6f);
+						EXPECT_LE(child.aabb_e.y, parent.aabb_e.y + 1e-6f);
+					}
+				}
+			}
+		}
+	}
+
 }  // namespace
\ No newline at end of file
@@ -10,7 +10,13 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 
 #include <gtest/gtest.h>
 #include "util/texture.h"
+#include "util/block_compression.h"
 #include <omm.h>
+#include <omm.hpp>
+
+#include <cstring>
+#include <random>
+#include <vector>
 
 namespace {
 
@@ -264,4 +270,318 @@ namespace {
 		TexCoordTest(omm::TextureAddressMode::MirrorOnce, { 16, 16 }, { 8, 8 },  { 7, 7 });
 		TexCoordTest(omm::TextureAddressMode::MirrorOnce, { 32, 32 }, { 8, 8 },  { 7, 7 });
 	}
-}
\ No newline at end of file
+
+	TEST(Texture, CreateRoundTrip) {
+
+		omm::Baker baker = 0;
+		EXPECT_EQ(omm::CreateBaker({ .type = omm::BakerType::CPU }, &baker), omm::Result::SUCCESS);
+
+		std::mt19937 rng(42);
+
+		const omm::Cpu::TextureFlags flagCombinations[] = {
+			omm::Cpu::TextureFlags::None,
+			omm::Cpu::TextureFlags::DisableZOrder,
+			omm::Cpu::TextureFlags::EnableInternalThreads,
+			(omm::Cpu::TextureFlags)((uint32_t)omm::Cpu::TextureFlags::DisableZOrder | (uint32_t)omm::Cpu::TextureFlags::EnableInternalThreads),
+		};
+
+		// Non-square and not a multiple of the swizzle block size, large enough to be built on several threads with
+		// EnableInternalThreads.
+		for (int2 size : { int2(1000, 333), int2(37, 1030), int2(512, 512) })
+		{
+			for (omm::Cpu::TextureFormat format : { omm::Cpu::TextureFormat::UNORM8, omm::Cpu::TextureFormat::FP32 })
+			{
+				for (omm::Cpu::TextureFlags flags : flagCombinations)
+				{
+					const size_t sizePerPixel = format == omm::Cpu::TextureFormat::FP32 ? sizeof(float) : sizeof(uint8_t);
+					std::vector<uint8_t> data(sizePerPixel * size.x * size.y);
+					for (size_t i = 0; i < data.size(); i += sizePerPixel)
+					{
+						if (format == omm::Cpu::TextureFormat::FP32)
+						{
+							const float alpha = std::uniform_real_distribution<float>(0.f, 1.f)(rng);
+							std::memcpy(&data[i], &alpha, sizeof(float));
+						}
+						else
+							data[i] = (uint8_t)std::uniform_int_distribution<int>(0, 255)(rng);
+					}
+
+					omm::Cpu::TextureMipDesc mip;
+					mip.width = size.x;
+					mip.height = size.y;
+					mip.textureData = data.data();
+
+					omm::Cpu::TextureDesc desc;
+					desc.format = format;
+					desc.flags = flags;
+					desc.mips = &mip;
+					desc.mipCount = 1;
+					desc.alphaCutoff = 0.5f;
+
+					omm::Cpu::Texture tex = 0;
+					EXPECT_EQ(omm::Cpu::CreateTexture(baker, desc, &tex), omm::Result::SUCCESS);
+
+					std::vector<uint8_t> readBack(data.size());
+					omm::Cpu::TextureMipDesc outMip;
+					outMip.textureData = readBack.data();
+					omm::Cpu::TextureDesc outDesc;
+					outDesc.mips = &outMip;
+					EXPECT_EQ(omm::Cpu::GetTextureDesc(tex, &outDesc), omm::Result::SUCCESS);
+					EXPECT_EQ(outMip.width, (uint32_t)size.x);
+					EXPECT_EQ(outMip.height, (uint32_t)size.y);
+					EXPECT_EQ(readBack, data) << size.x << "x" << size.y << " flags " << (uint32_t)flags;
+
+					EXPECT_EQ(omm::Cpu::DestroyTexture(baker, tex), omm::Result::SUCCESS);
+				}
+			}
+		}
+
+		EXPECT_EQ(omm::DestroyBaker(baker), omm::Result::SUCCESS);
+	}
+
+	TEST(Texture, TiledIndexRoundTrip) {
+
+		for (int2 size : { int2(1000, 333), int2(37, 1030), int2(13, 5), int2(64, 64) })
+		{
+			const int2 tiledSize = (size + omm::kTexelTileSize - 1) & ~(omm::kTexelTileSize - 1);
+			std::vector<uint8_t> visited(size_t(tiledSize.x) * tiledSize.y, 0);
+
+			for (int j = 0; j < size.y; ++j)
+			{
+				for (int i = 0; i < size.x; ++i)
+				{
+					const uint32_t idx = omm::GetTiledIndex(int2(i, j), size);
+					ASSERT_LT(idx, visited.size()) << size.x << "x" << size.y << " at " << i << ", " << j;
+					EXPECT_EQ(visited[idx], 0) << size.x << "x" << size.y << " at " << i << ", " << j;
+					visited[idx] = 1;
+
+					const uint2 texCoord = omm::GetTiledTexCoord(idx, size);
+					EXPECT_EQ(texCoord.x, (uint32_t)i);
+					EXPECT_EQ(texCoord.y, (uint32_t)j);
+				}
+			}
+		}
+	}
+
+	TEST(Texture, BorrowedRowPitch) {
+
+		omm::Baker baker = 0;
+		EXPECT_EQ(omm::CreateBaker({ .type = omm::BakerType::CPU }, &baker), omm::Result::SUCCESS);
+
+		const int2 size = int2(300, 200);
+		const uint32_t rowPitch = 320 * sizeof(float);
+
+		// The padding holds values that would flip the bake if they were read as texels.
+		std::vector<float> packed(size.x * size.y);
+		std::vector<float> padded(rowPitch / sizeof(float) * size.y, 1.f);
+		for (int j = 0; j < size.y; ++j)
+		{
+			for (int i = 0; i < size.x; ++i)
+			{
+				const float2 uv = (float2(i, j) + 0.5f) / (float2)size - 0.5f;
+				const float alpha = glm::length(uv) < 0.3f ? 1.f : 0.f;
+				packed[i + j * size.x] = alpha;
+				padded[i + j * rowPitch / sizeof(float)] = alpha;
+			}
+		}
+
+		auto createTexture = [&](const float* data, uint32_t pitch, omm::Cpu::TextureFlags flags) {
+			omm::Cpu::TextureMipDesc mip;
+			mip.width = size.x;
+			mip.height = size.y;
+			mip.rowPitch = pitch;
+			mip.textureData = data;
+
+			omm::Cpu::TextureDesc desc;
+			desc.format = omm::Cpu::TextureFormat::FP32;
+			desc.flags = flags;
+			desc.mips = &mip;
+			desc.mipCount = 1;
+			desc.alphaCutoff = 0.5f;
+
+			omm::Cpu::Texture tex = 0;
+			EXPECT_EQ(omm::Cpu::CreateTexture(baker, desc, &tex), omm::Result::SUCCESS);
+			return tex;
+		};
+
+		omm::Cpu::Texture copied = createTexture(packed.data(), 0, omm::Cpu::TextureFlags::DisableZOrder);
+		omm::Cpu::Texture borrowed = createTexture(padded.data(), rowPitch,
+			(omm::Cpu::TextureFlags)((uint32_t)omm::Cpu::TextureFlags::DisableZOrder | (uint32_t)omm::Cpu::TextureFlags::BorrowTextureData));
+
+		std::vector<float> readBack(packed.size());
+		omm::Cpu::TextureMipDesc outMip;
+		outMip.textureData = readBack.data();
+		omm::Cpu::TextureDesc outDesc;
+		outDesc.mips = &outMip;
+		EXPECT_EQ(omm::Cpu::GetTextureDesc(borrowed, &outDesc), omm::Result::SUCCESS);
+		EXPECT_EQ(readBack, packed);
+
+		uint32_t indices[3] = { 0, 1, 2 };
+		float texCoords[6] = { 0.f, 0.f, 1.f, 0.f, 0.f, 1.f };
+
+		std::vector<uint8_t> arrayData[2];
+		for (uint32_t it = 0; it < 2; ++it)
+		{
+			omm::Cpu::BakeInputDesc desc;
+			desc.texture = it == 0 ? copied : borrowed;
+			desc.alphaMode = omm::AlphaMode::Test;
+			desc.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+			desc.runtimeSamplerDesc.filter = omm::TextureFilterMode::Linear;
+			desc.indexFormat = omm::IndexFormat::UINT_32;
+			desc.indexBuffer = indices;
+			desc.indexCount = 3;
+			desc.texCoords = texCoords;
+			desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+			desc.maxSubdivisionLevel = 5;
+
+			omm::Cpu::BakeResult res = 0;
+			EXPECT_EQ(omm::Cpu::Bake(baker, desc, &res), omm::Result::SUCCESS);
+			const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+			EXPECT_EQ(omm::Cpu::GetBakeResultDesc(res, &resDesc), omm::Result::SUCCESS);
+			const uint8_t* begin = (const uint8_t*)resDesc->arrayData;
+			arrayData[it].assign(begin, begin + resDesc->arrayDataSize);
+			EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+		}
+		EXPECT_FALSE(arrayData[0].empty());
+		EXPECT_EQ(arrayData[0], arrayData[1]);
+
+		EXPECT_EQ(omm::Cpu::DestroyTexture(baker, copied), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::Cpu::DestroyTexture(baker, borrowed), omm::Result::SUCCESS);
+		EXPECT_EQ(omm::DestroyBaker(baker), omm::Result::SUCCESS);
+	}
+
+	TEST(Texture, DecodeBC4Block) {
+		float alpha[omm::kBlockTexels];
+
+		// 8 value palette, texel i uses index i % 8.
+		const uint8_t block8[8] = { 210, 70, 0x88, 0xC6, 0xFA, 0x88, 0xC6, 0xFA };
+		omm::DecodeBC4Block(block8, alpha);
+		for (int i = 0; i < omm::kBlockTexels; ++i)
+		{
+			const int index = i % 8;
+			const float expected = index == 0 ? 210.f : index == 1 ? 70.f : ((8 - index) * 210.f + (index - 1) * 70.f) / 7.f;
+			EXPECT_NEAR(alpha[i], expected / 255.f, 1e-6f) << i;
+		}
+
+		// 6 value palette with explicit 0 and 1.
+		const uint8_t block6[8] = { 50, 200, 0x88, 0xC6, 0xFA, 0x88, 0xC6, 0xFA };
+		omm::DecodeBC4Block(block6, alpha);
+		for (int i = 0; i < omm::kBlockTexels; ++i)
+		{
+			const int index = i % 8;
+			const float expected = index == 0 ? 50.f / 255.f : index == 1 ? 200.f / 255.f : index == 6 ? 0.f : index == 7 ? 1.f :
+				((6 - index) * 50.f + (index - 1) * 200.f) / (5.f * 255.f);
+			EXPECT_NEAR(alpha[i], expected, 1e-6f) << i;
+		}
+	}
+
+	TEST(Texture, CompressedFormatsMatchUnorm8) {
+
+		omm::Baker baker = 0;
+		EXPECT_EQ(omm::CreateBaker({ .type = omm::BakerType::CPU }, &baker), omm::Result::SUCCESS);
+
+		// Not a multiple of the block size, the partial blocks on the edges must be addressed correctly.
+		const int2 size = int2(70, 51);
+		const int2 blockCount = (size + 3) / 4;
+
+		auto IsOpaque = [&](int i, int j) {
+			const float2 uv = (float2(i, j) + 0.5f) / (float2)size - float2(0.4f, 0.55f);
+			return glm::length(uv) < 0.3f;
+		};
+
+		std::vector<uint8_t> unorm8(size.x * size.y);
+		std::vector<uint8_t> r1(((size.x + 7) / 8) * size.y);
+		std::vector<uint8_t> bc4(8 * blockCount.x * blockCount.y);
+		std::vector<uint8_t> bc3(16 * blockCount.x * blockCount.y, 0xAB);
+		for (int by = 0; by < blockCount.y; ++by)
+		{
+			for (int bx = 0; bx < blockCount.x; ++bx)
+			{
+				// a0 = 1 and a1 = 0, index 0 decodes to 1 and index 1 to 0.
+				uint8_t* block = &bc4[8 * (bx + by * blockCount.x)];
+				block[0] = 255;
+				block[1] = 0;
+				uint64_t indices = 0;
+				for (int t = 0; t < omm::kBlockTexels; ++t)
+				{
+					const int i = bx * 4 + t % 4;
+					const int j = by * 4 + t / 4;
+					if (i >= size.x || j >= size.y || !IsOpaque(i, j))
+						indices |= 1ull << (3 * t);
+				}
+				for (int b = 0; b < 6; ++b)
+					block[2 + b] = uint8_t(indices >> (8 * b));
+				std::memcpy(&bc3[16 * (bx + by * blockCount.x)], block, 8);
+			}
+		}
+		for (int j = 0; j < size.y; ++j)
+		{
+			for (int i = 0; i < size.x; ++i)
+			{
+				unorm8[i + j * size.x] = IsOpaque(i, j) ? 255 : 0;
+				if (IsOpaque(i, j))
+					r1[j * ((size.x + 7) / 8) + i / 8] |= uint8_t(1u << (i % 8));
+			}
+		}
+
+		const omm::Cpu::TextureFormat formats[] = { omm::Cpu::TextureFormat::UNORM8, omm::Cpu::TextureFormat::BC4_UNORM,
+			omm::Cpu::TextureFormat::BC3_UNORM, omm::Cpu::TextureFormat::R1_UNORM };
+		const void* data[] = { unorm8.data(), bc4.data(), bc3.data(), r1.data() };
+
+		uint32_t indices[6] = { 0, 1, 2, 2, 1, 3 };
+		float texCoords[8] = { 0.f, 0.f, 1.f, 0.f, 0.f, 1.f, 1.f, 1.f };
+
+		for (omm::TextureFilterMode filter : { omm::TextureFilterMode::Linear, omm::TextureFilterMode::Nearest })
+		{
+			std::vector<uint8_t> reference;
+			for (uint32_t formatIt = 0; formatIt < 4; ++formatIt)
+			{
+				omm::Cpu::TextureMipDesc mip;
+				mip.width = size.x;
+				mip.height = size.y;
+				mip.textureData = data[formatIt];
+
+				omm::Cpu::TextureDesc texDesc;
+				texDesc.format = formats[formatIt];
+				texDesc.mips = &mip;
+				texDesc.mipCount = 1;
+				texDesc.alphaCutoff = 0.5f;
+
+				omm::Cpu::Texture tex = 0;
+				EXPECT_EQ(omm::Cpu::CreateTexture(baker, texDesc, &tex), omm::Result::SUCCESS);
+
+				omm::Cpu::BakeInputDesc desc;
+				desc.texture = tex;
+				desc.alphaMode = omm::AlphaMode::Test;
+				desc.runtimeSamplerDesc.addressingMode = omm::TextureAddressMode::Clamp;
+				desc.runtimeSamplerDesc.filter = filter;
+				desc.indexFormat = omm::IndexFormat::UINT_32;
+				desc.indexBuffer = indices;
+				desc.indexCount = 6;
+				desc.texCoords = texCoords;
+				desc.texCoordFormat = omm::TexCoordFormat::UV32_FLOAT;
+				desc.maxSubdivisionLevel = 5;
+
+				omm::Cpu::BakeResult res = 0;
+				EXPECT_EQ(omm::Cpu::Bake(baker, desc, &res), omm::Result::SUCCESS);
+				const omm::Cpu::BakeResultDesc* resDesc = nullptr;
+				EXPECT_EQ(omm::Cpu::GetBakeResultDesc(res, &resDesc), omm::Result::SUCCESS);
+				const uint8_t* begin = (const uint8_t*)resDesc->arrayData;
+				std::vector<uint8_t> arrayData(begin, begin + resDesc->arrayDataSize);
+				EXPECT_EQ(omm::Cpu::DestroyBakeResult(res), omm::Result::SUCCESS);
+
+				if (formatIt == 0)
+				{
+					EXPECT_FALSE(arrayData.empty());
+					reference = arrayData;
+				}
+				else
+					EXPECT_EQ(arrayData, reference) << "format " << (uint32_t)formats[formatIt];
+
+				EXPECT_EQ(omm::Cpu::DestroyTexture(baker, tex), omm::Result::SUCCESS);
+			}
+		}
+
+		EXPECT_EQ(omm::DestroyBaker(baker), omm::Result::SUCCESS);
+	}
+}
@@ -10,6 +10,21 @@ license agreement from NVIDIA CORPORATION is strictly prohibited.
 
 #include <gtest/gtest.h>
 #include "util/bit_tricks.h"
+#include "util/parallel.h"
+#include "util/cpu_raster.h"
+#include "util/dedup.h"
+#include "util/hamming.h"
+#include "arena_allocator.h"
+
+#include <omm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace {
 
@@ -25,4 +40,343 @@ namespace {
 		}
 	}
 
+	struct TestTaskSystem
+	{
+		std::atomic<uint32_t> numCalls = 0;
+
+		static void ParallelFor(void* userArg, uint32_t taskCount, omm::TaskCallback task, void* taskArg) {
+			TestTaskSystem* _this = (TestTaskSystem*)userArg;
+			_this->numCalls++;
+			for (uint32_t taskIt = 0; taskIt < taskCount; ++taskIt)
+				task(taskIt, taskArg);
+		}
+
+		static void* SubmitTask(void* userArg, omm::TaskCallback task, void* taskArg) {
+			TestTaskSystem* _this = (TestTaskSystem*)userArg;
+			_this->numCalls++;
+			return new std::thread(task, 0, taskArg);
+		}
+
+		static void WaitTask(void* userArg, void* task) {
+			std::thread* thread = (std::thread*)task;
+			thread->join();
+			delete thread;
+		}
+	};
+
+	static void TestParallelFor(const omm::parallel::Scheduler& scheduler) {
+
+		const StdAllocator<uint8_t> allocator = StdAllocator<uint8_t>(StdMemoryAllocatorInterface());
+
+		for (bool enableThreads : { false, true }) {
+			for (uint32_t taskCount : { 0u, 1u, 7u, 4096u }) {
+				std::vector<std::atomic<uint32_t>> visited(taskCount);
+				scheduler.ParallelFor(allocator, enableThreads, taskCount, [&](uint32_t taskIt) {
+					visited[taskIt]++;
+				});
+
+				for (uint32_t taskIt = 0; taskIt < taskCount; ++taskIt)
+					EXPECT_EQ(visited[taskIt], 1u);
+			}
+		}
+
+		const uint32_t count = 1000;
+		std::vector<std::atomic<uint32_t>> visited(count);
+		scheduler.ParallelForBlocks(allocator, true /*enableThreads*/, count, 64, [&](uint32_t begin, uint32_t end) {
+			EXPECT_LE(end - begin, 64u);
+			for (uint32_t i = begin; i < end; ++i)
+				visited[i]++;
+		});
+
+		for (uint32_t i = 0; i < count; ++i)
+			EXPECT_EQ(visited[i], 1u);
+	}
+
+	TEST(Parallel, InternalThreads) {
+		TestParallelFor(omm::parallel::Scheduler(StdAllocator<uint8_t>(StdMemoryAllocatorInterface())));
+	}
+
+	TEST(Parallel, HostParallelFor) {
+		TestTaskSystem taskSystem;
+		ommTaskInterface taskInterface = ommTaskInterfaceDefault();
+		taskInterface.parallelFor = &TestTaskSystem::ParallelFor;
+		taskInterface.workerCount = 4;
+		taskInterface.userArg = &taskSystem;
+		TestParallelFor(omm::parallel::Scheduler(StdAllocator<uint8_t>(StdMemoryAllocatorInterface()), taskInterface));
+		EXPECT_GT(taskSystem.numCalls, 0u);
+	}
+
+	TEST(Parallel, HostSubmitWait) {
+		TestTaskSystem taskSystem;
+		ommTaskInterface taskInterface = ommTaskInterfaceDefault();
+		taskInterface.submitTask = &TestTaskSystem::SubmitTask;
+		taskInterface.waitTask = &TestTaskSystem::WaitTask;
+		taskInterface.workerCount = 4;
+		taskInterface.userArg = &taskSystem;
+		TestParallelFor(omm::parallel::Scheduler(StdAllocator<uint8_t>(StdMemoryAllocatorInterface()), taskInterface));
+		EXPECT_GT(taskSystem.numCalls, 0u);
+	}
+
+	TEST(Parallel, PersistentWorkers) {
+		ommTaskInterface taskInterface = ommTaskInterfaceDefault();
+		taskInterface.workerCount = 4;
+		const StdAllocator<uint8_t> allocator = StdAllocator<uint8_t>(StdMemoryAllocatorInterface());
+		const omm::parallel::Scheduler scheduler(allocator, taskInterface);
+
+		// Every task waits for the others, so each of the four threads runs exactly one of them.
+		auto CollectThreadIds = [&]() {
+			std::vector<std::thread::id> ids(4);
+			std::atomic<uint32_t> arrived = 0;
+			scheduler.ParallelFor(allocator, true /*enableThreads*/, 4, [&](uint32_t taskIt) {
+				ids[taskIt] = std::this_thread::get_id();
+				arrived++;
+				while (arrived < 4)
+					std::this_thread::yield();
+			});
+			std::sort(ids.begin(), ids.end());
+			return ids;
+		};
+
+		const std::vector<std::thread::id> first = CollectThreadIds();
+		std::vector<std::thread::id> distinct = first;
+		distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+		EXPECT_EQ(distinct.size(), 4u);
+		EXPECT_EQ(first, CollectThreadIds());
+
+		// Regions submitted from inside a region run to completion.
+		std::atomic<uint32_t> numNested = 0;
+		scheduler.ParallelFor(allocator, true /*enableThreads*/, 8, [&](uint32_t) {
+			scheduler.ParallelFor(allocator, true /*enableThreads*/, 8, [&](uint32_t) { numNested++; });
+		});
+		EXPECT_EQ(numNested, 64u);
+	}
+
+	struct CountingAllocator
+	{
+		int32_t numLive = 0;
+		int32_t numAllocs = 0;
+
+		static void* Allocate(void* userArg, size_t size, size_t alignment) {
+			CountingAllocator* _this = (CountingAllocator*)userArg;
+			_this->numLive++;
+			_this->numAllocs++;
+			return AlignedMalloc(nullptr, size, alignment);
+		}
+
+		static void* Reallocate(void* userArg, void* memory, size_t size, size_t alignment) {
+			return AlignedRealloc(nullptr, memory, size, alignment);
+		}
+
+		static void Free(void* userArg, void* memory) {
+			if (memory != nullptr)
+				((CountingAllocator*)userArg)->numLive--;
+			AlignedFree(nullptr, memory);
+		}
+	};
+
+	TEST(Parallel, WorkerPoolAllocator) {
+		CountingAllocator counting;
+		const StdAllocator<uint8_t> allocator = StdAllocator<uint8_t>(StdMemoryAllocatorInterface{ &CountingAllocator::Allocate, &CountingAllocator::Reallocate, &CountingAllocator::Free, &counting });
+		ommTaskInterface taskInterface = ommTaskInterfaceDefault();
+		taskInterface.workerCount = 4;
+
+		// The pool and its thread list come from the allocator and are released with the last copy of the scheduler.
+		{
+			const omm::parallel::Scheduler scheduler(allocator, taskInterface);
+			const omm::parallel::Scheduler copy = scheduler;
+			std::atomic<uint32_t> numTasks = 0;
+			copy.ParallelFor(allocator, true /*enableThreads*/, 64, [&](uint32_t) { numTasks++; });
+			EXPECT_EQ(numTasks, 64u);
+			EXPECT_GE(counting.numAllocs, 2);
+		}
+		EXPECT_EQ(counting.numLive, 0);
+	}
+
+	TEST(Arena, Allocate) {
+		CountingAllocator backing;
+		ArenaAllocator arena(StdAllocator<uint8_t>(StdMemoryAllocatorInterface{ &CountingAllocator::Allocate, &CountingAllocator::Reallocate, &CountingAllocator::Free, &backing }));
+		const StdMemoryAllocatorInterface& allocator = arena.GetStdAllocator().GetInterface();
+
+		// Small allocations share blocks and keep their alignment and contents.
+		std::vector<uint8_t*> allocations;
+		for (uint32_t i = 0; i < 1000; ++i)
+		{
+			const size_t alignment = size_t(1) << (i % 8);
+			uint8_t* memory = (uint8_t*)allocator.Allocate(allocator.UserArg, 100 + i, alignment);
+			ASSERT_NE(memory, nullptr);
+			EXPECT_EQ((size_t)memory % alignment, 0u);
+			std::memset(memory, (int)(i & 0xFF), 100 + i);
+			allocations.push_back(memory);
+		}
+		for (uint32_t i = 0; i < 1000; ++i)
+		{
+			EXPECT_EQ(allocations[i][0], (uint8_t)(i & 0xFF));
+			EXPECT_EQ(allocations[i][99 + i], (uint8_t)(i & 0xFF));
+			allocator.Free(allocator.UserArg, allocations[i]);
+		}
+		EXPECT_LT(backing.numAllocs, 10);
+
+		// Reallocation preserves the contents.
+		uint8_t* memory = (uint8_t*)allocator.Allocate(allocator.UserArg, 16, 16);
+		std::memset(memory, 7, 16);
+		memory = (uint8_t*)allocator.Reallocate(allocator.UserArg, memory, 64, 16);
+		EXPECT_EQ(memory[15], 7);
+
+		// Large allocations are returned to the backing allocator when freed.
+		const int32_t numLive = backing.numLive;
+		void* large = allocator.Allocate(allocator.UserArg, 1 << 20, 64);
+		ASSERT_NE(large, nullptr);
+		EXPECT_EQ(backing.numLive, numLive + 1);
+		allocator.Free(allocator.UserArg, large);
+		EXPECT_EQ(backing.numLive, numLive);
+
+		arena.Reset();
+		EXPECT_EQ(backing.numLive, 0);
+	}
+
+	TEST(Arena, ReuseFreed) {
+		CountingAllocator backing;
+		ArenaAllocator arena(StdAllocator<uint8_t>(StdMemoryAllocatorInterface{ &CountingAllocator::Allocate, &CountingAllocator::Reallocate, &CountingAllocator::Free, &backing }));
+		const StdMemoryAllocatorInterface& allocator = arena.GetStdAllocator().GetInterface();
+
+		// A freed allocation is handed out again for the next one of its size class.
+		void* first = allocator.Allocate(allocator.UserArg, 1000, 16);
+		allocator.Free(allocator.UserArg, first);
+		EXPECT_EQ(allocator.Allocate(allocator.UserArg, 990, 16), first);
+
+		// Growing within the chunk keeps the allocation in place.
+		uint8_t* memory = (uint8_t*)allocator.Allocate(allocator.UserArg, 33, 8);
+		std::memset(memory, 3, 33);
+		EXPECT_EQ(allocator.Reallocate(allocator.UserArg, memory, 40, 8), memory);
+		EXPECT_EQ(memory[32], 3);
+
+		// Allocating and freeing in a loop doesn't grow the arena.
+		const int32_t numAllocs = backing.numAllocs;
+		for (uint32_t i = 0; i < 100000; ++i)
+			allocator.Free(allocator.UserArg, allocator.Allocate(allocator.UserArg, 100 + (i % 4096), 8));
+		EXPECT_LE(backing.numAllocs, numAllocs + 1);
+	}
+
+	TEST(Arena, ConcurrentAllocate) {
+		const StdAllocator<uint8_t> backing = StdAllocator<uint8_t>(StdMemoryAllocatorInterface());
+		ArenaAllocator arena(backing);
+		const StdMemoryAllocatorInterface& allocator = arena.GetStdAllocator().GetInterface();
+
+		// Allocations made on one thread are freed on another.
+		static constexpr uint32_t kThreadCount = 8;
+		static constexpr uint32_t kAllocationCount = 2000;
+		std::vector<std::vector<uint8_t*>> allocations(kThreadCount);
+		std::vector<std::thread> threads;
+		for (uint32_t threadIt = 0; threadIt < kThreadCount; ++threadIt)
+		{
+			threads.emplace_back([&, threadIt]() {
+				for (uint32_t i = 0; i < kAllocationCount; ++i)
+				{
+					const size_t size = 16 + (i * 37) % 3000;
+					uint8_t* memory = (uint8_t*)allocator.Allocate(allocator.UserArg, size, 16);
+					std::memset(memory, (int)threadIt, size);
+					allocations[threadIt].push_back(memory);
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+		threads.clear();
+
+		for (uint32_t threadIt = 0; threadIt < kThreadCount; ++threadIt)
+		{
+			threads.emplace_back([&, threadIt]() {
+				const std::vector<uint8_t*>& other = allocations[(threadIt + 1) % kThreadCount];
+				for (uint32_t i = 0; i < kAllocationCount; ++i)
+				{
+					const size_t size = 16 + (i * 37) % 3000;
+					EXPECT_EQ(other[i][0], (uint8_t)((threadIt + 1) % kThreadCount));
+					EXPECT_EQ(other[i][size - 1], (uint8_t)((threadIt + 1) % kThreadCount));
+					allocator.Free(allocator.UserArg, other[i]);
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	TEST(Hamming, CountDiff3State) {
+		std::mt19937_64 mt(42);
+		for (size_t numWords : { 1, 3, 4, 5, 17, 64 })
+		{
+			std::vector<uint64_t> a(numWords);
+			std::vector<uint64_t> b(numWords);
+			for (size_t i = 0; i < numWords; ++i)
+			{
+				a[i] = mt();
+				// Mostly similar states, as near duplicates are.
+				b[i] = a[i] ^ (mt() & mt() & mt());
+			}
+
+			const uint32_t expected = omm::hamming::CountDiff3StateScalar(a.data(), b.data(), numWords);
+			EXPECT_EQ(omm::hamming::CountDiff3StateScalar(a.data(), a.data(), numWords), 0u);
+#if OMM_SIMD_X86
+			if (omm::raster::GetSimdLevel() >= omm::raster::SimdLevel::AVX2)
+				EXPECT_EQ(omm::hamming::CountDiff3StateAVX2(a.data(), b.data(), numWords), expected);
+#endif
+#if OMM_SIMD_NEON
+			EXPECT_EQ(omm::hamming::CountDiff3StateNEON(a.data(), b.data(), numWords), expected);
+#endif
+		}
+
+		// UnknownTransparent and UnknownOpaque compare equal.
+		const uint64_t unknownTransparent = 0xAAAAAAAAAAAAAAAAull;
+		const uint64_t unknownOpaque = 0xFFFFFFFFFFFFFFFFull;
+		const uint64_t opaque = 0x5555555555555555ull;
+		EXPECT_EQ(omm::hamming::CountDiff3StateScalar(&unknownTransparent, &unknownOpaque, 1), 0u);
+		EXPECT_EQ(omm::hamming::CountDiff3StateScalar(&unknownTransparent, &opaque, 1), 32u);
+	}
+
+	// Values whose digests only keep value % 7 in the top bits, so distinct values collide and their probe sequences run
+	// through each other's entries.
+	struct CollidingDedupItems
+	{
+		std::vector<uint32_t> values;
+		std::vector<uint32_t> survivors;
+
+		uint64_t GetDigest(uint32_t i) const { return uint64_t(values[i] % 7) << 60; }
+		bool IsEqual(uint32_t a, uint32_t b) const { return values[a] == values[b]; }
+		void Merge(uint32_t survivor, uint32_t i) { survivors[i] = survivor; }
+	};
+
+	TEST(Dedup, CollidingDigests) {
+		std::mt19937 rng(7);
+		CollidingDedupItems items;
+		for (uint32_t i = 0; i < 20000; ++i)
+			items.values.push_back(rng() % 300);
+
+		// Every value survives as its first item, and only equal items are merged in to it.
+		std::vector<uint32_t> expected(items.values.size(), ~0u);
+		std::unordered_map<uint32_t, uint32_t> firstItem;
+		for (uint32_t i = 0; i < (uint32_t)items.values.size(); ++i)
+		{
+			auto it = firstItem.insert(std::make_pair(items.values[i], i)).first;
+			if (it->second != i)
+				expected[i] = it->second;
+		}
+
+		std::vector<uint32_t> indices(items.values.size());
+		for (uint32_t i = 0; i < (uint32_t)indices.size(); ++i)
+			indices[i] = i;
+
+		items.survivors.assign(items.values.size(), ~0u);
+		std::unordered_map<uint64_t, uint32_t> digestToIndex;
+		omm::dedup::DeduplicateExact(digestToIndex, indices.data(), (uint32_t)indices.size(), items);
+		EXPECT_EQ(items.survivors, expected);
+
+		ommTaskInterface taskInterface = ommTaskInterfaceDefault();
+		taskInterface.workerCount = 4;
+		const StdAllocator<uint8_t> allocator = StdAllocator<uint8_t>(StdMemoryAllocatorInterface());
+		const omm::parallel::Scheduler scheduler(allocator, taskInterface);
+
+		items.survivors.assign(items.values.size(), ~0u);
+		omm::dedup::DeduplicateExactSharded(allocator, scheduler, true /*enableThreads*/, indices.data(), (uint32_t)indices.size(), items);
+		EXPECT_EQ(items.survivors, expected);
+	}
+
 }  // namespace
\ No newline at end of file
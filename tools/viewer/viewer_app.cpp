@@ -80,6 +80,8 @@ static const char* ToString(omm::Result result)
     case omm::Result::INSUFFICIENT_SCRATCH_MEMORY: return "INSUFFICIENT_SCRATCH_MEMORY";
     case omm::Result::NOT_IMPLEMENTED: return "NOT_IMPLEMENTED";
     case omm::Result::WORKLOAD_TOO_BIG: return "WORKLOAD_TOO_BIG";
+    case omm::Result::NOT_READY: return "NOT_READY";
+    case omm::Result::CANCELLED: return "CANCELLED";
     case omm::Result::MAX_NUM: return "MAX_NUM";
     default:
         return "unknown error code";